@@ -230,6 +230,113 @@ run_rec_bench(void)
 	}
 }
 
+typedef struct combrec_bench {
+	const void	*cb_golden;
+	uint64_t	cb_verified;
+} combrec_bench_t;
+
+static boolean_t
+combrec_bench_verify(raidz_map_t *rm, void *arg)
+{
+	(void) rm;
+	combrec_bench_t *cb = arg;
+
+	cb->cb_verified++;
+	return (abd_cmp_buf(zio_bench.io_abd, cb->cb_golden,
+	    zio_bench.io_size) == 0);
+}
+
+static void
+run_combrec_bench_impl(int parity, int nbad, boolean_t ordered)
+{
+	const int ncols = rto_opts.rto_dcols + parity;
+	uint64_t iter_cnt, iter;
+	combrec_bench_t cb;
+	hrtime_t start;
+	double elapsed;
+	void *golden;
+	int *order;
+
+	if (nbad > (int)rto_opts.rto_dcols)
+		return;
+
+	rm_bench = vdev_raidz_map_alloc(&zio_bench, BENCH_ASHIFT, ncols,
+	    parity);
+	vdev_raidz_generate_parity(rm_bench);
+
+	golden = umem_alloc(zio_bench.io_size, UMEM_NOFAIL);
+	abd_copy_to_buf(golden, zio_bench.io_abd, zio_bench.io_size);
+	cb.cb_golden = golden;
+	cb.cb_verified = 0;
+
+	/*
+	 * The last nbad data columns are silently damaged, which is the worst
+	 * case when searching in child ID order.  The ordered search is told
+	 * they're the most likely culprits, as their error counts would.
+	 */
+	order = umem_alloc(ncols * sizeof (int), UMEM_NOFAIL);
+	for (int c = 0; c < ncols; c++) {
+		if (ordered)
+			order[c] = c < nbad ? ncols - nbad + c : c - nbad;
+		else
+			order[c] = c;
+	}
+
+	iter_cnt = REC_BENCH_MEMORY / zio_bench.io_size / 64;
+
+	start = gethrtime();
+	for (iter = 0; iter < iter_cnt; iter++) {
+		raidz_row_t *rr = rm_bench->rm_row[0];
+
+		for (int c = ncols - nbad; c < ncols; c++)
+			abd_zero(rr->rr_col[c].rc_abd, rr->rr_col[c].rc_size);
+
+		VERIFY0(vdev_raidz_combrec_map(rm_bench, parity, ncols, order,
+		    combrec_bench_verify, &cb));
+
+		for (int c = 0; c < ncols; c++)
+			rr->rr_col[c].rc_need_orig_restore = B_FALSE;
+	}
+	elapsed = NSEC2SEC((double)(gethrtime() - start));
+
+	VERIFY0(abd_cmp_buf(zio_bench.io_abd, golden, zio_bench.io_size));
+
+	LOG(D_ALL, "%6d, %4d, %zu, %10llu, %8s, %lf, %lf, %u\n",
+	    parity,
+	    nbad,
+	    rto_opts.rto_dcols,
+	    (u_longlong_t)zio_bench.io_size,
+	    ordered ? "errors" : "child",
+	    (double)cb.cb_verified / iter_cnt,
+	    elapsed * 1000000.0 / iter_cnt,
+	    (unsigned)iter_cnt);
+
+	umem_free(order, ncols * sizeof (int));
+	umem_free(golden, zio_bench.io_size);
+	vdev_raidz_map_free(rm_bench);
+}
+
+static void
+run_combrec_bench(void)
+{
+	LOG(D_INFO, DBLSEP
+	    "\nBenchmarking combinatorial reconstruction...\n\n");
+	LOG(D_ALL, "parity, nbad, dcols, iosize, order, verify_per_blk, "
+	    "usec_per_blk, iter\n");
+
+	if (vdev_raidz_impl_set("fastest") != 0)
+		return;
+
+	zio_bench.io_size = SPA_OLD_MAXBLOCKSIZE;
+
+	for (int parity = 1; parity <= PARITY_PQR; parity++) {
+		for (int nbad = 1; nbad <= parity; nbad++) {
+			run_combrec_bench_impl(parity, nbad, B_FALSE);
+			run_combrec_bench_impl(parity, nbad, B_TRUE);
+		}
+	}
+}
+
 void
 run_raidz_benchmark(void)
 {
@@ -237,6 +344,7 @@ run_raidz_benchmark(void)
 
 	run_gen_bench();
 	run_rec_bench();
+	run_combrec_bench();
 
 	bench_fini_raidz_maps();
 }
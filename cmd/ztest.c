@@ -255,6 +255,15 @@ extern uint64_t metaslab_force_ganging;
 extern uint64_t metaslab_df_alloc_threshold;
 extern uint64_t zfs_deadman_synctime_ms;
 extern uint_t metaslab_preload_limit;
+extern uint_t zio_offload_sw;
+extern uint_t zio_offload_sw_errors;
+extern uint_t zfs_arc_dcache_percent;
+extern uint_t zfs_arc_dcache_min_decompress;
+extern uint_t zfs_vdev_mirror_split_size;
+#ifdef HAVE_LINUX_IO_URING_H
+extern int vdev_file_uring;
+extern uint_t vdev_file_uring_depth;
+#endif
 extern int zfs_compressed_arc_enabled;
 extern int zfs_abd_scatter_enabled;
 extern uint_t dmu_object_alloc_chunk_shift;
@@ -3784,7 +3793,8 @@ ztest_vdev_attach_detach(ztest_ds_t *zd, uint64_t id)
 	 */
 	boolean_t rebuilding = B_FALSE;
 	if (pvd->vdev_ops == &vdev_mirror_ops ||
-	    pvd->vdev_ops ==  &vdev_root_ops) {
+	    pvd->vdev_ops ==  &vdev_root_ops ||
+	    pvd->vdev_ops == &vdev_draid_ops) {
 		rebuilding = !!ztest_random(2);
 	}
 
@@ -7578,6 +7588,16 @@ ztest_run(ztest_shared_t *zs)
 	list_create(&zcl.zcl_callbacks, sizeof (ztest_cb_data_t),
 	    offsetof(ztest_cb_data_t, zcd_node));
 
+#ifdef HAVE_LINUX_IO_URING_H
+	/*
+	 * Do file vdev I/O on the taskq in some runs, and use very shallow
+	 * rings in others so that falling back to the taskq when a ring is
+	 * full gets exercised too.
+	 */
+	vdev_file_uring = ztest_random(4) != 0;
+	vdev_file_uring_depth = ztest_random(2) ? 256 : 4;
+#endif
+
 	/*
 	 * Open our pool.  It may need to be imported first depending on
 	 * what tests were running when the previous pass was terminated.
@@ -7595,7 +7615,30 @@ ztest_run(ztest_shared_t *zs)
 	metaslab_preload_limit = ztest_random(20) + 1;
 	ztest_spa = spa;
 
+	/*
+	 * Send the checksum and compression work of writes through the
+	 * software offload provider in some runs, failing some of it so the
+	 * fallback to the CPU is exercised too.
+	 */
+	zio_offload_sw = ztest_random(2);
+	zio_offload_sw_errors = ztest_random(2) ? 0 : 10;
+
+	/*
+	 * Keep decompressed copies of blocks in some runs, admitting them
+	 * after very few decompressions so the cache sees plenty of churn.
+	 */
+	zfs_arc_dcache_percent = ztest_random(2) ? 0 : 10;
+	zfs_arc_dcache_min_decompress = ztest_random(3) + 1;
+
+	/*
+	 * Split most mirror reads in some runs, so that the damage done to
+	 * mirror children also exercises retrying split reads.
+	 */
+	zfs_vdev_mirror_split_size = ztest_random(2) ? 4096 : 64 * 1024;
+
 	VERIFY0(vdev_raidz_impl_set("cycle"));
+	VERIFY0(zfs_impl_get_ops("sha256_mb")->setname("cycle"));
+	VERIFY0(zfs_impl_get_ops("sha512_mb")->setname("cycle"));
 
 	dmu_objset_stats_t dds;
 	VERIFY0(ztest_dmu_objset_own(ztest_opts.zo_pool,
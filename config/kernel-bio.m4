@@ -509,6 +509,33 @@ AC_DEFUN([ZFS_AC_KERNEL_BIO_ALLOC_4ARG], [
 	])
 ])
 
+dnl #
+dnl # 5.17 API change, bio_poll() replaces blk_poll() and takes the bio
+dnl # itself rather than a queue and cookie, and REQ_HIPRI is renamed to
+dnl # REQ_POLLED.  Only the new interface is supported for polled I/O.
+dnl #
+AC_DEFUN([ZFS_AC_KERNEL_SRC_BIO_POLL], [
+	ZFS_LINUX_TEST_SRC([bio_poll], [
+		#include <linux/bio.h>
+		#include <linux/blkdev.h>
+	],[
+		struct bio *bio = NULL;
+		unsigned int opf __attribute__ ((unused)) = REQ_POLLED;
+		int ret __attribute__ ((unused)) =
+		    bio_poll(bio, NULL, BLK_POLL_ONESHOT);
+	])
+])
+
+AC_DEFUN([ZFS_AC_KERNEL_BIO_POLL], [
+	AC_MSG_CHECKING([whether bio_poll() exists])
+	ZFS_LINUX_TEST_RESULT([bio_poll], [
+		AC_MSG_RESULT(yes)
+		AC_DEFINE(HAVE_BIO_POLL, 1, [bio_poll() exists])
+	],[
+		AC_MSG_RESULT(no)
+	])
+])
+
 AC_DEFUN([ZFS_AC_KERNEL_SRC_BIO], [
 	ZFS_AC_KERNEL_SRC_REQ
 	ZFS_AC_KERNEL_SRC_BIO_OPS
@@ -524,6 +551,7 @@ AC_DEFUN([ZFS_AC_KERNEL_SRC_BIO], [
 	ZFS_AC_KERNEL_SRC_BIO_SET_DEV_MACRO
 	ZFS_AC_KERNEL_SRC_BLK_CGROUP_HEADER
 	ZFS_AC_KERNEL_SRC_BIO_ALLOC_4ARG
+	ZFS_AC_KERNEL_SRC_BIO_POLL
 ])
 
 AC_DEFUN([ZFS_AC_KERNEL_BIO], [
@@ -549,4 +577,5 @@ AC_DEFUN([ZFS_AC_KERNEL_BIO], [
 	ZFS_AC_KERNEL_BDEV_SUBMIT_BIO_RETURNS_VOID
 	ZFS_AC_KERNEL_BLK_CGROUP_HEADER
 	ZFS_AC_KERNEL_BIO_ALLOC_4ARG
+	ZFS_AC_KERNEL_BIO_POLL
 ])
@@ -0,0 +1,7 @@
+dnl #
+dnl # Check for the io_uring UAPI header, used by libzpool's file vdevs.
+dnl # The rings are set up with the raw system calls, so no liburing needed.
+dnl #
+AC_DEFUN([ZFS_AC_CONFIG_USER_IO_URING], [
+	AC_CHECK_HEADERS([linux/io_uring.h])
+])
@@ -190,6 +190,24 @@ zfs_shani_available(void)
 	return (has_shani && __ymm_enabled());
 }
 
+/*
+ * Check if VAES instruction set is available
+ */
+static inline boolean_t
+zfs_vaes_available(void)
+{
+	return ((cpu_stdext_feature2 & CPUID_STDEXT2_VAES) != 0);
+}
+
+/*
+ * Check if VPCLMULQDQ instruction set is available
+ */
+static inline boolean_t
+zfs_vpclmulqdq_available(void)
+{
+	return ((cpu_stdext_feature2 & CPUID_STDEXT2_VPCLMULQDQ) != 0);
+}
+
 /*
  * AVX-512 family of instruction sets:
  *
@@ -81,6 +81,8 @@ extern "C" {
 #define	kpreempt_enable() critical_exit()
 #define	CPU_SEQID curcpu
 #define	CPU_SEQID_UNSTABLE curcpu
+#define	max_nnodes 1
+#define	CPU_NODEID_UNSTABLE 0
 #define	is_system_labeled()		0
 /*
  * Convert a single byte to/from binary-coded decimal (BCD).
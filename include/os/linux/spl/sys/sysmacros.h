@@ -28,6 +28,7 @@
 #include <linux/sched.h>
 #include <linux/sched/rt.h>
 #include <linux/cpumask.h>
+#include <linux/topology.h>
 #include <sys/debug.h>
 #include <sys/zone.h>
 #include <sys/signal.h>
@@ -77,6 +78,9 @@
 #define	boot_ncpus			num_online_cpus()
 #define	CPU_SEQID			smp_processor_id()
 #define	CPU_SEQID_UNSTABLE		raw_smp_processor_id()
+#define	max_nnodes			spl_cpu_nnodes
+#define	CPU_NODEID_UNSTABLE		\
+	spl_cpu_node_index(cpu_to_node(raw_smp_processor_id()))
 #define	is_system_labeled()		0
 
 #ifndef RLIM64_INFINITY
@@ -114,11 +118,14 @@
 
 /* Missing globals */
 extern unsigned long spl_hostid;
+extern unsigned int spl_cpu_nnodes;
 
 /* Missing misc functions */
 extern uint32_t zone_get_hostid(void *zone);
 extern void spl_setup(void);
 extern void spl_cleanup(void);
+extern int spl_cpu_node_index(int node);
+extern int spl_cpu_node_id(int index);
 
 /*
  * Only handles the first 4096 majors and first 256 minors. We don't have a
@@ -47,15 +47,19 @@
 extern "C" {
 #endif
 
+struct zfs_namecache;
+
 #if defined(HAVE_FILEMAP_RANGE_HAS_PAGE)
 #define	ZNODE_OS_FIELDS			\
 	inode_timespec_t z_btime; /* creation/birth time (cached) */ \
-	struct inode	z_inode;
+	struct inode	z_inode;                                     \
+	struct zfs_namecache *z_namecache; /* cached dir lookups */
 #else
 #define	ZNODE_OS_FIELDS			\
 	inode_timespec_t z_btime; /* creation/birth time (cached) */ \
 	struct inode	z_inode;                                     \
-	boolean_t	z_is_mapped;    /* we are mmap'ed */
+	boolean_t	z_is_mapped;    /* we are mmap'ed */         \
+	struct zfs_namecache *z_namecache; /* cached dir lookups */
 #endif
 
 /*
@@ -105,6 +105,7 @@ abd_t *abd_get_offset_struct(abd_t *, abd_t *, size_t, size_t);
 abd_t *abd_get_zeros(size_t);
 abd_t *abd_get_from_buf(void *, size_t);
 void abd_cache_reap_now(void);
+int abd_get_node(abd_t *);
 
 /*
  * Conversion to and from a normal buffer
@@ -174,6 +174,9 @@ typedef struct l1arc_buf_hdr {
 	uint32_t		b_mfu_hits;
 	uint32_t		b_mfu_ghost_hits;
 	uint32_t		b_bufcnt;
+	/* times decompressed, and whether the decompressed cache has it */
+	uint16_t		b_decompress_cnt;
+	uint8_t			b_dcached;
 	arc_buf_t		*b_buf;
 
 	/* self protecting */
@@ -912,6 +915,17 @@ typedef struct arc_stats {
 	kstat_named_t arcstat_raw_size;
 	kstat_named_t arcstat_cached_only_in_progress;
 	kstat_named_t arcstat_abd_chunk_waste_size;
+	/*
+	 * Number of times the decompressed block cache was able to supply
+	 * a decompressed buf for a compressed hdr, or wasn't and the data
+	 * had to be decompressed.
+	 */
+	kstat_named_t arcstat_dcache_hits;
+	kstat_named_t arcstat_dcache_misses;
+	/* Number of blocks evicted from the decompressed block cache. */
+	kstat_named_t arcstat_dcache_evictions;
+	/* Bytes held in the decompressed block cache. */
+	kstat_named_t arcstat_dcache_size;
 } arc_stats_t;
 
 typedef struct arc_sums {
@@ -1012,6 +1026,10 @@ typedef struct arc_sums {
 	wmsum_t arcstat_raw_size;
 	wmsum_t arcstat_cached_only_in_progress;
 	wmsum_t arcstat_abd_chunk_waste_size;
+	wmsum_t arcstat_dcache_hits;
+	wmsum_t arcstat_dcache_misses;
+	wmsum_t arcstat_dcache_evictions;
+	wmsum_t arcstat_dcache_size;
 } arc_sums_t;
 
 typedef struct arc_evict_waiter {
@@ -92,6 +92,18 @@ void Blake3_Final(const BLAKE3_CTX *ctx, uint8_t *out);
 void Blake3_FinalSeek(const BLAKE3_CTX *ctx, uint64_t seek, uint8_t *out,
     size_t out_len);
 
+/* init the context for a subtree of the input hashed by parent */
+void Blake3_SubtreeInit(BLAKE3_CTX *ctx, const BLAKE3_CTX *parent,
+    uint64_t chunk_counter);
+
+/* finalize the subtree and output its two top chaining values */
+void Blake3_SubtreeFinal(BLAKE3_CTX *ctx, uint64_t chunk_counter,
+    uint8_t cv_pair[2 * BLAKE3_OUT_LEN]);
+
+/* process a subtree hashed on its own in place of its input bytes */
+void Blake3_SubtreeAdd(BLAKE3_CTX *ctx,
+    const uint8_t cv_pair[2 * BLAKE3_OUT_LEN], size_t subtree_len);
+
 /* these are pre-allocated contexts */
 extern void **blake3_per_cpu_ctx;
 extern void blake3_per_cpu_ctx_init(void);
@@ -75,6 +75,14 @@ typedef struct CK_AES_GCM_PARAMS {
 	uchar_t *pAAD;
 	ulong_t ulAADLen;
 	ulong_t ulTagBits;
+	/*
+	 * Not part of PKCS#11: if set, called while encrypting with the
+	 * number of ciphertext bytes written to the output since the last
+	 * call, so the caller can consume them while they are still in
+	 * cache. The tag is not included. Leave NULL when unused.
+	 */
+	void (*pOutputCb)(void *, size_t);
+	void *pOutputCbArg;
 } CK_AES_GCM_PARAMS;
 
 /* CK_AES_GMAC_PARAMS provides parameters to the CKM_AES_GMAC mechanism */
@@ -39,6 +39,8 @@ typedef struct dataset_sum_stats_t {
 	wmsum_t dss_nread;
 	wmsum_t dss_nunlinks;
 	wmsum_t dss_nunlinked;
+	wmsum_t dss_namecache_hits;
+	wmsum_t dss_namecache_misses;
 } dataset_sum_stats_t;
 
 typedef struct dataset_kstat_values {
@@ -57,6 +59,12 @@ typedef struct dataset_kstat_values {
 	 * entry is removed from the unlinked set
 	 */
 	kstat_named_t dkv_nunlinked;
+	/*
+	 * Directory lookups answered from (hits) or missing (misses) the
+	 * ZPL's per-directory name cache
+	 */
+	kstat_named_t dkv_namecache_hits;
+	kstat_named_t dkv_namecache_misses;
 	/*
 	 * Per dataset zil kstats
 	 */
@@ -77,5 +85,6 @@ void dataset_kstats_update_read_kstats(dataset_kstats_t *, int64_t);
 
 void dataset_kstats_update_nunlinks_kstat(dataset_kstats_t *, int64_t);
 void dataset_kstats_update_nunlinked_kstat(dataset_kstats_t *, int64_t);
+void dataset_kstats_update_namecache_kstats(dataset_kstats_t *, boolean_t);
 
 #endif /* _SYS_DATASET_KSTATS_H */
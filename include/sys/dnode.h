@@ -368,6 +368,12 @@ struct dnode {
 
 	boolean_t dn_have_spill;	/* have spill or are spilling */
 
+	/*
+	 * compression=auto data blocks stored uncompressed in a row.  Only a
+	 * hint for zio_compress_auto(), so it is updated without a lock.
+	 */
+	uint8_t dn_compress_misses;
+
 	/* parent IO for current sync write */
 	zio_t *dn_zio;
 
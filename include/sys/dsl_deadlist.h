@@ -98,6 +98,8 @@ void dsl_deadlist_insert(dsl_deadlist_t *dl, const blkptr_t *bp,
     boolean_t free, dmu_tx_t *tx);
 int dsl_deadlist_insert_alloc_cb(void *arg, const blkptr_t *bp, dmu_tx_t *tx);
 int dsl_deadlist_insert_free_cb(void *arg, const blkptr_t *bp, dmu_tx_t *tx);
+void dsl_deadlist_insert_bplist(dsl_deadlist_t *dl, struct bplist *bpl,
+    boolean_t bp_freed, dmu_tx_t *tx);
 void dsl_deadlist_add_key(dsl_deadlist_t *dl, uint64_t mintxg, dmu_tx_t *tx);
 void dsl_deadlist_remove_key(dsl_deadlist_t *dl, uint64_t mintxg, dmu_tx_t *tx);
 void dsl_deadlist_remove_entry(dsl_deadlist_t *dl, uint64_t mintxg,
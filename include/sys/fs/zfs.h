@@ -363,6 +363,7 @@ typedef enum {
 	VDEV_PROP_CHECKSUM_T,
 	VDEV_PROP_IO_N,
 	VDEV_PROP_IO_T,
+	VDEV_PROP_POLL,
 	VDEV_NUM_PROPS
 } vdev_prop_t;
 
@@ -925,6 +926,12 @@ typedef struct zpool_load_policy {
 	"org.zfsonlinux:vdev_trim_partial"
 #define	VDEV_LEAF_ZAP_TRIM_SECURE	\
 	"org.zfsonlinux:vdev_trim_secure"
+#define	VDEV_LEAF_ZAP_TRIM_LATENCY	\
+	"org.openzfs:vdev_trim_latency"
+#define	VDEV_LEAF_ZAP_TRIM_THROUGHPUT	\
+	"org.openzfs:vdev_trim_throughput"
+#define	VDEV_LEAF_ZAP_TRIM_EXTENT_MIN	\
+	"org.openzfs:vdev_trim_extent_min"
 
 /*
  * This is needed in userland to report the minimum necessary device size.
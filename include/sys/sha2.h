@@ -53,6 +53,9 @@ extern "C" {
 #define	SHA256_HMAC_BLOCK_SIZE		64
 #define	SHA512_HMAC_BLOCK_SIZE		128
 
+/* most messages SHA2MultiBuffer() hashes side by side */
+#define	SHA2_MB_MAX_LANES		16
+
 /* sha256 context */
 typedef struct {
 	uint32_t state[8];
@@ -120,6 +123,13 @@ extern void SHA2Update(SHA2_CTX *ctx, const void *data, size_t len);
 /* SHA2 Final function */
 extern void SHA2Final(void *digest, SHA2_CTX *ctx);
 
+/* SHA2 multi-buffer function, digest[i] = SHA2(data[i], len[i]) */
+extern void SHA2MultiBuffer(int algotype, int n, const void *const data[],
+    const size_t len[], void *const digest[]);
+
+/* number of messages SHA2MultiBuffer() currently hashes side by side */
+extern int SHA2MultiBufferLanes(int algotype);
+
 #ifdef __cplusplus
 }
 #endif
@@ -185,6 +185,7 @@ typedef enum spa_proc_state {
 
 typedef struct spa_taskqs {
 	uint_t stqs_count;
+	uint_t stqs_nodes;	/* NUMA node groups, count is a multiple */
 	taskq_t **stqs_taskq;
 } spa_taskqs_t;
 
@@ -456,9 +457,11 @@ extern char *spa_config_path;
 extern const char *zfs_deadman_failmode;
 extern uint_t spa_slop_shift;
 extern void spa_taskq_dispatch_ent(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
-    task_func_t *func, void *arg, uint_t flags, taskq_ent_t *ent);
+    task_func_t *func, void *arg, uint_t flags, taskq_ent_t *ent, int node);
 extern void spa_taskq_dispatch_sync(spa_t *, zio_type_t t, zio_taskq_type_t q,
     task_func_t *func, void *arg, uint_t flags);
+extern void spa_taskq_stat_init(void);
+extern void spa_taskq_stat_fini(void);
 extern void spa_load_spares(spa_t *spa);
 extern void spa_load_l2cache(spa_t *spa);
 extern sysevent_t *spa_event_create(spa_t *spa, vdev_t *vd, nvlist_t *hist_nvl,
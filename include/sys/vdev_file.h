@@ -35,6 +35,9 @@ extern "C" {
 
 typedef struct vdev_file {
 	zfs_file_t	*vf_file;
+#ifndef _KERNEL
+	struct vdev_file_uring	*vf_uring;
+#endif
 } vdev_file_t;
 
 extern void vdev_file_init(void);
@@ -150,6 +150,8 @@ struct vdev_queue {
 	list_t		vq_active_list;	/* List of active I/Os. */
 	hrtime_t	vq_io_complete_ts; /* time last i/o completed */
 	hrtime_t	vq_io_delta_ts;
+	hrtime_t	vq_read_latency; /* moving average of read latency */
+	hrtime_t	vq_read_latency_ts; /* time it was last updated */
 	zio_t		vq_io_search; /* used as local for stack reduction */
 	kmutex_t	vq_lock;
 };
@@ -278,6 +280,7 @@ struct vdev {
 	uint64_t	vdev_noalloc;	/* device is passivated?	*/
 	uint64_t	vdev_removing;	/* device is being removed?	*/
 	uint64_t	vdev_failfast;	/* device failfast setting	*/
+	uint64_t	vdev_poll;	/* poll for sync I/O completion	*/
 	boolean_t	vdev_ishole;	/* is a hole in the namespace	*/
 	uint64_t	vdev_top_zap;
 	vdev_alloc_bias_t vdev_alloc_bias; /* metaslab allocation bias	*/
@@ -339,6 +342,13 @@ struct vdev {
 	kmutex_t	vdev_trim_io_lock;
 	kcondvar_t	vdev_trim_io_cv;
 	uint64_t	vdev_trim_inflight[3];
+	/* Device TRIM profile, also protected by vdev_trim_io_lock */
+	uint64_t	vdev_trim_latency;	/* avg TRIM latency (ns) */
+	uint64_t	vdev_trim_size;		/* avg TRIM size (bytes) */
+	uint64_t	vdev_trim_profile_ops;	/* TRIMs in the averages */
+	uint64_t	vdev_autotrim_extent_min; /* smallest auto TRIM */
+	uint64_t	vdev_autotrim_profile_ops; /* ... when last adjusted */
+	boolean_t	vdev_trim_profile_dirty; /* not yet in leaf ZAP */
 
 	/*
 	 * Values stored in the config for an indirect or removing vdev.
@@ -88,12 +88,25 @@ typedef struct vdev_indirect_mapping {
 	 */
 	vdev_indirect_mapping_entry_phys_t *vim_entries;
 
+	/*
+	 * A sparse index over vim_entries, holding the source offset of
+	 * every VIM_INDEX_STRIDE'th entry.  Lookups binary search this much
+	 * smaller (and cache resident) array first, and then only a single
+	 * stride of vim_entries.  NULL if the mapping is too small to need
+	 * it.
+	 */
+	uint64_t	*vim_index;
+	uint64_t	vim_index_count;
+
 	objset_t	*vim_objset;
 
 	dmu_buf_t	*vim_dbuf;
 	vdev_indirect_mapping_phys_t	*vim_phys;
 } vdev_indirect_mapping_t;
 
+#define	VIM_INDEX_SHIFT		6
+#define	VIM_INDEX_STRIDE	(1ULL << VIM_INDEX_SHIFT)
+
 extern vdev_indirect_mapping_t *vdev_indirect_mapping_open(objset_t *os,
     uint64_t object);
 extern void vdev_indirect_mapping_close(vdev_indirect_mapping_t *vim);
@@ -48,6 +48,9 @@ void vdev_raidz_map_free(struct raidz_map *);
 void vdev_raidz_generate_parity_row(struct raidz_map *, struct raidz_row *);
 void vdev_raidz_generate_parity(struct raidz_map *);
 void vdev_raidz_reconstruct(struct raidz_map *, const int *, int);
+typedef boolean_t vdev_raidz_verify_f(struct raidz_map *, void *);
+int vdev_raidz_combrec_map(struct raidz_map *, int, int, const int *,
+    vdev_raidz_verify_f *, void *);
 void vdev_raidz_child_done(zio_t *);
 void vdev_raidz_io_done(zio_t *);
 void vdev_raidz_checksum_error(zio_t *, struct raidz_col *, abd_t *);
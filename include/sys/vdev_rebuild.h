@@ -75,6 +75,14 @@ typedef struct vdev_rebuild {
 	uint64_t	vr_bytes_inflight_max;	/* maximum bytes inflight */
 	uint64_t	vr_bytes_inflight;	/* current bytes inflight */
 
+	/* Per-child state of a dRAID rebuild, indexed by child id */
+	uint64_t	vr_children;		/* 0 unless rebuilding dRAID */
+	uint64_t	*vr_child_inflight;	/* current bytes inflight */
+	uint64_t	*vr_child_inflight_max;	/* maximum bytes inflight */
+	uint64_t	*vr_child_issued;	/* bytes issued this pass */
+	kstat_named_t	*vr_child_stats;	/* per-child kstat data */
+	kstat_t		*vr_child_ksp;		/* per-child kstat */
+
 	/* Per-rebuild pass statistics for calculating bandwidth */
 	uint64_t	vr_pass_start_time;
 	uint64_t	vr_pass_bytes_scanned;
@@ -41,6 +41,9 @@ extern "C" {
 void chksum_init(void);
 void chksum_fini(void);
 
+/* Fewest blocks worth hashing with the multi-buffer SHA2 implementations */
+int chksum_sha2_mb_min(int algotype);
+
 #ifdef	__cplusplus
 }
 #endif
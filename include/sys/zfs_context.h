@@ -498,6 +498,8 @@ extern taskq_t	*taskq_create(const char *, int, pri_t, int, int, uint_t);
 	    (taskq_create(a, b, c, d, e, f))
 #define	taskq_create_sysdc(a, b, d, e, p, dc, f) \
 	    ((void) sizeof (dc), taskq_create(a, b, maxclsyspri, d, e, f))
+#define	taskq_create_node(a, b, c, d, e, n, f) \
+	    ((void) (n), taskq_create(a, b, c, d, e, f))
 extern taskqid_t taskq_dispatch(taskq_t *, task_func_t, void *, uint_t);
 extern taskqid_t taskq_dispatch_delay(taskq_t *, task_func_t, void *, uint_t,
     clock_t);
@@ -623,6 +625,8 @@ extern void delay(clock_t ticks);
 
 #define	CPU_SEQID	((uintptr_t)pthread_self() & (max_ncpus - 1))
 #define	CPU_SEQID_UNSTABLE	CPU_SEQID
+#define	max_nnodes	1
+#define	CPU_NODEID_UNSTABLE	0
 
 #define	kcred		NULL
 #define	CRED()		NULL
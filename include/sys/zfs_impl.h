@@ -61,6 +61,8 @@ extern const zfs_impl_t *zfs_impl_get_ops(const char *algo);
 extern const zfs_impl_t zfs_blake3_ops;
 extern const zfs_impl_t zfs_sha256_ops;
 extern const zfs_impl_t zfs_sha512_ops;
+extern const zfs_impl_t zfs_sha256_mb_ops;
+extern const zfs_impl_t zfs_sha512_mb_ops;
 
 #ifdef	__cplusplus
 }
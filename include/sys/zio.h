@@ -347,6 +347,7 @@ typedef struct zio_prop {
 	boolean_t		zp_dedup_verify;
 	boolean_t		zp_nopwrite;
 	boolean_t		zp_brtwrite;
+	boolean_t		zp_incompressible;
 	boolean_t		zp_encrypt;
 	boolean_t		zp_byteorder;
 	uint8_t			zp_salt[ZIO_DATA_SALT_LEN];
@@ -451,6 +452,7 @@ struct zio {
 	int		io_cmd;
 	zio_priority_t	io_priority;
 	uint8_t		io_reexecute;
+	uint8_t		io_complevel;	/* level a write was compressed at */
 	uint8_t		io_state[ZIO_WAIT_TYPES];
 	uint64_t	io_txg;
 	spa_t		*io_spa;
@@ -515,6 +517,7 @@ struct zio {
 	zio_gang_node_t	*io_gang_tree;
 	void		*io_executor;
 	void		*io_waiter;
+	struct zio_offload_req *io_offload;	/* see zio_offload.h */
 	void		*io_bio;
 	kmutex_t	io_lock;
 	kcondvar_t	io_cv;
@@ -639,6 +642,7 @@ extern void zio_vdev_io_redone(zio_t *zio);
 extern void zio_change_priority(zio_t *pio, zio_priority_t priority);
 
 extern void zio_checksum_verified(zio_t *zio);
+extern boolean_t zio_checksum_pending(zio_t *zio);
 extern int zio_worst_error(int e1, int e2);
 
 extern enum zio_checksum zio_checksum_select(enum zio_checksum child,
@@ -649,6 +653,9 @@ extern enum zio_compress zio_compress_select(spa_t *spa,
     enum zio_compress child, enum zio_compress parent);
 extern uint8_t zio_complevel_select(spa_t *spa, enum zio_compress compress,
     uint8_t child, uint8_t parent);
+extern size_t zio_compress_auto(spa_t *spa, abd_t *src, void **dst,
+    size_t s_len, boolean_t stable, boolean_t incompressible, uint64_t blkid,
+    enum zio_compress *compress, uint8_t *level);
 
 extern void zio_suspend(spa_t *spa, zio_t *zio, zio_suspend_reason_t);
 extern int zio_resume(spa_t *spa);
@@ -111,6 +111,13 @@ _SYS_ZIO_CHECKSUM_H zio_checksum_info_t
 extern zio_checksum_t abd_checksum_sha256;
 extern zio_checksum_t abd_checksum_sha512_native;
 extern zio_checksum_t abd_checksum_sha512_byteswap;
+extern int abd_checksum_sha2_lanes(enum zio_checksum);
+
+/* Most blocks abd_checksum_sha2_multi() takes in one call */
+#define	ZIO_CHECKSUM_MULTI_MAX	16
+
+extern void abd_checksum_sha2_multi(enum zio_checksum, int,
+    struct abd *const [], const uint64_t [], zio_cksum_t []);
 
 /* Skein */
 extern zio_checksum_t abd_checksum_skein_native;
@@ -127,18 +134,44 @@ extern zio_checksum_tmpl_free_t abd_checksum_edonr_tmpl_free;
 /* BLAKE3 */
 extern zio_checksum_t abd_checksum_blake3_native;
 extern zio_checksum_t abd_checksum_blake3_byteswap;
+extern zio_checksum_t abd_checksum_blake3_serial;
 extern zio_checksum_tmpl_init_t abd_checksum_blake3_tmpl_init;
 extern zio_checksum_tmpl_free_t abd_checksum_blake3_tmpl_free;
+extern void abd_checksum_blake3_init(void);
+extern void abd_checksum_blake3_fini(void);
 
 /* Fletcher 4 */
 _SYS_ZIO_CHECKSUM_H zio_abd_checksum_func_t fletcher_4_abd_ops;
 extern zio_checksum_t abd_fletcher_4_native;
 extern zio_checksum_t abd_fletcher_4_byteswap;
 
+/*
+ * State for a block checksum computed incrementally while the block's data
+ * is being produced, rather than in a separate pass over it afterwards.
+ */
+typedef struct zio_cksum_stream {
+	enum zio_checksum	zcs_checksum;
+	uint64_t		zcs_size;	/* bytes consumed so far */
+	zio_cksum_t		zcs_fletcher;
+	void			*zcs_blake3;	/* BLAKE3_CTX */
+} zio_cksum_stream_t;
+
+extern boolean_t zio_checksum_stream_init(zio_cksum_stream_t *, spa_t *,
+    enum zio_checksum);
+extern void zio_checksum_stream_update(void *, const uint8_t *, size_t);
+extern boolean_t zio_checksum_stream_done(zio_t *, zio_cksum_stream_t *);
+extern void zio_checksum_stream_abort(zio_cksum_stream_t *);
+
 extern int zio_checksum_equal(spa_t *, blkptr_t *, enum zio_checksum,
     void *, uint64_t, uint64_t, zio_bad_cksum_t *);
 extern void zio_checksum_compute(zio_t *, enum zio_checksum,
     struct abd *, uint64_t);
+extern void zio_checksum_compute_raw(spa_t *, enum zio_checksum,
+    struct abd *, uint64_t, zio_cksum_t *);
+extern void zio_checksum_apply(zio_t *, enum zio_checksum, zio_cksum_t *);
+extern int zio_checksum_multi_lanes(enum zio_checksum);
+extern void zio_checksum_compute_multi(zio_t *const [], int,
+    enum zio_checksum);
 extern int zio_checksum_error_impl(spa_t *, const blkptr_t *, enum zio_checksum,
     struct abd *, uint64_t, uint64_t, zio_bad_cksum_t *);
 extern int zio_checksum_error(zio_t *zio, zio_bad_cksum_t *out);
@@ -114,10 +114,16 @@ enum zio_zstd_levels {
 	ZIO_ZSTD_LEVEL_FAST_500,
 	ZIO_ZSTD_LEVEL_FAST_1000,
 #define	ZIO_ZSTD_LEVEL_FAST_MAX	ZIO_ZSTD_LEVEL_FAST_1000
-	ZIO_ZSTD_LEVEL_AUTO = 251, /* Reserved for future use */
+	ZIO_ZSTD_LEVEL_AUTO = 251, /* compression=auto, chosen per block */
 	ZIO_ZSTD_LEVEL_LEVELS
 };
 
+/*
+ * After this many compression=auto blocks of an object in a row were stored
+ * uncompressed, zio_compress_auto() only samples the object's blocks.
+ */
+#define	ZIO_COMPRESS_AUTO_MISSES	8
+
 /* Forward Declaration to avoid visibility problems */
 struct zio_prop;
 
@@ -135,12 +141,16 @@ typedef int zio_getlevel_func_t(void *src, size_t s_len, uint8_t *level);
 
 
 /*
- * Common signature for all zio decompress functions using an ABD as input.
+ * Common signature for all zio decompress functions using an ABD as input,
+ * which also return the stored level if the algorithm has one.
  * This is helpful if you have both compressed ARC and scatter ABDs enabled,
  * but is not a requirement for all compression algorithms.
+ * There is deliberately no compress counterpart: zstd's streaming
+ * compressor copies its input into an internal window anyway, so it would
+ * save nothing over linearizing the source.
  */
 typedef int zio_decompress_abd_func_t(abd_t *src, void *dst,
-    size_t s_len, size_t d_len, int);
+    size_t s_len, size_t d_len, uint8_t *level);
 /*
  * Information about each compression function.
  */
@@ -150,6 +160,7 @@ typedef const struct zio_compress_info {
 	zio_compress_func_t		*ci_compress;
 	zio_decompress_func_t		*ci_decompress;
 	zio_decompresslevel_func_t	*ci_decompress_level;
+	zio_decompress_abd_func_t	*ci_decompress_abd;
 } zio_compress_info_t;
 
 extern zio_compress_info_t zio_compress_table[ZIO_COMPRESS_FUNCTIONS];
@@ -160,6 +171,12 @@ extern zio_compress_info_t zio_compress_table[ZIO_COMPRESS_FUNCTIONS];
 extern void lz4_init(void);
 extern void lz4_fini(void);
 
+/*
+ * compression=auto state init & free
+ */
+extern void zio_compress_init(void);
+extern void zio_compress_fini(void);
+
 /*
  * Compression routines.
  */
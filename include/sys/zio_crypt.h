@@ -119,6 +119,20 @@ typedef struct zio_crypt_key {
 	krwlock_t zk_salt_lock;
 } zio_crypt_key_t;
 
+/*
+ * Consumer of the ciphertext written by zio_do_crypt_data(). If the cipher
+ * implementation supports it, zsk_func is called with consecutive pieces of
+ * the output as they are produced, while they are still in cache. Callers
+ * must compare zsk_done with the data length to see whether all of the
+ * ciphertext was passed, and fall back to another pass over it if not.
+ */
+typedef struct zio_crypt_sink {
+	void		(*zsk_func)(void *, const uint8_t *, size_t);
+	void		*zsk_arg;
+	uint8_t		*zsk_buf;
+	uint64_t	zsk_done;
+} zio_crypt_sink_t;
+
 void zio_crypt_key_destroy(zio_crypt_key_t *key);
 int zio_crypt_key_init(uint64_t crypt, zio_crypt_key_t *key);
 int zio_crypt_key_get_salt(zio_crypt_key_t *key, uint8_t *salt_out);
@@ -151,7 +165,7 @@ int zio_crypt_do_objset_hmacs(zio_crypt_key_t *key, void *data, uint_t datalen,
 int zio_do_crypt_data(boolean_t encrypt, zio_crypt_key_t *key,
     dmu_object_type_t ot, boolean_t byteswap, uint8_t *salt, uint8_t *iv,
     uint8_t *mac, uint_t datalen, uint8_t *plainbuf, uint8_t *cipherbuf,
-    boolean_t *no_crypt);
+    boolean_t *no_crypt, zio_crypt_sink_t *sink);
 int zio_do_crypt_abd(boolean_t encrypt, zio_crypt_key_t *key,
     dmu_object_type_t ot, boolean_t byteswap, uint8_t *salt, uint8_t *iv,
     uint8_t *mac, uint_t datalen, abd_t *pabd, abd_t *cabd,
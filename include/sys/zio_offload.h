@@ -0,0 +1,121 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+#ifndef _SYS_ZIO_OFFLOAD_H
+#define	_SYS_ZIO_OFFLOAD_H
+
+#include <sys/zio.h>
+#include <sys/zio_checksum.h>
+#include <sys/zio_compress.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * Asynchronous offload of zio pipeline work to accelerators.
+ *
+ * A pipeline stage that can hand its work off asks zio_offload_req_alloc()
+ * for a request, which only succeeds if a registered provider accepts the
+ * work, fills in its inputs and passes it to zio_offload_submit().  Requests
+ * are handed to providers in batches: while one thread is submitting to a
+ * provider, requests for it from other threads queue up and are passed
+ * along together once it's done.  The provider completes each request, from
+ * any context, by calling zio_offload_done(), which calls the callback given
+ * to zio_offload_submit().
+ *
+ * A request that fails is completed with an error and redone by the stage on
+ * the CPU, so providers are free to give up on anything they can't handle.
+ */
+
+typedef enum zio_offload_op {
+	ZIO_OFFLOAD_CHECKSUM,	/* checksum zor_abd into zor_cksum */
+	ZIO_OFFLOAD_COMPRESS,	/* compress zor_abd into zor_dst */
+	ZIO_OFFLOAD_OPS
+} zio_offload_op_t;
+
+typedef struct zio_offload_req zio_offload_req_t;
+
+typedef void zio_offload_done_f(zio_offload_req_t *);
+
+struct zio_offload_req {
+	zio_offload_op_t	zor_op;
+	zio_t			*zor_zio;
+	abd_t			*zor_abd;	/* input data */
+	uint64_t		zor_size;	/* input size */
+
+	/*
+	 * ZIO_OFFLOAD_CHECKSUM: the checksum function's own result, as
+	 * zio_checksum_compute_raw() returns it.
+	 */
+	enum zio_checksum	zor_checksum;
+	zio_cksum_t		zor_cksum;
+
+	/*
+	 * ZIO_OFFLOAD_COMPRESS: zor_dst is a zio_buf with room for zor_size
+	 * bytes, and zor_psize is set the way zio_compress_data() returns it.
+	 */
+	enum zio_compress	zor_compress;
+	uint8_t			zor_level;
+	void			*zor_dst;
+	uint64_t		zor_psize;
+
+	int			zor_error;
+
+	/* Framework and provider state */
+	zio_offload_done_f	*zor_done;
+	struct zio_offload_provider *zor_provider;
+	list_node_t		zor_node;
+	taskq_ent_t		zor_ent;
+};
+
+typedef struct zio_offload_ops {
+	const char	*zoo_name;
+	/*
+	 * Whether the provider takes work of the given kind, algorithm
+	 * (enum zio_checksum or enum zio_compress) and size.  Called for
+	 * every block, so it must be cheap, and must not block.
+	 */
+	boolean_t	(*zoo_accepts)(zio_offload_op_t, uint_t, uint64_t);
+	/*
+	 * Start working on a batch of requests, and call zio_offload_done()
+	 * for each of them when it is finished, possibly before returning.
+	 */
+	void		(*zoo_submit)(zio_offload_req_t *const *, int);
+} zio_offload_ops_t;
+
+extern void zio_offload_register(const zio_offload_ops_t *);
+extern void zio_offload_unregister(const zio_offload_ops_t *);
+
+extern zio_offload_req_t *zio_offload_req_alloc(zio_t *, zio_offload_op_t,
+    uint_t, abd_t *, uint64_t);
+extern void zio_offload_req_free(zio_offload_req_t *);
+extern void zio_offload_submit(zio_offload_req_t *, zio_offload_done_f *);
+extern void zio_offload_done(zio_offload_req_t *, int);
+
+extern void zio_offload_init(void);
+extern void zio_offload_fini(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _SYS_ZIO_OFFLOAD_H */
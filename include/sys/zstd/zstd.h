@@ -97,6 +97,9 @@ size_t zfs_zstd_compress_wrap(void *s_start, void *d_start, size_t s_len,
 int zfs_zstd_get_level(void *s_start, size_t s_len, uint8_t *level);
 int zfs_zstd_decompress_level(void *s_start, void *d_start, size_t s_len,
     size_t d_len, uint8_t *level);
+struct abd;
+int zfs_zstd_decompress_level_abd(struct abd *src, void *d_start,
+    size_t s_len, size_t d_len, uint8_t *level);
 int zfs_zstd_decompress(void *s_start, void *d_start, size_t s_len,
     size_t d_len, int n);
 void zfs_zstd_cache_reap_now(void);
@@ -81,6 +81,7 @@ typedef enum spa_feature {
 	SPA_FEATURE_BLOCK_CLONING,
 	SPA_FEATURE_AVZ_V2,
 	SPA_FEATURE_REDACTION_LIST_SPILL,
+	SPA_FEATURE_COMPRESS_AUTO,
 	SPA_FEATURES
 } spa_feature_t;
 
@@ -274,6 +274,7 @@ typedef struct send_data {
 	 *	 "snapholds" -> { name (lastname) -> { holdname -> crtime } }
 	 *
 	 *	 "origin" -> number (guid) (if clone)
+	 *	 "compress_auto" -> boolean (if compression=auto)
 	 *	 "is_encroot" -> boolean
 	 *	 "sent" -> boolean (not on-disk)
 	 *	}
@@ -568,8 +569,24 @@ send_iterate_fs(zfs_handle_t *zhp, void *arg)
 
 	/* Iterate over props. */
 	if (sd->props || sd->backup || sd->recursive) {
+		uint64_t compress;
+
 		nv = fnvlist_alloc();
 		send_iterate_prop(zhp, sd->backup, nv);
+
+		/*
+		 * Receivers without the compress_auto feature don't know
+		 * this level, so send plain zstd and let receivers that do
+		 * know it restore auto from "compress_auto".
+		 */
+		if (nvlist_lookup_uint64(nv,
+		    zfs_prop_to_name(ZFS_PROP_COMPRESSION), &compress) == 0 &&
+		    ZIO_COMPRESS_LEVEL(compress) == ZIO_ZSTD_LEVEL_AUTO) {
+			fnvlist_add_uint64(nv,
+			    zfs_prop_to_name(ZFS_PROP_COMPRESSION),
+			    ZIO_COMPRESS_ZSTD);
+			fnvlist_add_boolean(nvfs, "compress_auto");
+		}
 		fnvlist_add_nvlist(nvfs, "props", nv);
 	}
 	if (zfs_prop_get_int(zhp, ZFS_PROP_ENCRYPTION) != ZIO_CRYPT_OFF) {
@@ -4388,6 +4405,32 @@ error:
 	return (ret);
 }
 
+/*
+ * compression=auto is sent as plain zstd (see send_iterate_fs()), and only
+ * restored when the receiving pool can store it.
+ */
+static boolean_t
+recv_compress_auto_enabled(libzfs_handle_t *hdl, const char *name)
+{
+	char poolname[ZFS_MAX_DATASET_NAME_LEN];
+	char state[ZFS_MAXPROPLEN];
+	zpool_handle_t *zhp;
+	boolean_t enabled = B_FALSE;
+
+	(void) strlcpy(poolname, name, sizeof (poolname));
+	poolname[strcspn(poolname, "/@")] = '\0';
+
+	if ((zhp = zpool_open_canfail(hdl, poolname)) == NULL)
+		return (B_FALSE);
+
+	if (zpool_prop_get_feature(zhp, "feature@compress_auto", state,
+	    sizeof (state)) == 0 && strcmp(state, ZFS_FEATURE_DISABLED) != 0)
+		enabled = B_TRUE;
+
+	zpool_close(zhp);
+	return (enabled);
+}
+
 /*
  * Restores a backup of tosnap from the file descriptor specified by infd.
  */
@@ -4458,6 +4501,11 @@ zfs_receive_one(libzfs_handle_t *hdl, int infd, const char *tosnap,
 		if (err) {
 			rcvprops = fnvlist_alloc();
 			newprops = B_TRUE;
+		} else if (nvlist_exists(fs, "compress_auto") &&
+		    recv_compress_auto_enabled(hdl, tosnap)) {
+			fnvlist_add_uint64(rcvprops,
+			    zfs_prop_to_name(ZFS_PROP_COMPRESSION),
+			    ZIO_COMPLEVEL_ZSTD(ZIO_ZSTD_LEVEL_AUTO));
 		}
 
 		/*
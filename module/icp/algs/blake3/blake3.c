@@ -449,9 +449,9 @@ static void hasher_init_base(BLAKE3_CTX *ctx, const uint32_t key[8],
  * remain in the stack is represented by a 1-bit in the total number of chunks
  * (or bytes) so far.
  */
-static void hasher_merge_cv_stack(BLAKE3_CTX *ctx, uint64_t total_len)
+static void hasher_merge_cv_stack_to(BLAKE3_CTX *ctx,
+    size_t post_merge_stack_len)
 {
-	size_t post_merge_stack_len = (size_t)popcnt(total_len);
 	while (ctx->cv_stack_len > post_merge_stack_len) {
 		uint8_t *parent_node =
 		    &ctx->cv_stack[(ctx->cv_stack_len - 2) * BLAKE3_OUT_LEN];
@@ -462,6 +462,11 @@ static void hasher_merge_cv_stack(BLAKE3_CTX *ctx, uint64_t total_len)
 	}
 }
 
+static void hasher_merge_cv_stack(BLAKE3_CTX *ctx, uint64_t total_len)
+{
+	hasher_merge_cv_stack_to(ctx, (size_t)popcnt(total_len));
+}
+
 /*
  * In reference_impl.rs, we merge the new CV with existing CVs from the stack
  * before pushing it. We can do that because we know more input is coming, so
@@ -674,6 +679,69 @@ Blake3_Update(BLAKE3_CTX *ctx, const void *input, size_t todo)
 	}
 }
 
+/*
+ * Subtrees let several threads hash one input together.  The input is cut
+ * into subtrees of a power-of-2 number of chunks (at least 2), each starting
+ * at a chunk_counter that is a multiple of its size.  Each one is hashed into
+ * a pair of chaining values on its own context with Blake3_SubtreeInit(),
+ * Blake3_Update() and Blake3_SubtreeFinal(), and the pairs are then added in
+ * order to the context hashing the whole input with Blake3_SubtreeAdd(), as
+ * if Blake3_Update() had hashed the subtrees itself.
+ *
+ * Cutting the subtree out of the middle of the tree only changes which CVs
+ * are still on the stack: one for every bit set in chunk_counter, which the
+ * subtree context never merges as all of its own chunks are counted in the
+ * bits below.  They are accounted for without being filled in.
+ */
+void
+Blake3_SubtreeInit(BLAKE3_CTX *ctx, const BLAKE3_CTX *parent,
+    uint64_t chunk_counter)
+{
+	memcpy(ctx->key, parent->key, BLAKE3_KEY_LEN);
+	chunk_state_init(&ctx->chunk, parent->key, parent->chunk.flags);
+	ctx->chunk.chunk_counter = chunk_counter;
+	ctx->cv_stack_len = (uint8_t)popcnt(chunk_counter);
+	ctx->ops = parent->ops;
+}
+
+void
+Blake3_SubtreeFinal(BLAKE3_CTX *ctx, uint64_t chunk_counter,
+    uint8_t cv_pair[2 * BLAKE3_OUT_LEN])
+{
+	size_t base = (size_t)popcnt(chunk_counter);
+
+	/* The last chunk is still in the chunk state if it came in alone. */
+	if (chunk_state_len(&ctx->chunk) > 0) {
+		output_t output = chunk_state_output(&ctx->chunk);
+		output_chaining_value(ctx->ops, &output,
+		    &ctx->cv_stack[ctx->cv_stack_len * BLAKE3_OUT_LEN]);
+		ctx->cv_stack_len += 1;
+	}
+
+	/* Roll up everything but the two halves of the subtree. */
+	hasher_merge_cv_stack_to(ctx, base + 2);
+	memcpy(cv_pair, &ctx->cv_stack[base * BLAKE3_OUT_LEN],
+	    2 * BLAKE3_OUT_LEN);
+}
+
+void
+Blake3_SubtreeAdd(BLAKE3_CTX *ctx, const uint8_t cv_pair[2 * BLAKE3_OUT_LEN],
+    size_t subtree_len)
+{
+	uint64_t subtree_chunks = subtree_len / BLAKE3_CHUNK_LEN;
+	uint8_t cv[BLAKE3_OUT_LEN];
+
+	ASSERT0(chunk_state_len(&ctx->chunk));
+	ASSERT0(ctx->chunk.chunk_counter & (subtree_chunks - 1));
+
+	memcpy(cv, cv_pair, BLAKE3_OUT_LEN);
+	hasher_push_cv(ctx, cv, ctx->chunk.chunk_counter);
+	memcpy(cv, &cv_pair[BLAKE3_OUT_LEN], BLAKE3_OUT_LEN);
+	hasher_push_cv(ctx, cv,
+	    ctx->chunk.chunk_counter + (subtree_chunks / 2));
+	ctx->chunk.chunk_counter += subtree_chunks;
+}
+
 void
 Blake3_Final(const BLAKE3_CTX *ctx, uint8_t *out)
 {
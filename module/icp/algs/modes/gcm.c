@@ -45,6 +45,8 @@
 #define	IMPL_CYCLE	(UINT32_MAX-1)
 #ifdef CAN_USE_GCM_ASM
 #define	IMPL_AVX	(UINT32_MAX-2)
+#define	IMPL_VAES_AVX2	(UINT32_MAX-3)
+#define	IMPL_VAES_AVX512	(UINT32_MAX-4)
 #endif
 #define	GCM_IMPL_READ(i) (*(volatile uint32_t *) &(i))
 static uint32_t icp_gcm_impl = IMPL_FASTEST;
@@ -64,13 +66,23 @@ boolean_t gcm_avx_can_use_movbe = B_FALSE;
  */
 static boolean_t gcm_use_avx = B_FALSE;
 #define	GCM_IMPL_USE_AVX	(*(volatile boolean_t *)&gcm_use_avx)
+/*
+ * Which bulk routines the avx implementation uses, see gcm_vaes_t.  Set
+ * by icp_gcm_impl == "vaes-avx2", "vaes-avx512" or "fastest".
+ */
+static uint32_t gcm_vaes = GCM_VAES_NONE;
+#define	GCM_IMPL_VAES	(*(volatile uint32_t *)&gcm_vaes)
 
 extern boolean_t ASMABI atomic_toggle_boolean_nv(volatile boolean_t *);
 
 static inline boolean_t gcm_avx_will_work(void);
+static inline boolean_t gcm_vaes_will_work(gcm_vaes_t);
+static inline gcm_vaes_t gcm_impl_vaes(uint32_t);
 static inline void gcm_set_avx(boolean_t);
+static inline void gcm_set_vaes(gcm_vaes_t);
 static inline boolean_t gcm_toggle_avx(void);
-static inline size_t gcm_simd_get_htab_size(boolean_t);
+static inline gcm_vaes_t gcm_cycle_vaes(void);
+static inline size_t gcm_simd_get_htab_size(boolean_t, gcm_vaes_t);
 
 static int gcm_mode_encrypt_contiguous_blocks_avx(gcm_ctx_t *, char *, size_t,
     crypto_data_t *, size_t);
@@ -81,6 +93,27 @@ static int gcm_init_avx(gcm_ctx_t *, const uint8_t *, size_t, const uint8_t *,
     size_t, size_t);
 #endif /* ifdef CAN_USE_GCM_ASM */
 
+/*
+ * The generic encrypt path reports ciphertext to gcm_output_cb in pieces of
+ * about this size, so that it is still in cache when the caller reads it.
+ */
+#define	GCM_OUTPUT_CB_BYTES	(32 * 1024)
+
+/*
+ * Report the ciphertext written since the last call to gcm_output_cb, if the
+ * caller asked for it. Must not be called with the FPU "locked".
+ */
+static inline void
+gcm_output_notify(gcm_ctx_t *ctx)
+{
+	size_t len = ctx->gcm_processed_data_len - ctx->gcm_output_cb_len;
+
+	if (ctx->gcm_output_cb != NULL && len > 0) {
+		ctx->gcm_output_cb(ctx->gcm_output_cb_arg, len);
+		ctx->gcm_output_cb_len = ctx->gcm_processed_data_len;
+	}
+}
+
 /*
  * Encrypt multiple blocks of data in GCM mode.  Decrypt for GCM mode
  * is done in another function.
@@ -180,6 +213,10 @@ gcm_mode_encrypt_contiguous_blocks(gcm_ctx_t *ctx, char *data, size_t length,
 		/* add ciphertext to the hash */
 		GHASH(ctx, ctx->gcm_tmp, ctx->gcm_ghash, gops);
 
+		if (ctx->gcm_processed_data_len - ctx->gcm_output_cb_len >=
+		    GCM_OUTPUT_CB_BYTES)
+			gcm_output_notify(ctx);
+
 		/* Update pointer to next block of data to be processed. */
 		if (ctx->gcm_remainder_len != 0) {
 			datap += need;
@@ -201,6 +238,7 @@ gcm_mode_encrypt_contiguous_blocks(gcm_ctx_t *ctx, char *data, size_t length,
 
 	} while (remainder > 0);
 out:
+	gcm_output_notify(ctx);
 	return (CRYPTO_SUCCESS);
 }
 
@@ -278,6 +316,7 @@ gcm_encrypt_final(gcm_ctx_t *ctx, crypto_data_t *out, size_t block_size,
 	}
 	out->cd_offset += ctx->gcm_remainder_len;
 	ctx->gcm_remainder_len = 0;
+	gcm_output_notify(ctx);
 	rv = crypto_put_output_data(ghash, out, ctx->gcm_tag_len);
 	if (rv != CRYPTO_SUCCESS)
 		return (rv);
@@ -645,6 +684,10 @@ gcm_init_ctx_impl(boolean_t gmac_mode, gcm_ctx_t *gcm_ctx, char *param,
 			size_t tbits = gcm_param->ulTagBits;
 			tag_len = CRYPTO_BITS2BYTES(tbits);
 			iv_len = gcm_param->ulIvLen;
+
+			gcm_ctx->gcm_output_cb = gcm_param->pOutputCb;
+			gcm_ctx->gcm_output_cb_arg = gcm_param->pOutputCbArg;
+			gcm_ctx->gcm_output_cb_len = 0;
 		} else {
 			/* GMAC mode. */
 			gcm_ctx->gcm_flags |= GMAC_MODE;
@@ -671,12 +714,16 @@ gcm_init_ctx_impl(boolean_t gmac_mode, gcm_ctx_t *gcm_ctx, char *param,
 
 	if (GCM_IMPL_READ(icp_gcm_impl) != IMPL_CYCLE) {
 		gcm_ctx->gcm_use_avx = GCM_IMPL_USE_AVX;
+		gcm_ctx->gcm_vaes = GCM_IMPL_VAES;
 	} else {
 		/*
 		 * Handle the "cycle" implementation by creating avx and
-		 * non-avx contexts alternately.
+		 * non-avx contexts alternately, and cycling through the
+		 * bulk routines of the avx ones.
 		 */
 		gcm_ctx->gcm_use_avx = gcm_toggle_avx();
+		gcm_ctx->gcm_vaes = gcm_ctx->gcm_use_avx ?
+		    gcm_cycle_vaes() : GCM_VAES_NONE;
 
 		/* The avx impl. doesn't handle byte swapped key schedules. */
 		if (gcm_ctx->gcm_use_avx == B_TRUE && needs_bswap == B_TRUE) {
@@ -714,7 +761,8 @@ gcm_init_ctx_impl(boolean_t gmac_mode, gcm_ctx_t *gcm_ctx, char *param,
 
 	/* Allocate Htab memory as needed. */
 	if (gcm_ctx->gcm_use_avx == B_TRUE) {
-		size_t htab_len = gcm_simd_get_htab_size(gcm_ctx->gcm_use_avx);
+		size_t htab_len = gcm_simd_get_htab_size(gcm_ctx->gcm_use_avx,
+		    gcm_ctx->gcm_vaes);
 
 		if (htab_len == 0) {
 			return (CRYPTO_MECHANISM_PARAM_INVALID);
@@ -819,6 +867,8 @@ gcm_impl_get_ops(void)
 		break;
 #ifdef CAN_USE_GCM_ASM
 	case IMPL_AVX:
+	case IMPL_VAES_AVX2:
+	case IMPL_VAES_AVX512:
 		/*
 		 * Make sure that we return a valid implementation while
 		 * switching to the avx implementation since there still
@@ -888,6 +938,7 @@ gcm_impl_init(void)
 #endif
 		if (GCM_IMPL_READ(user_sel_impl) == IMPL_FASTEST) {
 			gcm_set_avx(B_TRUE);
+			gcm_set_vaes(gcm_impl_vaes(IMPL_FASTEST));
 		}
 	}
 #endif
@@ -904,6 +955,8 @@ static const struct {
 		{ "fastest",	IMPL_FASTEST },
 #ifdef CAN_USE_GCM_ASM
 		{ "avx",	IMPL_AVX },
+		{ "vaes-avx2",	IMPL_VAES_AVX2 },
+		{ "vaes-avx512", IMPL_VAES_AVX512 },
 #endif
 };
 
@@ -939,10 +992,14 @@ gcm_impl_set(const char *val)
 	/* Check mandatory options */
 	for (i = 0; i < ARRAY_SIZE(gcm_impl_opts); i++) {
 #ifdef CAN_USE_GCM_ASM
-		/* Ignore avx implementation if it won't work. */
+		/* Ignore avx implementations if they won't work. */
 		if (gcm_impl_opts[i].sel == IMPL_AVX && !gcm_avx_will_work()) {
 			continue;
 		}
+		if (gcm_impl_vaes(gcm_impl_opts[i].sel) != GCM_VAES_NONE &&
+		    !gcm_vaes_will_work(gcm_impl_vaes(gcm_impl_opts[i].sel))) {
+			continue;
+		}
 #endif
 		if (strcmp(req_name, gcm_impl_opts[i].name) == 0) {
 			impl = gcm_impl_opts[i].sel;
@@ -965,14 +1022,16 @@ gcm_impl_set(const char *val)
 #ifdef CAN_USE_GCM_ASM
 	/*
 	 * Use the avx implementation if available and the requested one is
-	 * avx or fastest.
+	 * avx, one of its vaes variants or fastest.
 	 */
 	if (gcm_avx_will_work() == B_TRUE &&
-	    (impl == IMPL_AVX || impl == IMPL_FASTEST)) {
+	    (impl == IMPL_AVX || impl == IMPL_FASTEST ||
+	    impl == IMPL_VAES_AVX2 || impl == IMPL_VAES_AVX512)) {
 		gcm_set_avx(B_TRUE);
 	} else {
 		gcm_set_avx(B_FALSE);
 	}
+	gcm_set_vaes(gcm_impl_vaes(impl));
 #endif
 
 	if (err == 0) {
@@ -1005,10 +1064,14 @@ icp_gcm_impl_get(char *buffer, zfs_kernel_param_t *kp)
 	/* list mandatory options */
 	for (i = 0; i < ARRAY_SIZE(gcm_impl_opts); i++) {
 #ifdef CAN_USE_GCM_ASM
-		/* Ignore avx implementation if it won't work. */
+		/* Ignore avx implementations if they won't work. */
 		if (gcm_impl_opts[i].sel == IMPL_AVX && !gcm_avx_will_work()) {
 			continue;
 		}
+		if (gcm_impl_vaes(gcm_impl_opts[i].sel) != GCM_VAES_NONE &&
+		    !gcm_vaes_will_work(gcm_impl_vaes(gcm_impl_opts[i].sel))) {
+			continue;
+		}
 #endif
 		fmt = (impl == gcm_impl_opts[i].sel) ? "[%s] " : "%s ";
 		cnt += kmem_scnprintf(buffer + cnt, PAGE_SIZE - cnt, fmt,
@@ -1045,11 +1108,17 @@ MODULE_PARM_DESC(icp_gcm_impl, "Select gcm implementation.");
 #define	GCM_AVX_MAX_CHUNK_SIZE \
 	(((128*1024)/GCM_AVX_MIN_DECRYPT_BYTES) * GCM_AVX_MIN_DECRYPT_BYTES)
 
+/* Size of the OpenSSL Htable and of the H powers the VAES code appends. */
+#define	GCM_AVX_HTAB_SIZE	(2 * 6 * 2 * sizeof (uint64_t))
+#define	GCM_VAES_HTAB_SIZE	(16 * GCM_BLOCK_LEN)
+
 /* Clear the FPU registers since they hold sensitive internal state. */
 #define	clear_fpu_regs() clear_fpu_regs_avx()
 #define	GHASH_AVX(ctx, in, len) \
     gcm_ghash_avx((ctx)->gcm_ghash, (const uint64_t *)(ctx)->gcm_Htable, \
     in, len)
+#define	GCM_VAES_HTAB(ctx) \
+	((uint64_t *)((uint8_t *)(ctx)->gcm_Htable + GCM_AVX_HTAB_SIZE))
 
 #define	gcm_incr_counter_block(ctx) gcm_incr_counter_block_by(ctx, 1)
 
@@ -1079,6 +1148,21 @@ extern size_t ASMABI aesni_gcm_encrypt(const uint8_t *, uint8_t *, size_t,
 extern size_t ASMABI aesni_gcm_decrypt(const uint8_t *, uint8_t *, size_t,
     const void *, uint64_t *, uint64_t *);
 
+#ifdef CAN_USE_GCM_VAES
+extern void ASMABI gcm_init_htab_vaes(uint64_t *htab, const uint64_t H[2]);
+
+extern size_t ASMABI aes_gcm_enc_vaes_avx2(const uint8_t *, uint8_t *,
+    size_t, const void *, uint64_t *, uint64_t *, const uint64_t *);
+extern size_t ASMABI aes_gcm_dec_vaes_avx2(const uint8_t *, uint8_t *,
+    size_t, const void *, uint64_t *, uint64_t *, const uint64_t *);
+#ifdef CAN_USE_GCM_VAES_AVX512
+extern size_t ASMABI aes_gcm_enc_vaes_avx512(const uint8_t *, uint8_t *,
+    size_t, const void *, uint64_t *, uint64_t *, const uint64_t *);
+extern size_t ASMABI aes_gcm_dec_vaes_avx512(const uint8_t *, uint8_t *,
+    size_t, const void *, uint64_t *, uint64_t *, const uint64_t *);
+#endif
+#endif
+
 static inline boolean_t
 gcm_avx_will_work(void)
 {
@@ -1088,6 +1172,57 @@ gcm_avx_will_work(void)
 	    zfs_pclmulqdq_available());
 }
 
+/*
+ * The VAES routines need AVX2 for the 256 bit variant and AVX512F and
+ * AVX512BW (for 512 bit VPSHUFB) for the 512 bit variant.
+ */
+static inline boolean_t
+gcm_vaes_will_work(gcm_vaes_t vaes)
+{
+#ifdef CAN_USE_GCM_VAES
+	if (!gcm_avx_will_work() || !zfs_avx2_available() ||
+	    !zfs_vaes_available() || !zfs_vpclmulqdq_available())
+		return (B_FALSE);
+
+	switch (vaes) {
+	case GCM_VAES_AVX2:
+		return (B_TRUE);
+#ifdef CAN_USE_GCM_VAES_AVX512
+	case GCM_VAES_AVX512:
+		return (zfs_avx512f_available() && zfs_avx512bw_available());
+#endif
+	default:
+		return (B_FALSE);
+	}
+#else
+	(void) vaes;
+	return (B_FALSE);
+#endif
+}
+
+/*
+ * Map an icp_gcm_impl selection to the bulk routines to use.  Fastest
+ * prefers the widest registers available.
+ */
+static inline gcm_vaes_t
+gcm_impl_vaes(uint32_t impl)
+{
+	switch (impl) {
+	case IMPL_VAES_AVX2:
+		return (GCM_VAES_AVX2);
+	case IMPL_VAES_AVX512:
+		return (GCM_VAES_AVX512);
+	case IMPL_FASTEST:
+		if (gcm_vaes_will_work(GCM_VAES_AVX512))
+			return (GCM_VAES_AVX512);
+		if (gcm_vaes_will_work(GCM_VAES_AVX2))
+			return (GCM_VAES_AVX2);
+		return (GCM_VAES_NONE);
+	default:
+		return (GCM_VAES_NONE);
+	}
+}
+
 static inline void
 gcm_set_avx(boolean_t val)
 {
@@ -1096,6 +1231,13 @@ gcm_set_avx(boolean_t val)
 	}
 }
 
+static inline void
+gcm_set_vaes(gcm_vaes_t vaes)
+{
+	if (vaes == GCM_VAES_NONE || gcm_vaes_will_work(vaes))
+		atomic_swap_32(&gcm_vaes, vaes);
+}
+
 static inline boolean_t
 gcm_toggle_avx(void)
 {
@@ -1106,12 +1248,30 @@ gcm_toggle_avx(void)
 	}
 }
 
+/*
+ * Cycle through the bulk routines which work on this CPU.
+ */
+static inline gcm_vaes_t
+gcm_cycle_vaes(void)
+{
+	static uint32_t cycle_vaes_idx = 0;
+	gcm_vaes_t vaes;
+
+	vaes = atomic_inc_32_nv(&cycle_vaes_idx) % (GCM_VAES_AVX512 + 1);
+	while (vaes != GCM_VAES_NONE && !gcm_vaes_will_work(vaes))
+		vaes--;
+
+	return (vaes);
+}
+
 static inline size_t
-gcm_simd_get_htab_size(boolean_t simd_mode)
+gcm_simd_get_htab_size(boolean_t simd_mode, gcm_vaes_t vaes)
 {
 	switch (simd_mode) {
 	case B_TRUE:
-		return (2 * 6 * 2 * sizeof (uint64_t));
+		if (vaes != GCM_VAES_NONE)
+			return (GCM_AVX_HTAB_SIZE + GCM_VAES_HTAB_SIZE);
+		return (GCM_AVX_HTAB_SIZE);
 
 	default:
 		return (0);
@@ -1119,6 +1279,45 @@ gcm_simd_get_htab_size(boolean_t simd_mode)
 }
 
 
+/*
+ * En- or decrypt and hash as much of in as the bulk routines selected for
+ * ctx can handle, at least GCM_AVX_MIN_ENCRYPT_BYTES (resp.
+ * GCM_AVX_MIN_DECRYPT_BYTES) rounded down to a multiple of
+ * GCM_AVX_MIN_DECRYPT_BYTES.  The VAES routines process all complete blocks.
+ * Returns the number of bytes processed.
+ */
+static inline size_t
+gcm_avx_bulk(gcm_ctx_t *ctx, boolean_t encrypt, const uint8_t *in,
+    uint8_t *out, size_t len)
+{
+	const void *key = ctx->gcm_keysched;
+	uint64_t *cb = ctx->gcm_cb;
+	uint64_t *ghash = ctx->gcm_ghash;
+
+	switch (ctx->gcm_vaes) {
+#ifdef CAN_USE_GCM_VAES
+#ifdef CAN_USE_GCM_VAES_AVX512
+	case GCM_VAES_AVX512:
+		return (encrypt ?
+		    aes_gcm_enc_vaes_avx512(in, out, len, key, cb, ghash,
+		    GCM_VAES_HTAB(ctx)) :
+		    aes_gcm_dec_vaes_avx512(in, out, len, key, cb, ghash,
+		    GCM_VAES_HTAB(ctx)));
+#endif
+	case GCM_VAES_AVX2:
+		return (encrypt ?
+		    aes_gcm_enc_vaes_avx2(in, out, len, key, cb, ghash,
+		    GCM_VAES_HTAB(ctx)) :
+		    aes_gcm_dec_vaes_avx2(in, out, len, key, cb, ghash,
+		    GCM_VAES_HTAB(ctx)));
+#endif
+	default:
+		return (encrypt ?
+		    aesni_gcm_encrypt(in, out, len, key, cb, ghash) :
+		    aesni_gcm_decrypt(in, out, len, key, cb, ghash));
+	}
+}
+
 /* Increment the GCM counter block by n. */
 static inline void
 gcm_incr_counter_block_by(gcm_ctx_t *ctx, int n)
@@ -1146,7 +1345,6 @@ gcm_mode_encrypt_contiguous_blocks_avx(gcm_ctx_t *ctx, char *data,
 	uint8_t *datap = (uint8_t *)data;
 	size_t chunk_size = (size_t)GCM_CHUNK_SIZE_READ;
 	const aes_key_t *key = ((aes_key_t *)ctx->gcm_keysched);
-	uint64_t *ghash = ctx->gcm_ghash;
 	uint64_t *cb = ctx->gcm_cb;
 	uint8_t *ct_buf = NULL;
 	uint8_t *tmp = (uint8_t *)ctx->gcm_tmp;
@@ -1210,8 +1408,7 @@ gcm_mode_encrypt_contiguous_blocks_avx(gcm_ctx_t *ctx, char *data,
 	/* Do the bulk encryption in chunk_size blocks. */
 	for (; bleft >= chunk_size; bleft -= chunk_size) {
 		kfpu_begin();
-		done = aesni_gcm_encrypt(
-		    datap, ct_buf, chunk_size, key, cb, ghash);
+		done = gcm_avx_bulk(ctx, B_TRUE, datap, ct_buf, chunk_size);
 
 		clear_fpu_regs();
 		kfpu_end();
@@ -1226,6 +1423,7 @@ gcm_mode_encrypt_contiguous_blocks_avx(gcm_ctx_t *ctx, char *data,
 		out->cd_offset += chunk_size;
 		datap += chunk_size;
 		ctx->gcm_processed_data_len += chunk_size;
+		gcm_output_notify(ctx);
 	}
 	/* Check if we are already done. */
 	if (bleft == 0) {
@@ -1234,7 +1432,7 @@ gcm_mode_encrypt_contiguous_blocks_avx(gcm_ctx_t *ctx, char *data,
 	/* Bulk encrypt the remaining data. */
 	kfpu_begin();
 	if (bleft >= GCM_AVX_MIN_ENCRYPT_BYTES) {
-		done = aesni_gcm_encrypt(datap, ct_buf, bleft, key, cb, ghash);
+		done = gcm_avx_bulk(ctx, B_TRUE, datap, ct_buf, bleft);
 		if (done == 0) {
 			rv = CRYPTO_FAILED;
 			goto out;
@@ -1280,6 +1478,8 @@ out_nofpu:
 	if (ct_buf != NULL) {
 		vmem_free(ct_buf, chunk_size);
 	}
+	if (rv == CRYPTO_SUCCESS)
+		gcm_output_notify(ctx);
 	return (rv);
 }
 
@@ -1339,6 +1539,7 @@ gcm_encrypt_final_avx(gcm_ctx_t *ctx, crypto_data_t *out, size_t block_size)
 	}
 	out->cd_offset += rem_len;
 	ctx->gcm_remainder_len = 0;
+	gcm_output_notify(ctx);
 	rv = crypto_put_output_data(ghash, out, ctx->gcm_tag_len);
 	if (rv != CRYPTO_SUCCESS)
 		return (rv);
@@ -1376,8 +1577,7 @@ gcm_decrypt_final_avx(gcm_ctx_t *ctx, crypto_data_t *out, size_t block_size)
 	 */
 	for (bleft = pt_len; bleft >= chunk_size; bleft -= chunk_size) {
 		kfpu_begin();
-		done = aesni_gcm_decrypt(datap, datap, chunk_size,
-		    (const void *)key, ctx->gcm_cb, ghash);
+		done = gcm_avx_bulk(ctx, B_FALSE, datap, datap, chunk_size);
 		clear_fpu_regs();
 		kfpu_end();
 		if (done != chunk_size) {
@@ -1388,8 +1588,7 @@ gcm_decrypt_final_avx(gcm_ctx_t *ctx, crypto_data_t *out, size_t block_size)
 	/* Decrypt remainder, which is less than chunk size, in one go. */
 	kfpu_begin();
 	if (bleft >= GCM_AVX_MIN_DECRYPT_BYTES) {
-		done = aesni_gcm_decrypt(datap, datap, bleft,
-		    (const void *)key, ctx->gcm_cb, ghash);
+		done = gcm_avx_bulk(ctx, B_FALSE, datap, datap, bleft);
 		if (done == 0) {
 			clear_fpu_regs();
 			kfpu_end();
@@ -1486,6 +1685,10 @@ gcm_init_avx(gcm_ctx_t *ctx, const uint8_t *iv, size_t iv_len,
 	    (const uint32_t *)H, (uint32_t *)H);
 
 	gcm_init_htab_avx(ctx->gcm_Htable, H);
+#ifdef CAN_USE_GCM_VAES
+	if (ctx->gcm_vaes != GCM_VAES_NONE)
+		gcm_init_htab_vaes(GCM_VAES_HTAB(ctx), H);
+#endif
 
 	if (iv_len == 12) {
 		memcpy(cb, iv, 12);
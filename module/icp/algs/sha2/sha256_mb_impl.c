@@ -0,0 +1,190 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Multi-buffer SHA256 implementations, used by SHA2MultiBuffer() to hash
+ * up to 16 messages side by side.
+ */
+
+#include <sys/simd.h>
+#include <sys/zfs_context.h>
+#include <sys/zfs_impl.h>
+#include <sys/sha2.h>
+
+#include <sha2/sha2_impl.h>
+#include <sys/asm_linkage.h>
+
+#define	TF(E, N) \
+	extern void ASMABI E(uint32_t *, const uint8_t *const *, size_t); \
+	static inline void N(uint32_t *s, const uint8_t *const *d, \
+	    size_t b) { \
+	kfpu_begin(); E(s, d, b); kfpu_end(); \
+}
+
+#if defined(__x86_64) && defined(HAVE_AVX2)
+static boolean_t sha2_have_avx2(void)
+{
+	return (kfpu_allowed() && zfs_avx2_available());
+}
+
+TF(zfs_sha256_mb_avx2, tf_sha256_mb_avx2);
+const sha256_mb_ops_t sha256_mb_avx2_impl = {
+	.is_supported = sha2_have_avx2,
+	.lanes = 8,
+	.transform = tf_sha256_mb_avx2,
+	.name = "avx2"
+};
+#endif
+
+#if defined(__x86_64) && defined(HAVE_AVX2) && defined(HAVE_AVX512F)
+static boolean_t sha2_have_avx512(void)
+{
+	return (kfpu_allowed() && zfs_avx2_available() &&
+	    zfs_avx512f_available());
+}
+
+TF(zfs_sha256_mb_avx512, tf_sha256_mb_avx512);
+const sha256_mb_ops_t sha256_mb_avx512_impl = {
+	.is_supported = sha2_have_avx512,
+	.lanes = 16,
+	.transform = tf_sha256_mb_avx512,
+	.name = "avx512"
+};
+#endif
+
+/* the generic one */
+extern const sha256_mb_ops_t sha256_mb_generic_impl;
+
+/* array with all sha256_mb implementations */
+static const sha256_mb_ops_t *const sha256_mb_impls[] = {
+	&sha256_mb_generic_impl,
+#if defined(__x86_64) && defined(HAVE_AVX2)
+	&sha256_mb_avx2_impl,
+#endif
+#if defined(__x86_64) && defined(HAVE_AVX2) && defined(HAVE_AVX512F)
+	&sha256_mb_avx512_impl,
+#endif
+};
+
+/* use the generic implementation functions */
+#define	IMPL_NAME		"sha256_mb"
+#define	IMPL_OPS_T		sha256_mb_ops_t
+#define	IMPL_ARRAY		sha256_mb_impls
+#define	IMPL_GET_OPS		sha256_mb_get_ops
+#define	ZFS_IMPL_OPS		zfs_sha256_mb_ops
+#include <generic_impl.c>
+
+#ifdef _KERNEL
+
+#define	IMPL_FMT(impl, i)	(((impl) == (i)) ? "[%s] " : "%s ")
+
+#if defined(__linux__)
+
+static int
+sha256_mb_param_get(char *buffer, zfs_kernel_param_t *unused)
+{
+	const uint32_t impl = IMPL_READ(generic_impl_chosen);
+	char *fmt;
+	int cnt = 0;
+
+	/* cycling */
+	fmt = IMPL_FMT(impl, IMPL_CYCLE);
+	cnt += sprintf(buffer + cnt, fmt, "cycle");
+
+	/* list fastest */
+	fmt = IMPL_FMT(impl, IMPL_FASTEST);
+	cnt += sprintf(buffer + cnt, fmt, "fastest");
+
+	/* list all supported implementations */
+	generic_impl_init();
+	for (uint32_t i = 0; i < generic_supp_impls_cnt; ++i) {
+		fmt = IMPL_FMT(impl, i);
+		cnt += sprintf(buffer + cnt, fmt,
+		    generic_supp_impls[i]->name);
+	}
+
+	return (cnt);
+}
+
+static int
+sha256_mb_param_set(const char *val, zfs_kernel_param_t *unused)
+{
+	(void) unused;
+	return (generic_impl_setname(val));
+}
+
+#elif defined(__FreeBSD__)
+
+#include <sys/sbuf.h>
+
+static int
+sha256_mb_param(ZFS_MODULE_PARAM_ARGS)
+{
+	int err;
+
+	generic_impl_init();
+	if (req->newptr == NULL) {
+		const uint32_t impl = IMPL_READ(generic_impl_chosen);
+		const int init_buflen = 64;
+		const char *fmt;
+		struct sbuf *s;
+
+		s = sbuf_new_for_sysctl(NULL, NULL, init_buflen, req);
+
+		/* cycling */
+		fmt = IMPL_FMT(impl, IMPL_CYCLE);
+		(void) sbuf_printf(s, fmt, "cycle");
+
+		/* list fastest */
+		fmt = IMPL_FMT(impl, IMPL_FASTEST);
+		(void) sbuf_printf(s, fmt, "fastest");
+
+		/* list all supported implementations */
+		for (uint32_t i = 0; i < generic_supp_impls_cnt; ++i) {
+			fmt = IMPL_FMT(impl, i);
+			(void) sbuf_printf(s, fmt, generic_supp_impls[i]->name);
+		}
+
+		err = sbuf_finish(s);
+		sbuf_delete(s);
+
+		return (err);
+	}
+
+	char buf[16];
+
+	err = sysctl_handle_string(oidp, buf, sizeof (buf), req);
+	if (err) {
+		return (err);
+	}
+
+	return (-generic_impl_setname(buf));
+}
+#endif
+
+#undef IMPL_FMT
+
+ZFS_MODULE_VIRTUAL_PARAM_CALL(zfs, zfs_, sha256_mb_impl,
+    sha256_mb_param_set, sha256_mb_param_get, ZMOD_RW, \
+	"Select multi-buffer SHA256 implementation.");
+#endif
+
+#undef TF
@@ -543,6 +543,195 @@ SHA2Final(void *digest, SHA2_CTX *ctx)
 	}
 }
 
+/* state of one lane of SHA2MultiBuffer() */
+typedef struct sha2_mb_lane {
+	const uint8_t	*ml_data;	/* next block to hash */
+	size_t		ml_blks;	/* blocks left at ml_data */
+	int		ml_msg;		/* message in this lane, -1 if idle */
+	boolean_t	ml_tail;	/* ml_data points into ml_pad */
+	uint8_t		ml_pad[2 * SHA512_BLOCK_LENGTH];
+} sha2_mb_lane_t;
+
+typedef struct sha2_mb {
+	union {
+		uint32_t	mb_state256[8 * SHA2_MB_MAX_LANES];
+		uint64_t	mb_state512[8 * SHA2_MB_MAX_LANES];
+	};
+	const uint8_t	*mb_data[SHA2_MB_MAX_LANES];
+	sha2_mb_lane_t	mb_lane[SHA2_MB_MAX_LANES];
+} sha2_mb_t;
+
+/* point the lane at the padded last block(s) of its message */
+static void
+sha2_mb_pad(sha2_mb_lane_t *ml, const uint8_t *data, size_t len, size_t bs)
+{
+	size_t tail = len % bs;
+	uint64_t mlen = BE_64((uint64_t)len * 8);
+
+	if (tail > 0)
+		memcpy(ml->ml_pad, data + len - tail, tail);
+	ml->ml_pad[tail] = 0x80;
+	ml->ml_blks = (tail + 1 > bs - bs / 8) ? 2 : 1;
+	memset(ml->ml_pad + tail + 1, 0, ml->ml_blks * bs - tail - 1);
+	memcpy(ml->ml_pad + ml->ml_blks * bs - 8, &mlen, 8);
+	ml->ml_data = ml->ml_pad;
+	ml->ml_tail = B_TRUE;
+}
+
+/* load the initial state of iv into lane l */
+static void
+sha2_mb_lane_init(sha2_mb_t *mb, const SHA2_CTX *iv, int lanes, int l)
+{
+	for (int i = 0; i < 8; i++) {
+		if (iv->algotype == SHA256_MECH_INFO_TYPE)
+			mb->mb_state256[i * lanes + l] = iv->sha256.state[i];
+		else
+			mb->mb_state512[i * lanes + l] = iv->sha512.state[i];
+	}
+}
+
+/* store the first dlen bytes of the final state of lane l */
+static void
+sha2_mb_lane_final(const sha2_mb_t *mb, int algotype, int lanes, int l,
+    void *digest, size_t dlen)
+{
+	union {
+		uint32_t w32[8];
+		uint64_t w64[8];
+	} h;
+
+	for (int i = 0; i < 8; i++) {
+		if (algotype == SHA256_MECH_INFO_TYPE)
+			h.w32[i] = BE_32(mb->mb_state256[i * lanes + l]);
+		else
+			h.w64[i] = BE_64(mb->mb_state512[i * lanes + l]);
+	}
+	memcpy(digest, &h, dlen);
+}
+
+/*
+ * SHA2 multi-buffer function: the n messages are distributed over the lanes
+ * of the selected multi-buffer implementation, a lane picking up the next
+ * message as soon as it has finished its last one, so messages of any
+ * length can be mixed.  Only the plain hash algorithm types are supported.
+ */
+void
+SHA2MultiBuffer(int algotype, int n, const void *const data[],
+    const size_t len[], void *const digest[])
+{
+	const sha256_mb_ops_t *ops256 = NULL;
+	const sha512_mb_ops_t *ops512 = NULL;
+	sha2_mb_t *mb;
+	SHA2_CTX iv;
+	size_t bs, dlen;
+	int lanes, next = 0, active = 0;
+
+	switch (algotype) {
+	case SHA256_MECH_INFO_TYPE:
+		ops256 = sha256_mb_get_ops();
+		dlen = SHA256_DIGEST_LENGTH;
+		break;
+	case SHA384_MECH_INFO_TYPE:
+		dlen = SHA384_DIGEST_LENGTH;
+		break;
+	case SHA512_MECH_INFO_TYPE:
+		dlen = SHA512_DIGEST_LENGTH;
+		break;
+	case SHA512_224_MECH_INFO_TYPE:
+		dlen = SHA512_224_DIGEST_LENGTH;
+		break;
+	default:
+		ASSERT3S(algotype, ==, SHA512_256_MECH_INFO_TYPE);
+		dlen = SHA512_256_DIGEST_LENGTH;
+		break;
+	}
+	if (ops256 != NULL) {
+		lanes = ops256->lanes;
+		bs = SHA256_BLOCK_LENGTH;
+	} else {
+		ops512 = sha512_mb_get_ops();
+		lanes = ops512->lanes;
+		bs = SHA512_BLOCK_LENGTH;
+	}
+	ASSERT3S(lanes, <=, SHA2_MB_MAX_LANES);
+
+	mb = kmem_alloc(sizeof (sha2_mb_t), KM_SLEEP);
+	SHA2Init(algotype, &iv);
+	for (int l = 0; l < lanes; l++)
+		mb->mb_lane[l].ml_msg = -1;
+
+	for (;;) {
+		size_t blks = SIZE_MAX;
+		int first = -1;
+
+		/* start the next messages in the idle lanes */
+		for (int l = 0; l < lanes; l++) {
+			sha2_mb_lane_t *ml = &mb->mb_lane[l];
+
+			if (ml->ml_msg < 0 && next < n) {
+				sha2_mb_lane_init(mb, &iv, lanes, l);
+				ml->ml_msg = next;
+				ml->ml_data = data[next];
+				ml->ml_blks = len[next] / bs;
+				ml->ml_tail = B_FALSE;
+				if (ml->ml_blks == 0) {
+					sha2_mb_pad(ml, data[next], len[next],
+					    bs);
+				}
+				next++;
+				active++;
+			}
+			if (ml->ml_msg >= 0) {
+				blks = MIN(blks, ml->ml_blks);
+				if (first < 0)
+					first = l;
+			}
+		}
+		if (active == 0)
+			break;
+
+		/* idle lanes hash the blocks of an active lane, for nothing */
+		for (int l = 0; l < lanes; l++) {
+			int src = (mb->mb_lane[l].ml_msg >= 0) ? l : first;
+			mb->mb_data[l] = mb->mb_lane[src].ml_data;
+		}
+		if (ops256 != NULL)
+			ops256->transform(mb->mb_state256, mb->mb_data, blks);
+		else
+			ops512->transform(mb->mb_state512, mb->mb_data, blks);
+
+		for (int l = 0; l < lanes; l++) {
+			sha2_mb_lane_t *ml = &mb->mb_lane[l];
+			int msg = ml->ml_msg;
+
+			if (msg < 0)
+				continue;
+			ml->ml_data += blks * bs;
+			ml->ml_blks -= blks;
+			if (ml->ml_blks > 0)
+				continue;
+			if (!ml->ml_tail) {
+				sha2_mb_pad(ml, data[msg], len[msg], bs);
+				continue;
+			}
+			sha2_mb_lane_final(mb, iv.algotype, lanes, l,
+			    digest[msg], dlen);
+			ml->ml_msg = -1;
+			active--;
+		}
+	}
+
+	kmem_free(mb, sizeof (sha2_mb_t));
+}
+
+int
+SHA2MultiBufferLanes(int algotype)
+{
+	if (algotype == SHA256_MECH_INFO_TYPE)
+		return (sha256_mb_get_ops()->lanes);
+	return (sha512_mb_get_ops()->lanes);
+}
+
 /* the generic implementation is always okay */
 static boolean_t sha2_is_supported(void)
 {
@@ -560,3 +749,34 @@ const sha512_ops_t sha512_generic_impl = {
 	.transform = sha512_generic,
 	.is_supported = sha2_is_supported
 };
+
+/*
+ * the generic multi-buffer implementations have a single lane, in which
+ * the messages are hashed one after the other by the selected sha256 or
+ * sha512 implementation
+ */
+static void
+sha256_mb_generic(uint32_t *state, const uint8_t *const *data, size_t blks)
+{
+	sha256_get_ops()->transform(state, data[0], blks);
+}
+
+static void
+sha512_mb_generic(uint64_t *state, const uint8_t *const *data, size_t blks)
+{
+	sha512_get_ops()->transform(state, data[0], blks);
+}
+
+const sha256_mb_ops_t sha256_mb_generic_impl = {
+	.name = "generic",
+	.lanes = 1,
+	.transform = sha256_mb_generic,
+	.is_supported = sha2_is_supported
+};
+
+const sha512_mb_ops_t sha512_mb_generic_impl = {
+	.name = "generic",
+	.lanes = 1,
+	.transform = sha512_mb_generic,
+	.is_supported = sha2_is_supported
+};
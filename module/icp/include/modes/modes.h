@@ -43,6 +43,23 @@ extern "C" {
     defined(HAVE_AES) && defined(HAVE_PCLMULQDQ)
 #define	CAN_USE_GCM_ASM
 extern boolean_t gcm_avx_can_use_movbe;
+
+/*
+ * Bulk routines of the avx implementation: the OpenSSL AES-NI/PCLMULQDQ
+ * ones, or VAES/VPCLMULQDQ ones on 256 or 512 bit registers.
+ */
+typedef enum gcm_vaes {
+	GCM_VAES_NONE = 0,
+	GCM_VAES_AVX2,
+	GCM_VAES_AVX512,
+} gcm_vaes_t;
+
+#if defined(HAVE_AVX2) && defined(HAVE_VAES) && defined(HAVE_VPCLMULQDQ)
+#define	CAN_USE_GCM_VAES
+#if defined(HAVE_AVX512F) && defined(HAVE_AVX512BW)
+#define	CAN_USE_GCM_VAES_AVX512
+#endif
+#endif
 #endif
 
 #define	ECB_MODE			0x00000002
@@ -201,7 +218,8 @@ typedef struct ccm_ctx {
  * gcm_H:		Subkey.
  *
  * gcm_Htable:		Pre-computed and pre-shifted H, H^2, ... H^6 for the
- *			Karatsuba Algorithm in host byte order.
+ *			Karatsuba Algorithm in host byte order, followed by
+ *			H^16, ... H^1 for the VAES routines if gcm_vaes is set.
  *
  * gcm_J0:		Pre-counter block generated from the IV.
  *
@@ -227,8 +245,13 @@ typedef struct gcm_ctx {
 	uint64_t gcm_J0[2];
 	uint64_t gcm_len_a_len_c[2];
 	uint8_t *gcm_pt_buf;
+	/* See pOutputCb in CK_AES_GCM_PARAMS. */
+	void (*gcm_output_cb)(void *, size_t);
+	void *gcm_output_cb_arg;
+	size_t gcm_output_cb_len;
 #ifdef CAN_USE_GCM_ASM
 	boolean_t gcm_use_avx;
+	gcm_vaes_t gcm_vaes;
 #endif
 } gcm_ctx_t;
 
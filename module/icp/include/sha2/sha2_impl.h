@@ -55,6 +55,32 @@ typedef struct {
 extern const sha256_ops_t *sha256_get_ops(void);
 extern const sha512_ops_t *sha512_get_ops(void);
 
+/*
+ * multi-buffer transform definition: hash blks blocks of each of the lanes
+ * messages at data[0..lanes-1], the state of lane l is state[i * lanes + l]
+ */
+typedef void (*sha256_mb_f)(uint32_t *state, const uint8_t *const *data,
+    size_t blks);
+typedef void (*sha512_mb_f)(uint64_t *state, const uint8_t *const *data,
+    size_t blks);
+
+typedef struct {
+	const char *name;
+	uint32_t lanes;
+	sha256_mb_f transform;
+	sha2_is_supported_f is_supported;
+} sha256_mb_ops_t;
+
+typedef struct {
+	const char *name;
+	uint32_t lanes;
+	sha512_mb_f transform;
+	sha2_is_supported_f is_supported;
+} sha512_mb_ops_t;
+
+extern const sha256_mb_ops_t *sha256_mb_get_ops(void);
+extern const sha512_mb_ops_t *sha512_mb_get_ops(void);
+
 typedef enum {
 	SHA1_TYPE,
 	SHA256_TYPE,
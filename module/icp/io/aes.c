@@ -1265,6 +1265,8 @@ process_gmac_mech(crypto_mechanism_t *mech, crypto_data_t *data,
 	gcm_params->pIv = params->pIv;
 	gcm_params->ulIvLen = AES_GMAC_IV_LEN;
 	gcm_params->ulTagBits = AES_GMAC_TAG_BITS;
+	gcm_params->pOutputCb = NULL;
+	gcm_params->pOutputCbArg = NULL;
 
 	if (data == NULL)
 		return (CRYPTO_SUCCESS);
@@ -503,3 +503,13 @@ abd_cache_reap_now(void)
 {
 	kmem_cache_reap_soon(abd_chunk_cache);
 }
+
+/*
+ * NUMA placement of ABD chunks is not tracked on FreeBSD.
+ */
+int
+abd_get_node(abd_t *abd)
+{
+	(void) abd;
+	return (-1);
+}
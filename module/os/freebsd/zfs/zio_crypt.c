@@ -1654,14 +1654,16 @@ void *failed_decrypt_buf;
 int faile_decrypt_size;
 
 /*
- * Primary encryption / decryption entrypoint for zio data.
+ * Primary encryption / decryption entrypoint for zio data. The ciphertext is
+ * never passed to a sink here, since OCF does not report its progress.
  */
 int
 zio_do_crypt_data(boolean_t encrypt, zio_crypt_key_t *key,
     dmu_object_type_t ot, boolean_t byteswap, uint8_t *salt, uint8_t *iv,
     uint8_t *mac, uint_t datalen, uint8_t *plainbuf, uint8_t *cipherbuf,
-    boolean_t *no_crypt)
+    boolean_t *no_crypt, zio_crypt_sink_t *sink)
 {
+	(void) sink;
 	int ret;
 	boolean_t locked = B_FALSE;
 	uint64_t crypt = key->zk_crypt;
@@ -1785,7 +1787,7 @@ zio_do_crypt_abd(boolean_t encrypt, zio_crypt_key_t *key, dmu_object_type_t ot,
 	}
 
 	ret = zio_do_crypt_data(encrypt, key, ot, byteswap, salt, iv, mac,
-	    datalen, ptmp, ctmp, no_crypt);
+	    datalen, ptmp, ctmp, no_crypt, NULL);
 	if (ret != 0)
 		goto error;
 
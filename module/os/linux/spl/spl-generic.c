@@ -61,6 +61,47 @@ MODULE_PARM_DESC(spl_hostid, "The system hostid.");
 proc_t p0;
 EXPORT_SYMBOL(p0);
 
+/*
+ * The NUMA nodes which have CPUs.  These are what max_nnodes counts, and
+ * what CPU_NODEID_UNSTABLE and taskq_create_node() number from 0, so that
+ * per-node taskqs are only created where there are CPUs to run them.  Every
+ * other node, such as a memory-only (CXL) or offline one, is mapped to the
+ * nearest node with CPUs.  The map is built when the module is loaded.
+ */
+unsigned int spl_cpu_nnodes = 1;
+EXPORT_SYMBOL(spl_cpu_nnodes);
+
+static int *spl_cpu_node_ids;		/* node id of each CPU node */
+static int *spl_cpu_node_nearest;	/* nearest CPU node to each node */
+
+/*
+ * Return the number of the CPU node nearest to the given NUMA node, or -1
+ * if the node is not known.
+ */
+int
+spl_cpu_node_index(int node)
+{
+	if (spl_cpu_node_nearest == NULL || node < 0 || node >= nr_node_ids)
+		return (-1);
+
+	return (spl_cpu_node_nearest[node]);
+}
+EXPORT_SYMBOL(spl_cpu_node_index);
+
+/*
+ * Return the NUMA node id of the given CPU node, or NUMA_NO_NODE.
+ */
+int
+spl_cpu_node_id(int index)
+{
+	if (spl_cpu_node_ids == NULL || index < 0 ||
+	    (unsigned int)index >= spl_cpu_nnodes)
+		return (NUMA_NO_NODE);
+
+	return (spl_cpu_node_ids[index]);
+}
+EXPORT_SYMBOL(spl_cpu_node_id);
+
 /*
  * xoshiro256++ 1.0 PRNG by David Blackman and Sebastiano Vigna
  *
@@ -847,6 +888,47 @@ spl_random_fini(void)
 	free_percpu(spl_pseudo_entropy);
 }
 
+static int __init
+spl_numa_init(void)
+{
+	unsigned int n = 0;
+	int node;
+
+	spl_cpu_node_ids = kmem_alloc(nr_node_ids * sizeof (int), KM_SLEEP);
+	spl_cpu_node_nearest = kmem_zalloc(nr_node_ids * sizeof (int),
+	    KM_SLEEP);
+
+	for_each_node_state(node, N_CPU) {
+		spl_cpu_node_ids[n++] = node;
+	}
+	if (n == 0)
+		spl_cpu_node_ids[n++] = first_online_node;
+	spl_cpu_nnodes = n;
+
+	for_each_node(node) {
+		unsigned int best = 0;
+
+		for (unsigned int i = 1; i < n; i++) {
+			if (node_distance(node, spl_cpu_node_ids[i]) <
+			    node_distance(node, spl_cpu_node_ids[best]))
+				best = i;
+		}
+		spl_cpu_node_nearest[node] = best;
+	}
+
+	return (0);
+}
+
+static void
+spl_numa_fini(void)
+{
+	kmem_free(spl_cpu_node_nearest, nr_node_ids * sizeof (int));
+	kmem_free(spl_cpu_node_ids, nr_node_ids * sizeof (int));
+	spl_cpu_node_nearest = NULL;
+	spl_cpu_node_ids = NULL;
+	spl_cpu_nnodes = 1;
+}
+
 static void
 spl_kvmem_fini(void)
 {
@@ -865,41 +947,46 @@ spl_init(void)
 	if ((rc = spl_kvmem_init()))
 		goto out1;
 
-	if ((rc = spl_tsd_init()))
+	if ((rc = spl_numa_init()))
 		goto out2;
 
-	if ((rc = spl_taskq_init()))
+	if ((rc = spl_tsd_init()))
 		goto out3;
 
-	if ((rc = spl_kmem_cache_init()))
+	if ((rc = spl_taskq_init()))
 		goto out4;
 
-	if ((rc = spl_proc_init()))
+	if ((rc = spl_kmem_cache_init()))
 		goto out5;
 
-	if ((rc = spl_kstat_init()))
+	if ((rc = spl_proc_init()))
 		goto out6;
 
-	if ((rc = spl_zlib_init()))
+	if ((rc = spl_kstat_init()))
 		goto out7;
 
-	if ((rc = spl_zone_init()))
+	if ((rc = spl_zlib_init()))
 		goto out8;
 
+	if ((rc = spl_zone_init()))
+		goto out9;
+
 	return (rc);
 
-out8:
+out9:
 	spl_zlib_fini();
-out7:
+out8:
 	spl_kstat_fini();
-out6:
+out7:
 	spl_proc_fini();
-out5:
+out6:
 	spl_kmem_cache_fini();
-out4:
+out5:
 	spl_taskq_fini();
-out3:
+out4:
 	spl_tsd_fini();
+out3:
+	spl_numa_fini();
 out2:
 	spl_kvmem_fini();
 out1:
@@ -918,6 +1005,7 @@ spl_fini(void)
 	spl_kmem_cache_fini();
 	spl_taskq_fini();
 	spl_tsd_fini();
+	spl_numa_fini();
 	spl_kvmem_fini();
 	spl_random_fini();
 }
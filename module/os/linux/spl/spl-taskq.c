@@ -1035,11 +1035,39 @@ error:
 	return (0);
 }
 
+/*
+ * Return the n'th online CPU (modulo their count) of the given NUMA node,
+ * or -1 if the node has no online CPUs.
+ */
+static int
+taskq_node_cpu(int node, uint_t n)
+{
+	const struct cpumask *mask = cpumask_of_node(node);
+	uint_t count = 0;
+	int cpu;
+
+	for_each_cpu_and(cpu, mask, cpu_online_mask) {
+		count++;
+	}
+	if (count == 0)
+		return (-1);
+
+	n %= count;
+	for_each_cpu_and(cpu, mask, cpu_online_mask) {
+		if (n-- == 0)
+			return (cpu);
+	}
+
+	return (-1);
+}
+
 static taskq_thread_t *
 taskq_thread_create(taskq_t *tq)
 {
 	static int last_used_cpu = 0;
+	static uint_t last_node_cpu = 0;
 	taskq_thread_t *tqt;
+	int cpu;
 
 	tqt = kmem_alloc(sizeof (*tqt), KM_PUSHPAGE);
 	INIT_LIST_HEAD(&tqt->tqt_thread_list);
@@ -1047,14 +1075,21 @@ taskq_thread_create(taskq_t *tq)
 	tqt->tqt_tq = tq;
 	tqt->tqt_id = TASKQID_INVALID;
 
-	tqt->tqt_thread = spl_kthread_create(taskq_thread, tqt,
-	    "%s", tq->tq_name);
+	tqt->tqt_thread = spl_kthread_create_on_node(taskq_thread, tqt,
+	    tq->tq_node, "%s", tq->tq_name);
 	if (tqt->tqt_thread == NULL) {
 		kmem_free(tqt, sizeof (taskq_thread_t));
 		return (NULL);
 	}
 
-	if (spl_taskq_thread_bind) {
+	/*
+	 * Threads of a per-node taskq are spread over the CPUs of that
+	 * node so that its work stays next to the node's memory.
+	 */
+	if (tq->tq_node != NUMA_NO_NODE &&
+	    (cpu = taskq_node_cpu(tq->tq_node, last_node_cpu++)) >= 0) {
+		kthread_bind(tqt->tqt_thread, cpu);
+	} else if (spl_taskq_thread_bind) {
 		last_used_cpu = (last_used_cpu + 1) % num_online_cpus();
 		kthread_bind(tqt->tqt_thread, last_used_cpu);
 	}
@@ -1067,9 +1102,15 @@ taskq_thread_create(taskq_t *tq)
 	return (tqt);
 }
 
+/*
+ * Create a taskq whose threads are allocated on, and bound to the CPUs of,
+ * the given node.  Nodes are numbered from 0 to max_nnodes - 1 and only
+ * count the NUMA nodes with CPUs (see spl_cpu_node_id()).  NUMA_NO_NODE
+ * creates an ordinary taskq.
+ */
 taskq_t *
-taskq_create(const char *name, int threads_arg, pri_t pri,
-    int minalloc, int maxalloc, uint_t flags)
+taskq_create_node(const char *name, int threads_arg, pri_t pri,
+    int minalloc, int maxalloc, int node, uint_t flags)
 {
 	taskq_t *tq;
 	taskq_thread_t *tqt;
@@ -1116,6 +1157,7 @@ taskq_create(const char *name, int threads_arg, pri_t pri,
 	tq->tq_maxthreads = nthreads;
 	tq->tq_cpu_pct = threads_arg;
 	tq->tq_pri = pri;
+	tq->tq_node = spl_cpu_node_id(node);
 	tq->tq_minalloc = minalloc;
 	tq->tq_maxalloc = maxalloc;
 	tq->tq_nalloc = 0;
@@ -1174,6 +1216,15 @@ taskq_create(const char *name, int threads_arg, pri_t pri,
 
 	return (tq);
 }
+EXPORT_SYMBOL(taskq_create_node);
+
+taskq_t *
+taskq_create(const char *name, int threads_arg, pri_t pri,
+    int minalloc, int maxalloc, uint_t flags)
+{
+	return (taskq_create_node(name, threads_arg, pri, minalloc, maxalloc,
+	    NUMA_NO_NODE, flags));
+}
 EXPORT_SYMBOL(taskq_create);
 
 void
@@ -119,12 +119,14 @@ __thread_create(caddr_t stk, size_t  stksize, thread_func_t func,
 EXPORT_SYMBOL(__thread_create);
 
 /*
- * spl_kthread_create - Wrapper providing pre-3.13 semantics for
- * kthread_create() in which it is not killable and less likely
- * to return -ENOMEM.
+ * spl_kthread_create_on_node - Wrapper providing pre-3.13 semantics for
+ * kthread_create_on_node() in which it is not killable and less likely
+ * to return -ENOMEM.  The thread's stack and task_struct are allocated
+ * on the requested NUMA node, or on any node for NUMA_NO_NODE.
  */
 struct task_struct *
-spl_kthread_create(int (*func)(void *), void *data, const char namefmt[], ...)
+spl_kthread_create_on_node(int (*func)(void *), void *data, int node,
+    const char namefmt[], ...)
 {
 	struct task_struct *tsk;
 	va_list args;
@@ -134,7 +136,7 @@ spl_kthread_create(int (*func)(void *), void *data, const char namefmt[], ...)
 	vsnprintf(name, sizeof (name), namefmt, args);
 	va_end(args);
 	do {
-		tsk = kthread_create(func, data, "%s", name);
+		tsk = kthread_create_on_node(func, data, node, "%s", name);
 		if (IS_ERR(tsk)) {
 			if (signal_pending(current)) {
 				clear_thread_flag(TIF_SIGPENDING);
@@ -148,6 +150,25 @@ spl_kthread_create(int (*func)(void *), void *data, const char namefmt[], ...)
 		}
 	} while (1);
 }
+EXPORT_SYMBOL(spl_kthread_create_on_node);
+
+/*
+ * spl_kthread_create - As spl_kthread_create_on_node() without a node
+ * preference.
+ */
+struct task_struct *
+spl_kthread_create(int (*func)(void *), void *data, const char namefmt[], ...)
+{
+	va_list args;
+	char name[TASK_COMM_LEN];
+
+	va_start(args, namefmt);
+	vsnprintf(name, sizeof (name), namefmt, args);
+	va_end(args);
+
+	return (spl_kthread_create_on_node(func, data, NUMA_NO_NODE,
+	    "%s", name));
+}
 EXPORT_SYMBOL(spl_kthread_create);
 
 /*
@@ -999,6 +999,33 @@ abd_cache_reap_now(void)
 {
 }
 
+/*
+ * Return the node (as numbered by max_nnodes) nearest to the memory holding
+ * the first page of the ABD, or -1 if that is not known.  Linear buffers
+ * may come from vmalloc() and are not looked up.
+ */
+int
+abd_get_node(abd_t *abd)
+{
+#if defined(_KERNEL)
+	if (abd_is_gang(abd)) {
+		abd_t *cabd = list_head(&ABD_GANG(abd).abd_gang_chain);
+		return (cabd != NULL ? abd_get_node(cabd) : -1);
+	}
+	if (abd_is_linear_page(abd)) {
+		return (spl_cpu_node_index(
+		    page_to_nid(sg_page(abd->abd_u.abd_linear.abd_sgl))));
+	}
+	if (abd_is_linear(abd))
+		return (-1);
+	return (spl_cpu_node_index(
+	    page_to_nid(sg_page(ABD_SCATTER(abd).abd_sgl))));
+#else
+	(void) abd;
+	return (-1);
+#endif
+}
+
 #if defined(_KERNEL)
 /*
  * bio_nr_pages for ABD.
@@ -80,6 +80,13 @@ typedef struct dio_request {
 
 static unsigned int zfs_vdev_failfast_mask = 1;
 
+/*
+ * Time in microseconds that a thread issuing polled I/O (see the vdev "poll"
+ * property) busy-waits for it to complete before sleeping between polls.
+ * Zero disables polled I/O altogether.
+ */
+static uint_t zfs_vdev_disk_poll_us = 50;
+
 #ifdef HAVE_BLK_MODE_T
 static blk_mode_t
 #else
@@ -683,6 +690,47 @@ vdev_bio_max_segs(zio_t *zio, int bio_size, uint64_t abd_offset)
 #endif
 }
 
+#ifdef HAVE_BIO_POLL
+/*
+ * Synchronous reads and ZIL writes are the I/O that something is waiting on,
+ * so they are the ones submitted as polled I/O when the vdev asks for it.
+ */
+static boolean_t
+vdev_disk_io_polled(zio_t *zio)
+{
+	if (!zio->io_vd->vdev_poll || zfs_vdev_disk_poll_us == 0)
+		return (B_FALSE);
+
+	return (zio->io_priority == ZIO_PRIORITY_SYNC_READ ||
+	    zio->io_priority == ZIO_PRIORITY_SYNC_WRITE);
+}
+
+/*
+ * Poll for the completion of a polled bio from the thread that issued it.
+ * Polled bios are put on hardware queues which don't raise completion
+ * interrupts, so whoever submits one has to keep polling until it completes.
+ * For the first zfs_vdev_disk_poll_us we spin, after which we keep polling
+ * with short sleeps in between so a slow device doesn't cost a whole CPU.
+ * The completion of the bio runs from bio_poll() and drops its reference on
+ * the dio_request, leaving the caller's.
+ */
+static void
+vdev_disk_poll(dio_request_t *dr, struct bio *bio)
+{
+	hrtime_t deadline = gethrtime() + USEC2NSEC(zfs_vdev_disk_poll_us);
+
+	while (atomic_read(&dr->dr_ref) > 1) {
+		if (bio_poll(bio, NULL, BLK_POLL_ONESHOT) > 0)
+			continue;
+
+		if (gethrtime() < deadline)
+			cpu_relax();
+		else
+			usleep_range(10, 20);
+	}
+}
+#endif
+
 static int
 __vdev_disk_physio(struct block_device *bdev, zio_t *zio,
     size_t io_size, uint64_t io_offset, int rw, int flags)
@@ -695,6 +743,9 @@ __vdev_disk_physio(struct block_device *bdev, zio_t *zio,
 	int error = 0;
 	struct blk_plug plug;
 	unsigned short nr_vecs;
+#ifdef HAVE_BIO_POLL
+	boolean_t polled = B_FALSE;
+#endif
 
 	/*
 	 * Accessing outside the block device is never allowed.
@@ -776,6 +827,17 @@ retry:
 	/* Extra reference to protect dio_request during vdev_submit_bio */
 	vdev_disk_dio_get(dr);
 
+#ifdef HAVE_BIO_POLL
+	/*
+	 * Only requests which fit in a single bio are polled, those are the
+	 * small ones for which the interrupt overhead matters.
+	 */
+	if (dr->dr_bio[1] == NULL && vdev_disk_io_polled(zio)) {
+		dr->dr_bio[0]->bi_opf |= REQ_POLLED;
+		polled = B_TRUE;
+	}
+#endif
+
 	if (dr->dr_bio_count > 1)
 		blk_start_plug(&plug);
 
@@ -788,6 +850,15 @@ retry:
 	if (dr->dr_bio_count > 1)
 		blk_finish_plug(&plug);
 
+#ifdef HAVE_BIO_POLL
+	/*
+	 * The block layer clears REQ_POLLED if the queue can't poll, or the
+	 * bio had to be split, in which case it completes by interrupt.
+	 */
+	if (polled && (dr->dr_bio[0]->bi_opf & REQ_POLLED))
+		vdev_disk_poll(dr, dr->dr_bio[0]);
+#endif
+
 	vdev_disk_dio_put(dr);
 
 	return (error);
@@ -1103,3 +1174,6 @@ ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, open_timeout_ms, UINT, ZMOD_RW,
 
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, failfast_mask, UINT, ZMOD_RW,
 	"Defines failfast mask: 1 - device, 2 - transport, 4 - driver");
+
+ZFS_MODULE_PARAM(zfs_vdev_disk, zfs_vdev_disk_, poll_us, UINT, ZMOD_RW,
+	"Time to busy-wait for polled I/O to complete (0 disables polling)");
@@ -39,6 +39,12 @@
 #ifdef _KERNEL
 #include <linux/falloc.h>
 #endif
+#if !defined(_KERNEL) && defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define	VDEV_FILE_URING
+#endif
 /*
  * Virtual device vector for files.
  */
@@ -56,6 +62,378 @@ static taskq_t *vdev_file_taskq;
 static uint_t vdev_file_logical_ashift = SPA_MINBLOCKSHIFT;
 static uint_t vdev_file_physical_ashift = SPA_MINBLOCKSHIFT;
 
+#ifdef VDEV_FILE_URING
+/*
+ * In userland, reads and writes of file vdevs are submitted through an
+ * io_uring per vdev rather than done one at a time on vdev_file_taskq, so
+ * that libzpool consumers like ztest can keep hundreds of I/Os in flight on
+ * each file.  Threads issuing I/O fill in submission queue entries under
+ * vu_lock; whichever of them finds nobody else submitting passes everything
+ * queued so far to the kernel with one system call, so concurrent I/Os are
+ * submitted in batches.  A reaper thread per ring waits for completions and
+ * hands the zios straight back to zio_delay_interrupt().
+ *
+ * The rings are set up with the raw system calls, there's no liburing
+ * dependency.  A vdev whose ring is full, or which couldn't get one, falls
+ * back to vdev_file_taskq.  vdev_file_uring can be cleared (e.g. with
+ * ztest -o) to use vdev_file_taskq for everything, and vdev_file_uring_depth
+ * is the number of submission queue entries of rings created from then on.
+ */
+int vdev_file_uring = 1;
+uint_t vdev_file_uring_depth = 256;
+
+typedef struct vdev_file_uring {
+	int		vu_fd;		/* the ring */
+	int		vu_file_fd;	/* the vdev's file */
+	kthread_t	*vu_reaper;
+	kmutex_t	vu_lock;
+	kcondvar_t	vu_cv;
+	uint_t		vu_entries;	/* size of the submission queue */
+	uint_t		vu_inflight;	/* entries queued or in the kernel */
+	uint_t		vu_pending;	/* entries not yet submitted */
+	boolean_t	vu_submitting;
+
+	/* Submission queue ring, and the entries it indexes */
+	void		*vu_sq_ring;
+	size_t		vu_sq_ring_size;
+	uint32_t	*vu_sq_tail;
+	uint32_t	*vu_sq_mask;
+	uint32_t	*vu_sq_array;
+	struct io_uring_sqe *vu_sqes;
+	size_t		vu_sqes_size;
+
+	/* Completion queue ring, which may share the submission ring's map */
+	void		*vu_cq_ring;
+	size_t		vu_cq_ring_size;
+	uint32_t	*vu_cq_head;
+	uint32_t	*vu_cq_tail;
+	uint32_t	*vu_cq_mask;
+	struct io_uring_cqe *vu_cqes;
+} vdev_file_uring_t;
+
+typedef struct vdev_file_uring_io {
+	zio_t		*vui_zio;
+	void		*vui_buf;
+	uint_t		vui_nsqes;	/* completions still to come */
+	uint64_t	vui_done;	/* bytes transferred */
+	int		vui_error;
+} vdev_file_uring_io_t;
+
+static int
+vdev_file_uring_enter(vdev_file_uring_t *vu, uint_t to_submit,
+    uint_t min_complete, uint_t flags)
+{
+	return (syscall(__NR_io_uring_enter, vu->vu_fd, to_submit,
+	    min_complete, flags, NULL, 0));
+}
+
+/*
+ * Complete one of the submission queue entries of an I/O, and the zio once
+ * all of them are done.  Like vdev_file_io_strategy(), a short transfer
+ * fails the zio with ENOSPC.
+ */
+static void
+vdev_file_uring_complete(vdev_file_uring_t *vu, vdev_file_uring_io_t *vui,
+    int32_t res)
+{
+	zio_t *zio = vui->vui_zio;
+
+	mutex_enter(&vu->vu_lock);
+	if (--vu->vu_inflight == 0)
+		cv_broadcast(&vu->vu_cv);
+	mutex_exit(&vu->vu_lock);
+
+	/* A failed first write cancels the second (see below) */
+	if (res < 0 && vui->vui_error == 0)
+		vui->vui_error = -res;
+	else if (res > 0)
+		vui->vui_done += res;
+	if (--vui->vui_nsqes > 0)
+		return;
+
+	if (zio->io_type == ZIO_TYPE_READ)
+		abd_return_buf_copy(zio->io_abd, vui->vui_buf, zio->io_size);
+	else
+		abd_return_buf(zio->io_abd, vui->vui_buf, zio->io_size);
+	zio->io_error = vui->vui_error;
+	if (vui->vui_done != zio->io_size && zio->io_error == 0)
+		zio->io_error = SET_ERROR(ENOSPC);
+	kmem_free(vui, sizeof (*vui));
+
+	zio_delay_interrupt(zio);
+}
+
+static void
+vdev_file_uring_reaper(void *arg)
+{
+	vdev_file_uring_t *vu = arg;
+	boolean_t exiting = B_FALSE;
+
+	while (!exiting) {
+		uint32_t head = *vu->vu_cq_head;
+		uint32_t tail = *(volatile uint32_t *)vu->vu_cq_tail;
+		membar_consumer();
+
+		if (head == tail) {
+			if (vdev_file_uring_enter(vu, 0, 1,
+			    IORING_ENTER_GETEVENTS) == -1)
+				VERIFY(errno == EINTR || errno == EAGAIN);
+			continue;
+		}
+
+		for (; head != tail; head++) {
+			struct io_uring_cqe *cqe =
+			    &vu->vu_cqes[head & *vu->vu_cq_mask];
+			vdev_file_uring_io_t *vui =
+			    (vdev_file_uring_io_t *)(uintptr_t)cqe->user_data;
+
+			/* The nop sent by vdev_file_uring_destroy() */
+			if (vui == NULL)
+				exiting = B_TRUE;
+			else
+				vdev_file_uring_complete(vu, vui, cqe->res);
+		}
+		membar_producer();
+		*(volatile uint32_t *)vu->vu_cq_head = head;
+	}
+}
+
+static struct io_uring_sqe *
+vdev_file_uring_get_sqe(vdev_file_uring_t *vu, vdev_file_uring_io_t *vui,
+    uint32_t *tail, uint8_t opcode)
+{
+	uint32_t idx = *tail & *vu->vu_sq_mask;
+	struct io_uring_sqe *sqe = &vu->vu_sqes[idx];
+
+	ASSERT(MUTEX_HELD(&vu->vu_lock));
+	memset(sqe, 0, sizeof (*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = vu->vu_file_fd;
+	sqe->user_data = (uint64_t)(uintptr_t)vui;
+	vu->vu_sq_array[idx] = idx;
+	(*tail)++;
+	return (sqe);
+}
+
+/*
+ * Publish nsqes new submission queue entries up to tail, and submit them
+ * unless another thread is already submitting, in which case it picks them
+ * up once its system call returns.
+ */
+static void
+vdev_file_uring_submit(vdev_file_uring_t *vu, uint32_t tail, uint_t nsqes)
+{
+	ASSERT(MUTEX_HELD(&vu->vu_lock));
+	membar_producer();
+	*(volatile uint32_t *)vu->vu_sq_tail = tail;
+
+	vu->vu_pending += nsqes;
+	if (vu->vu_submitting)
+		return;
+
+	vu->vu_submitting = B_TRUE;
+	while ((nsqes = vu->vu_pending) != 0) {
+		vu->vu_pending = 0;
+		mutex_exit(&vu->vu_lock);
+		while (nsqes > 0) {
+			int rc = vdev_file_uring_enter(vu, nsqes, 0, 0);
+			if (rc > 0)
+				nsqes -= rc;
+			else if (rc == -1)
+				VERIFY(errno == EINTR || errno == EAGAIN ||
+				    errno == EBUSY);
+		}
+		mutex_enter(&vu->vu_lock);
+	}
+	vu->vu_submitting = B_FALSE;
+	cv_broadcast(&vu->vu_cv);
+}
+
+/*
+ * Start a read or write through the vdev's ring.  Returns false if the
+ * ring is full, for the caller to fall back to vdev_file_taskq.
+ */
+static boolean_t
+vdev_file_uring_io_start(vdev_file_uring_t *vu, zio_t *zio)
+{
+	vdev_file_uring_io_t *vui;
+	struct io_uring_sqe *sqe;
+	uint64_t split = 0;
+	uint32_t tail;
+	uint_t nsqes;
+
+	/*
+	 * zfs_file_pwrite() splits writes in two system calls, so that ztest
+	 * can kill the process in between to simulate partial writes.  Do
+	 * the same with two linked writes; the second one is canceled if the
+	 * first one fails.
+	 */
+	if (zio->io_type == ZIO_TYPE_WRITE) {
+		uint64_t sectors = zio->io_size >> SPA_MINBLOCKSHIFT;
+		split = (sectors > 0 ? rand() % sectors : 0) <<
+		    SPA_MINBLOCKSHIFT;
+	}
+	nsqes = (split != 0) ? 2 : 1;
+
+	mutex_enter(&vu->vu_lock);
+	if (vu->vu_inflight + nsqes > vu->vu_entries) {
+		mutex_exit(&vu->vu_lock);
+		return (B_FALSE);
+	}
+	vu->vu_inflight += nsqes;
+	mutex_exit(&vu->vu_lock);
+
+	vui = kmem_alloc(sizeof (*vui), KM_SLEEP);
+	vui->vui_zio = zio;
+	vui->vui_nsqes = nsqes;
+	vui->vui_done = 0;
+	vui->vui_error = 0;
+	if (zio->io_type == ZIO_TYPE_READ)
+		vui->vui_buf = abd_borrow_buf(zio->io_abd, zio->io_size);
+	else
+		vui->vui_buf = abd_borrow_buf_copy(zio->io_abd, zio->io_size);
+
+	mutex_enter(&vu->vu_lock);
+	tail = *vu->vu_sq_tail;
+	if (zio->io_type == ZIO_TYPE_READ) {
+		sqe = vdev_file_uring_get_sqe(vu, vui, &tail, IORING_OP_READ);
+		sqe->addr = (uint64_t)(uintptr_t)vui->vui_buf;
+		sqe->len = zio->io_size;
+	} else {
+		sqe = vdev_file_uring_get_sqe(vu, vui, &tail, IORING_OP_WRITE);
+		if (split != 0) {
+			sqe->addr = (uint64_t)(uintptr_t)vui->vui_buf;
+			sqe->len = split;
+			sqe->off = zio->io_offset;
+			sqe->flags = IOSQE_IO_LINK;
+			sqe = vdev_file_uring_get_sqe(vu, vui, &tail,
+			    IORING_OP_WRITE);
+		}
+		sqe->addr = (uint64_t)(uintptr_t)vui->vui_buf + split;
+		sqe->len = zio->io_size - split;
+	}
+	sqe->off = zio->io_offset + split;
+	vdev_file_uring_submit(vu, tail, nsqes);
+	mutex_exit(&vu->vu_lock);
+
+	return (B_TRUE);
+}
+
+static void
+vdev_file_uring_unmap(vdev_file_uring_t *vu)
+{
+	if (vu->vu_sqes != MAP_FAILED)
+		(void) munmap(vu->vu_sqes, vu->vu_sqes_size);
+	if (vu->vu_cq_ring != MAP_FAILED && vu->vu_cq_ring != vu->vu_sq_ring)
+		(void) munmap(vu->vu_cq_ring, vu->vu_cq_ring_size);
+	if (vu->vu_sq_ring != MAP_FAILED)
+		(void) munmap(vu->vu_sq_ring, vu->vu_sq_ring_size);
+	(void) close(vu->vu_fd);
+}
+
+/*
+ * Set up a ring for the file, or return NULL if io_uring can't be used,
+ * in which case the vdev does all of its I/O on vdev_file_taskq.
+ */
+static vdev_file_uring_t *
+vdev_file_uring_create(zfs_file_t *fp)
+{
+	struct io_uring_params p;
+	vdev_file_uring_t *vu;
+	uint8_t *sq, *cq;
+	int fd;
+
+	/* Reads of dumped files are copied to f_dump_fd by zfs_file_pread() */
+	if (!vdev_file_uring || fp->f_dump_fd != -1)
+		return (NULL);
+
+	memset(&p, 0, sizeof (p));
+	fd = syscall(__NR_io_uring_setup,
+	    MAX(MIN(vdev_file_uring_depth, 4096), 2), &p);
+	if (fd == -1)
+		return (NULL);
+
+	/* IORING_OP_READ and IORING_OP_WRITE came along with this one */
+	if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+		(void) close(fd);
+		return (NULL);
+	}
+
+	vu = kmem_zalloc(sizeof (*vu), KM_SLEEP);
+	vu->vu_fd = fd;
+	vu->vu_file_fd = fp->f_fd;
+	vu->vu_entries = p.sq_entries;
+	vu->vu_sq_ring_size = p.sq_off.array + p.sq_entries * sizeof (uint32_t);
+	vu->vu_cq_ring_size = p.cq_off.cqes +
+	    p.cq_entries * sizeof (struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		vu->vu_sq_ring_size = vu->vu_cq_ring_size =
+		    MAX(vu->vu_sq_ring_size, vu->vu_cq_ring_size);
+	}
+	vu->vu_sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+
+	vu->vu_sq_ring = mmap(NULL, vu->vu_sq_ring_size,
+	    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+	    IORING_OFF_SQ_RING);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		vu->vu_cq_ring = vu->vu_sq_ring;
+	} else {
+		vu->vu_cq_ring = mmap(NULL, vu->vu_cq_ring_size,
+		    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+		    IORING_OFF_CQ_RING);
+	}
+	vu->vu_sqes = mmap(NULL, vu->vu_sqes_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (vu->vu_sq_ring == MAP_FAILED || vu->vu_cq_ring == MAP_FAILED ||
+	    vu->vu_sqes == MAP_FAILED) {
+		vdev_file_uring_unmap(vu);
+		kmem_free(vu, sizeof (*vu));
+		return (NULL);
+	}
+
+	sq = vu->vu_sq_ring;
+	vu->vu_sq_tail = (uint32_t *)(sq + p.sq_off.tail);
+	vu->vu_sq_mask = (uint32_t *)(sq + p.sq_off.ring_mask);
+	vu->vu_sq_array = (uint32_t *)(sq + p.sq_off.array);
+	cq = vu->vu_cq_ring;
+	vu->vu_cq_head = (uint32_t *)(cq + p.cq_off.head);
+	vu->vu_cq_tail = (uint32_t *)(cq + p.cq_off.tail);
+	vu->vu_cq_mask = (uint32_t *)(cq + p.cq_off.ring_mask);
+	vu->vu_cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	mutex_init(&vu->vu_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&vu->vu_cv, NULL, CV_DEFAULT, NULL);
+	vu->vu_reaper = thread_create(NULL, 0, vdev_file_uring_reaper, vu, 0,
+	    NULL, TS_RUN | TS_JOINABLE, defclsyspri);
+
+	return (vu);
+}
+
+static void
+vdev_file_uring_destroy(vdev_file_uring_t *vu)
+{
+	uint32_t tail;
+
+	/*
+	 * Wait for stragglers, including a thread still submitting after its
+	 * I/O completed, and tell the reaper to exit with a nop.
+	 */
+	mutex_enter(&vu->vu_lock);
+	while (vu->vu_inflight != 0 || vu->vu_submitting)
+		cv_wait(&vu->vu_cv, &vu->vu_lock);
+	tail = *vu->vu_sq_tail;
+	(void) vdev_file_uring_get_sqe(vu, NULL, &tail, IORING_OP_NOP);
+	vdev_file_uring_submit(vu, tail, 1);
+	mutex_exit(&vu->vu_lock);
+	thread_join(vu->vu_reaper);
+
+	vdev_file_uring_unmap(vu);
+	cv_destroy(&vu->vu_cv);
+	mutex_destroy(&vu->vu_lock);
+	kmem_free(vu, sizeof (*vu));
+}
+#endif	/* VDEV_FILE_URING */
+
 static void
 vdev_file_hold(vdev_t *vd)
 {
@@ -147,6 +525,9 @@ vdev_file_open(vdev_t *vd, uint64_t *psize, uint64_t *max_psize,
 	}
 
 	vf->vf_file = fp;
+#ifdef VDEV_FILE_URING
+	vf->vf_uring = vdev_file_uring_create(fp);
+#endif
 
 #ifdef _KERNEL
 	/*
@@ -184,6 +565,10 @@ vdev_file_close(vdev_t *vd)
 	if (vd->vdev_reopening || vf == NULL)
 		return;
 
+#ifdef VDEV_FILE_URING
+	if (vf->vf_uring != NULL)
+		vdev_file_uring_destroy(vf->vf_uring);
+#endif
 	if (vf->vf_file != NULL) {
 		(void) zfs_file_close(vf->vf_file);
 	}
@@ -294,6 +679,11 @@ vdev_file_io_start(zio_t *zio)
 
 	zio->io_target_timestamp = zio_handle_io_delay(zio);
 
+#ifdef VDEV_FILE_URING
+	if (vf->vf_uring != NULL && vdev_file_uring_io_start(vf->vf_uring, zio))
+		return;
+#endif
+
 	VERIFY3U(taskq_dispatch(vdev_file_taskq, vdev_file_io_strategy, zio,
 	    TQ_SLEEP), !=, TASKQID_INVALID);
 }
@@ -55,6 +55,285 @@
 #include <sys/dmu_objset.h>
 #include <sys/dsl_dir.h>
 
+/*
+ * Directory name cache
+ *
+ * The Linux dcache keeps most lookups from ever reaching zfs_dirlook(),
+ * but it is largely bypassed on case-insensitive and mixed sensitivity
+ * datasets (no negative dentries) and by NFS/SMB servers, which then pay
+ * for a zap_lookup_norm() and the normalization of the name on every
+ * lookup.  To absorb those, each directory znode keeps a small hash of the
+ * results of its recent zap lookups, both positive (object id, and the
+ * real name for case-insensitive lookups) and negative.
+ *
+ * Entries are keyed on the name exactly as it was looked up and on the
+ * match type, so no normalization is needed to probe the cache; a
+ * lookup's result only depends on those and on the directory contents.
+ * The cache is allocated on a directory's first lookup, so other znodes
+ * only pay for the z_namecache pointer.  Every change to the directory's
+ * entries (zfs_link_create() and zfs_dropname()) or reload of the
+ * directory (zfs_rezget()) empties the cache and bumps zn_gen, and a
+ * lookup only caches its result if the generation did not change while
+ * it was in the zap, so a result raced by a concurrent change is never
+ * cached.
+ */
+#define	ZFS_NAMECACHE_BUCKETS	16
+
+typedef struct zfs_namecache_entry {
+	struct zfs_namecache_entry *zne_next;
+	uint64_t	zne_hash;
+	uint64_t	zne_zoid;	/* object id, for positive entries */
+	matchtype_t	zne_mt;
+	int		zne_error;	/* 0 or ENOENT */
+	boolean_t	zne_conflict;	/* case conflict (ED_CASE_CONFLICT) */
+	uint16_t	zne_namelen;	/* including the terminating NUL */
+	uint16_t	zne_reallen;	/* real name, or 0 if not recorded */
+	char		zne_name[];	/* name, then real name */
+} zfs_namecache_entry_t;
+
+typedef struct zfs_namecache {
+	kmutex_t	zn_lock;	/* protects everything below */
+	uint64_t	zn_gen;		/* bumped on dirent changes */
+	uint_t		zn_count;
+	uint_t		zn_evict;	/* next bucket to evict from */
+	zfs_namecache_entry_t *zn_buckets[ZFS_NAMECACHE_BUCKETS];
+} zfs_namecache_t;
+
+/*
+ * Maximum number of names cached per directory; 0 disables the cache.
+ */
+static uint_t zfs_namecache_dir_entries = 64;
+
+static uint64_t
+zfs_namecache_hash(const char *name, matchtype_t mt)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL ^ mt;
+
+	for (const uint8_t *cp = (const uint8_t *)name; *cp != '\0'; cp++)
+		hash = (hash ^ *cp) * 0x100000001b3ULL;
+	return (hash);
+}
+
+static inline size_t
+zfs_namecache_entry_size(const zfs_namecache_entry_t *zne)
+{
+	return (sizeof (*zne) + zne->zne_namelen + zne->zne_reallen);
+}
+
+/*
+ * Return the directory's cache, allocating it on first use.
+ */
+static zfs_namecache_t *
+zfs_namecache_get(znode_t *dzp)
+{
+	zfs_namecache_t *zc = READ_ONCE(dzp->z_namecache);
+
+	if (zc != NULL)
+		return (zc);
+
+	ASSERT(S_ISDIR(ZTOI(dzp)->i_mode));
+	zc = kmem_zalloc(sizeof (*zc), KM_SLEEP);
+	mutex_init(&zc->zn_lock, NULL, MUTEX_DEFAULT, NULL);
+	if (atomic_cas_ptr(&dzp->z_namecache, NULL, zc) != NULL) {
+		/* lost the race to another lookup */
+		mutex_destroy(&zc->zn_lock);
+		kmem_free(zc, sizeof (*zc));
+		zc = READ_ONCE(dzp->z_namecache);
+	}
+	return (zc);
+}
+
+static void
+zfs_namecache_empty(zfs_namecache_t *zc)
+{
+	ASSERT(MUTEX_HELD(&zc->zn_lock));
+
+	for (int i = 0; i < ZFS_NAMECACHE_BUCKETS; i++) {
+		zfs_namecache_entry_t *zne, *next;
+
+		for (zne = zc->zn_buckets[i]; zne != NULL; zne = next) {
+			next = zne->zne_next;
+			kmem_free(zne, zfs_namecache_entry_size(zne));
+		}
+		zc->zn_buckets[i] = NULL;
+	}
+	zc->zn_count = 0;
+}
+
+/*
+ * Drop every cached name of the directory.  Must be called after (not
+ * before) the change to the directory's entries.
+ */
+void
+zfs_namecache_purge(znode_t *dzp)
+{
+	zfs_namecache_t *zc = READ_ONCE(dzp->z_namecache);
+
+	/* no lookup can have sampled a generation yet */
+	if (zc == NULL)
+		return;
+
+	mutex_enter(&zc->zn_lock);
+	zc->zn_gen++;
+	zfs_namecache_empty(zc);
+	mutex_exit(&zc->zn_lock);
+}
+
+/*
+ * Free the directory's cache as its inode is destroyed.
+ */
+void
+zfs_namecache_destroy(znode_t *dzp)
+{
+	zfs_namecache_t *zc = dzp->z_namecache;
+
+	if (zc == NULL)
+		return;
+
+	dzp->z_namecache = NULL;
+	mutex_enter(&zc->zn_lock);
+	zfs_namecache_empty(zc);
+	mutex_exit(&zc->zn_lock);
+	mutex_destroy(&zc->zn_lock);
+	kmem_free(zc, sizeof (*zc));
+}
+
+/*
+ * Look the name up in the directory's cache.  Returns B_TRUE, with the
+ * result of the lookup in *errorp, on a hit.  On a miss the current
+ * generation is returned in *genp for zfs_namecache_insert().  If
+ * wantreal is set, a positive entry only hits if it recorded the real
+ * name, which is then copied to rpnp.
+ */
+static boolean_t
+zfs_namecache_lookup(znode_t *dzp, const char *name, matchtype_t mt,
+    uint64_t hash, boolean_t *conflictp, boolean_t wantreal,
+    pathname_t *rpnp, uint64_t *zoidp, int *errorp, uint64_t *genp)
+{
+	zfs_namecache_t *zc = zfs_namecache_get(dzp);
+	zfs_namecache_entry_t *zne;
+	boolean_t hit = B_FALSE;
+
+	mutex_enter(&zc->zn_lock);
+	*genp = zc->zn_gen;
+	for (zne = zc->zn_buckets[hash % ZFS_NAMECACHE_BUCKETS]; zne != NULL;
+	    zne = zne->zne_next) {
+		if (zne->zne_hash != hash || zne->zne_mt != mt ||
+		    strcmp(zne->zne_name, name) != 0)
+			continue;
+		/*
+		 * A positive entry recorded by a lookup that didn't ask for
+		 * the real name can't satisfy one that does; the miss
+		 * replaces it with an entry that serves both.
+		 */
+		if (wantreal && zne->zne_error == 0 && zne->zne_reallen == 0)
+			break;
+		if (wantreal && zne->zne_error == 0) {
+			(void) strlcpy(rpnp->pn_buf,
+			    zne->zne_name + zne->zne_namelen,
+			    rpnp->pn_bufsize);
+		}
+		*zoidp = zne->zne_zoid;
+		*conflictp = zne->zne_conflict;
+		*errorp = zne->zne_error;
+		hit = B_TRUE;
+		break;
+	}
+	mutex_exit(&zc->zn_lock);
+
+	dataset_kstats_update_namecache_kstats(&ZTOZSB(dzp)->z_kstat, hit);
+	return (hit);
+}
+
+/*
+ * Remove the oldest (last) entry of a bucket, preferring the given one
+ * and otherwise taking the buckets in turn.
+ */
+static void
+zfs_namecache_evict(zfs_namecache_t *zc, uint_t bucket)
+{
+	zfs_namecache_entry_t **znep;
+
+	ASSERT(MUTEX_HELD(&zc->zn_lock));
+	ASSERT3U(zc->zn_count, >, 0);
+
+	if (zc->zn_buckets[bucket] == NULL) {
+		while (zc->zn_buckets[zc->zn_evict] == NULL) {
+			zc->zn_evict = (zc->zn_evict + 1) %
+			    ZFS_NAMECACHE_BUCKETS;
+		}
+		bucket = zc->zn_evict;
+		zc->zn_evict = (zc->zn_evict + 1) % ZFS_NAMECACHE_BUCKETS;
+	}
+
+	znep = &zc->zn_buckets[bucket];
+	while ((*znep)->zne_next != NULL)
+		znep = &(*znep)->zne_next;
+	kmem_free(*znep, zfs_namecache_entry_size(*znep));
+	*znep = NULL;
+	zc->zn_count--;
+}
+
+static void
+zfs_namecache_insert(znode_t *dzp, uint64_t gen, const char *name,
+    matchtype_t mt, uint64_t hash, boolean_t conflict, const char *realname,
+    uint64_t zoid, int error)
+{
+	zfs_namecache_t *zc = dzp->z_namecache;
+	size_t namelen = strlen(name) + 1;
+	size_t reallen = (realname != NULL) ? strlen(realname) + 1 : 0;
+	uint_t bucket = hash % ZFS_NAMECACHE_BUCKETS;
+	uint_t max = zfs_namecache_dir_entries;
+	zfs_namecache_entry_t *zne, **znep;
+
+	ASSERT(error == 0 || error == ENOENT);
+	ASSERT3P(zc, !=, NULL);
+	if (namelen > UINT16_MAX || reallen > UINT16_MAX || max == 0)
+		return;
+
+	zne = kmem_alloc(sizeof (*zne) + namelen + reallen, KM_SLEEP);
+	zne->zne_hash = hash;
+	zne->zne_zoid = zoid;
+	zne->zne_mt = mt;
+	zne->zne_error = error;
+	zne->zne_conflict = conflict;
+	zne->zne_namelen = namelen;
+	zne->zne_reallen = reallen;
+	memcpy(zne->zne_name, name, namelen);
+	if (reallen != 0)
+		memcpy(zne->zne_name + namelen, realname, reallen);
+
+	mutex_enter(&zc->zn_lock);
+	if (zc->zn_gen != gen) {
+		/* the directory changed while we were looking */
+		mutex_exit(&zc->zn_lock);
+		kmem_free(zne, zfs_namecache_entry_size(zne));
+		return;
+	}
+
+	/* replace any stale entry for the same name */
+	for (znep = &zc->zn_buckets[bucket]; *znep != NULL;
+	    znep = &(*znep)->zne_next) {
+		zfs_namecache_entry_t *old = *znep;
+
+		if (old->zne_hash == hash && old->zne_mt == mt &&
+		    strcmp(old->zne_name, name) == 0) {
+			*znep = old->zne_next;
+			zc->zn_count--;
+			kmem_free(old, zfs_namecache_entry_size(old));
+			break;
+		}
+	}
+
+	/* make room, then insert at the head of the bucket */
+	while (zc->zn_count >= max)
+		zfs_namecache_evict(zc, bucket);
+	zne->zne_next = zc->zn_buckets[bucket];
+	zc->zn_buckets[bucket] = zne;
+	zc->zn_count++;
+	mutex_exit(&zc->zn_lock);
+}
+
 /*
  * zfs_match_find() is used by zfs_dirent_lock() to perform zap lookups
  * of names after deciding which is the appropriate lookup interface.
@@ -65,8 +344,22 @@ zfs_match_find(zfsvfs_t *zfsvfs, znode_t *dzp, const char *name,
     uint64_t *zoid)
 {
 	boolean_t conflict = B_FALSE;
+	boolean_t cache = zfs_namecache_dir_entries != 0;
+	/*
+	 * Only the normalizing lookup fills in the real name; without
+	 * normalization the caller copies it from the name itself.
+	 */
+	boolean_t wantreal = (rpnp != NULL && zfsvfs->z_norm);
+	uint64_t hash = 0, gen = 0;
 	int error;
 
+	if (cache) {
+		hash = zfs_namecache_hash(name, mt);
+		if (zfs_namecache_lookup(dzp, name, mt, hash, &conflict,
+		    wantreal, rpnp, zoid, &error, &gen))
+			goto out;
+	}
+
 	if (zfsvfs->z_norm) {
 		size_t bufsz = 0;
 		char *buf = NULL;
@@ -96,6 +389,13 @@ zfs_match_find(zfsvfs_t *zfsvfs, znode_t *dzp, const char *name,
 	if (error == EOVERFLOW)
 		error = 0;
 
+	if (cache && (error == 0 || error == ENOENT)) {
+		zfs_namecache_insert(dzp, gen, name, mt, hash, conflict,
+		    (wantreal && error == 0) ? rpnp->pn_buf : NULL,
+		    error == 0 ? *zoid : 0, error);
+	}
+
+out:
 	if (zfsvfs->z_norm && !error && deflags)
 		*deflags = conflict ? ED_CASE_CONFLICT : 0;
 
@@ -831,6 +1131,7 @@ zfs_link_create(zfs_dirlock_t *dl, znode_t *zp, dmu_tx_t *tx, int flag)
 	value = zfs_dirent(zp, zp->z_mode);
 	error = zap_add(ZTOZSB(zp)->z_os, dzp->z_id, dl->dl_name, 8, 1,
 	    &value, tx);
+	zfs_namecache_purge(dzp);
 
 	/*
 	 * zap_add could fail to add the entry if it exceeds the capacity of the
@@ -929,6 +1230,7 @@ zfs_dropname(zfs_dirlock_t *dl, znode_t *zp, znode_t *dzp, dmu_tx_t *tx,
 		error = zap_remove(ZTOZSB(zp)->z_os, dzp->z_id, dl->dl_name,
 		    tx);
 	}
+	zfs_namecache_purge(dzp);
 
 	return (error);
 }
@@ -1274,3 +1576,6 @@ zfs_sticky_remove_access(znode_t *zdp, znode_t *zp, cred_t *cr)
 	else
 		return (secpolicy_vnode_remove(cr));
 }
+
+ZFS_MODULE_PARAM(zfs, zfs_, namecache_dir_entries, UINT, ZMOD_RW,
+	"Max names cached per directory for lookups, 0 to disable");
@@ -136,6 +136,7 @@ zfs_znode_cache_constructor(void *buf, void *arg, int kmflags)
 	zp->z_xattr_parent = 0;
 	zp->z_sync_writes_cnt = 0;
 	zp->z_async_writes_cnt = 0;
+	zp->z_namecache = NULL;
 
 	return (0);
 }
@@ -157,6 +158,7 @@ zfs_znode_cache_destructor(void *buf, void *arg)
 	ASSERT3P(zp->z_dirlocks, ==, NULL);
 	ASSERT3P(zp->z_acl_cached, ==, NULL);
 	ASSERT3P(zp->z_xattr_cached, ==, NULL);
+	ASSERT3P(zp->z_namecache, ==, NULL);
 
 	ASSERT0(atomic_load_32(&zp->z_sync_writes_cnt));
 	ASSERT0(atomic_load_32(&zp->z_async_writes_cnt));
@@ -404,6 +406,8 @@ zfs_inode_destroy(struct inode *ip)
 		zp->z_xattr_cached = NULL;
 	}
 
+	zfs_namecache_destroy(zp);
+
 	kmem_cache_free(znode_cache, zp);
 }
 
@@ -557,6 +561,7 @@ zfs_znode_alloc(zfsvfs_t *zfsvfs, dmu_buf_t *db, int blksz,
 	ASSERT(zp->z_dirlocks == NULL);
 	ASSERT3P(zp->z_acl_cached, ==, NULL);
 	ASSERT3P(zp->z_xattr_cached, ==, NULL);
+	ASSERT3P(zp->z_namecache, ==, NULL);
 	zp->z_unlinked = B_FALSE;
 	zp->z_atime_dirty = B_FALSE;
 #if !defined(HAVE_FILEMAP_RANGE_HAS_PAGE)
@@ -1226,6 +1231,8 @@ zfs_rezget(znode_t *zp)
 	}
 	rw_exit(&zp->z_xattr_lock);
 
+	zfs_namecache_purge(zp);
+
 	ASSERT(zp->z_sa_hdl == NULL);
 	err = sa_buf_hold(zfsvfs->z_os, obj_num, NULL, &db);
 	if (err) {
@@ -381,17 +381,32 @@ error:
 	return (ret);
 }
 
+/*
+ * Called by the ICP as GCM writes out ciphertext; pass the new piece on to
+ * the sink while it is still in cache.
+ */
+static void
+zio_crypt_sink_output(void *arg, size_t len)
+{
+	zio_crypt_sink_t *sink = arg;
+
+	sink->zsk_func(sink->zsk_arg, sink->zsk_buf + sink->zsk_done, len);
+	sink->zsk_done += len;
+}
+
 /*
  * This function handles all encryption and decryption in zfs. When
  * encrypting it expects puio to reference the plaintext and cuio to
  * reference the ciphertext. cuio must have enough space for the
  * ciphertext + room for a MAC. datalen should be the length of the
- * plaintext / ciphertext alone.
+ * plaintext / ciphertext alone. If sink is given, the ciphertext must be
+ * contiguous at sink->zsk_buf.
  */
 static int
 zio_do_crypt_uio(boolean_t encrypt, uint64_t crypt, crypto_key_t *key,
     crypto_ctx_template_t tmpl, uint8_t *ivbuf, uint_t datalen,
-    zfs_uio_t *puio, zfs_uio_t *cuio, uint8_t *authbuf, uint_t auth_len)
+    zfs_uio_t *puio, zfs_uio_t *cuio, uint8_t *authbuf, uint_t auth_len,
+    zio_crypt_sink_t *sink)
 {
 	int ret;
 	crypto_data_t plaindata, cipherdata;
@@ -446,6 +461,8 @@ zio_do_crypt_uio(boolean_t encrypt, uint64_t crypt, crypto_key_t *key,
 		gcmp.pAAD = authbuf;
 		gcmp.ulTagBits = CRYPTO_BYTES2BITS(maclen);
 		gcmp.pIv = ivbuf;
+		gcmp.pOutputCb = (sink != NULL) ? zio_crypt_sink_output : NULL;
+		gcmp.pOutputCbArg = sink;
 
 		mech.cm_param = (char *)(&gcmp);
 		mech.cm_param_len = sizeof (CK_AES_GCM_PARAMS);
@@ -543,7 +560,7 @@ zio_crypt_key_wrap(crypto_key_t *cwkey, zio_crypt_key_t *key, uint8_t *iv,
 
 	/* encrypt the keys and store the resulting ciphertext and mac */
 	ret = zio_do_crypt_uio(B_TRUE, crypt, cwkey, NULL, iv, enc_len,
-	    &puio, &cuio, (uint8_t *)aad, aad_len);
+	    &puio, &cuio, (uint8_t *)aad, aad_len, NULL);
 	if (ret != 0)
 		goto error;
 
@@ -605,7 +622,7 @@ zio_crypt_key_unwrap(crypto_key_t *cwkey, uint64_t crypt, uint64_t version,
 
 	/* decrypt the keys and store the result in the output buffers */
 	ret = zio_do_crypt_uio(B_FALSE, crypt, cwkey, NULL, iv, enc_len,
-	    &puio, &cuio, (uint8_t *)aad, aad_len);
+	    &puio, &cuio, (uint8_t *)aad, aad_len, NULL);
 	if (ret != 0)
 		goto error;
 
@@ -1889,13 +1906,16 @@ error:
 }
 
 /*
- * Primary encryption / decryption entrypoint for zio data.
+ * Primary encryption / decryption entrypoint for zio data. When encrypting
+ * a block whose ciphertext is laid out contiguously (anything but ZIL and
+ * dnode blocks) with AES-GCM, the ciphertext is also passed to sink, if one
+ * is given.
  */
 int
 zio_do_crypt_data(boolean_t encrypt, zio_crypt_key_t *key,
     dmu_object_type_t ot, boolean_t byteswap, uint8_t *salt, uint8_t *iv,
     uint8_t *mac, uint_t datalen, uint8_t *plainbuf, uint8_t *cipherbuf,
-    boolean_t *no_crypt)
+    boolean_t *no_crypt, zio_crypt_sink_t *sink)
 {
 	int ret;
 	boolean_t locked = B_FALSE;
@@ -1977,9 +1997,16 @@ zio_do_crypt_data(boolean_t encrypt, zio_crypt_key_t *key,
 	if (ret != 0)
 		goto error;
 
+	if (sink != NULL) {
+		sink->zsk_buf = cipherbuf;
+		sink->zsk_done = 0;
+		if (!encrypt || ot == DMU_OT_INTENT_LOG || ot == DMU_OT_DNODE)
+			sink = NULL;
+	}
+
 	/* perform the encryption / decryption in software */
 	ret = zio_do_crypt_uio(encrypt, key->zk_crypt, ckey, tmpl, iv, enc_len,
-	    &puio, &cuio, authbuf, auth_len);
+	    &puio, &cuio, authbuf, auth_len, sink);
 	if (ret != 0)
 		goto error;
 
@@ -2030,7 +2057,7 @@ zio_do_crypt_abd(boolean_t encrypt, zio_crypt_key_t *key, dmu_object_type_t ot,
 	}
 
 	ret = zio_do_crypt_data(encrypt, key, ot, byteswap, salt, iv, mac,
-	    datalen, ptmp, ctmp, no_crypt);
+	    datalen, ptmp, ctmp, no_crypt, NULL);
 	if (ret != 0)
 		goto error;
 
@@ -326,6 +326,109 @@ static const uint8_t u8_valid_max_2nd_byte[0x100] = {
 };
 
 
+/*
+ * Most file names are plain 7-bit ASCII, and for those the per-character
+ * table walk below is pure overhead. The following helpers let the callers
+ * check, fold and compare such runs eight bytes at a time in a general
+ * purpose register. Names are short enough that saving and restoring the
+ * FPU state for SIMD would cost more than it saves, and this works the same
+ * on every architecture and in both kernel and user space.
+ */
+#define	U8_WORD_SIZE		sizeof (uint64_t)
+#define	U8_WORD_ONES		0x0101010101010101ULL
+#define	U8_WORD_HIGHS		0x8080808080808080ULL
+#define	U8_WORD_BYTES(c)	(U8_WORD_ONES * (uint64_t)(c))
+
+static inline uint64_t
+u8_word_load(const uchar_t *s)
+{
+	uint64_t w;
+
+	memcpy(&w, s, sizeof (w));
+	return (w);
+}
+
+/*
+ * Returns B_TRUE if every byte of the word is a 7-bit ASCII character and,
+ * if nonul is set, none of them is a NUL.
+ */
+static inline boolean_t
+u8_word_is_ascii(uint64_t w, boolean_t nonul)
+{
+	if (w & U8_WORD_HIGHS)
+		return (B_FALSE);
+
+	if (nonul && ((w - U8_WORD_ONES) & ~w & U8_WORD_HIGHS))
+		return (B_FALSE);
+
+	return (B_TRUE);
+}
+
+/*
+ * Applies U8_ASCII_TOUPPER() or U8_ASCII_TOLOWER() to every byte of a word
+ * that has already passed u8_word_is_ascii(). Since no byte has its high bit
+ * set, adding (0x80 - lo) sets the high bit exactly in the bytes >= lo and
+ * adding (0x7f - hi) sets it exactly in the bytes > hi, without any carry
+ * into the neighbouring byte. The difference selects the letters, whose
+ * case bit (0x20) is then flipped.
+ */
+static inline uint64_t
+u8_word_case_conv(uint64_t w, boolean_t is_it_toupper)
+{
+	uint64_t lo, hi;
+
+	if (is_it_toupper) {
+		lo = w + U8_WORD_BYTES(0x80 - 'a');
+		hi = w + U8_WORD_BYTES(0x7f - 'z');
+	} else {
+		lo = w + U8_WORD_BYTES(0x80 - 'A');
+		hi = w + U8_WORD_BYTES(0x7f - 'Z');
+	}
+
+	return (w ^ ((lo & ~hi & U8_WORD_HIGHS) >> 2));
+}
+
+/*
+ * Returns the length of the longest run of leading words of s1 and s2 that
+ * are ASCII and equal after the requested case conversion. If the strings
+ * are to be normalized, a word only counts when the byte following it in
+ * each string is ASCII as well, since a combining mark there could still
+ * change its last character.
+ */
+static size_t
+u8_ascii_prefix(const uchar_t *s1, const uchar_t *s2, size_t n1, size_t n2,
+    boolean_t normalize, boolean_t is_it_toupper, boolean_t is_it_tolower)
+{
+	uint64_t w1, w2;
+	size_t i;
+
+	for (i = 0; i + U8_WORD_SIZE <= n1 && i + U8_WORD_SIZE <= n2;
+	    i += U8_WORD_SIZE) {
+		w1 = u8_word_load(s1 + i);
+		w2 = u8_word_load(s2 + i);
+
+		if (!u8_word_is_ascii(w1 | w2, B_FALSE))
+			break;
+
+		if (is_it_toupper || is_it_tolower) {
+			w1 = u8_word_case_conv(w1, is_it_toupper);
+			w2 = u8_word_case_conv(w2, is_it_toupper);
+		}
+
+		if (w1 != w2)
+			break;
+
+		if (normalize &&
+		    ((i + U8_WORD_SIZE < n1 &&
+		    !U8_ISASCII(s1[i + U8_WORD_SIZE])) ||
+		    (i + U8_WORD_SIZE < n2 &&
+		    !U8_ISASCII(s2[i + U8_WORD_SIZE]))))
+			break;
+	}
+
+	return (i);
+}
+
 /*
  * The u8_validate() validates on the given UTF-8 character string and
  * calculate the byte length. It is quite similar to mblen(3C) except that
@@ -1852,6 +1955,7 @@ u8_strcmp(const char *s1, const char *s2, size_t n, int flag, size_t uv,
     int *errnum)
 {
 	int f;
+	size_t i;
 	size_t n1;
 	size_t n2;
 
@@ -1901,6 +2005,18 @@ u8_strcmp(const char *s1, const char *s2, size_t n, int flag, size_t uv,
 			n2 = n;
 	}
 
+	/*
+	 * Skip over the common ASCII prefix a word at a time; only the rest
+	 * needs to go through the per-character code below.
+	 */
+	i = u8_ascii_prefix((const uchar_t *)s1, (const uchar_t *)s2, n1, n2,
+	    (flag & (U8_CANON_DECOMP | U8_COMPAT_DECOMP | U8_CANON_COMP)) != 0,
+	    (flag & U8_STRCMP_CI_UPPER) != 0, (flag & U8_STRCMP_CI_LOWER) != 0);
+	s1 += i;
+	s2 += i;
+	n1 -= i;
+	n2 -= i;
+
 	/*
 	 * Simple case conversion can be done much faster and so we do
 	 * them separately here.
@@ -1987,6 +2103,24 @@ u8_textprep_str(char *inarray, size_t *inlen, char *outarray, size_t *outlen,
 	 */
 	if (f == 0) {
 		while (ib < ibtail) {
+			/*
+			 * Take the ASCII runs a word at a time.
+			 */
+			if ((ibtail - ib) >= U8_WORD_SIZE &&
+			    (obtail - ob) >= U8_WORD_SIZE) {
+				uint64_t w = u8_word_load(ib);
+
+				if (u8_word_is_ascii(w, do_not_ignore_null)) {
+					if (is_it_toupper || is_it_tolower)
+						w = u8_word_case_conv(w,
+						    is_it_toupper);
+					memcpy(ob, &w, sizeof (w));
+					ib += U8_WORD_SIZE;
+					ob += U8_WORD_SIZE;
+					continue;
+				}
+			}
+
 			if (*ib == '\0' && do_not_ignore_null)
 				break;
 
@@ -2072,6 +2206,28 @@ u8_textprep_str(char *inarray, size_t *inlen, char *outarray, size_t *outlen,
 		canonical_composition = flag & U8_CANON_COMP;
 
 		while (ib < ibtail) {
+			/*
+			 * As below, a run of ASCII characters can be copied
+			 * over as is, a word at a time, as long as the
+			 * character following it is ASCII as well.
+			 */
+			if ((ibtail - ib) >= U8_WORD_SIZE &&
+			    (obtail - ob) >= U8_WORD_SIZE &&
+			    ((ibtail - ib) == U8_WORD_SIZE ||
+			    U8_ISASCII(ib[U8_WORD_SIZE]))) {
+				uint64_t w = u8_word_load(ib);
+
+				if (u8_word_is_ascii(w, do_not_ignore_null)) {
+					if (is_it_toupper || is_it_tolower)
+						w = u8_word_case_conv(w,
+						    is_it_toupper);
+					memcpy(ob, &w, sizeof (w));
+					ib += U8_WORD_SIZE;
+					ob += U8_WORD_SIZE;
+					continue;
+				}
+			}
+
 			if (*ib == '\0' && do_not_ignore_null)
 				break;
 
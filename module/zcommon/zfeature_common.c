@@ -749,6 +749,19 @@ zpool_feature_init(void)
 		    redact_list_spill_deps, sfeatures);
 	}
 
+	{
+		static const spa_feature_t compress_auto_deps[] = {
+			SPA_FEATURE_EXTENSIBLE_DATASET,
+			SPA_FEATURE_ZSTD_COMPRESS,
+			SPA_FEATURE_NONE
+		};
+		zfeature_register(SPA_FEATURE_COMPRESS_AUTO,
+		    "org.openzfs:compress_auto", "compress_auto",
+		    "Per-block choice of compression algorithm and level.",
+		    ZFEATURE_FLAG_READONLY_COMPAT | ZFEATURE_FLAG_PER_DATASET,
+		    ZFEATURE_TYPE_BOOLEAN, compress_auto_deps, sfeatures);
+	}
+
 	zfs_mod_list_supported_free(sfeatures);
 }
 
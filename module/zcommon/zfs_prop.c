@@ -134,6 +134,13 @@ zfs_prop_init(void)
 		{ "zstd-fast",
 		    ZIO_COMPLEVEL_ZSTD(ZIO_ZSTD_LEVEL_FAST_DEFAULT) },
 
+		/*
+		 * "auto" is stored as zstd with a reserved level, so that it
+		 * activates the zstd feature; the algorithm and level are then
+		 * picked for each block when it is written.
+		 */
+		{ "auto",	ZIO_COMPLEVEL_ZSTD(ZIO_ZSTD_LEVEL_AUTO) },
+
 		/*
 		 * ZSTD 1-19 are synthetic. We store the compression level in a
 		 * separate hidden property to avoid wasting a large amount of
@@ -415,7 +422,7 @@ zfs_prop_init(void)
 	zprop_register_index(ZFS_PROP_COMPRESSION, "compression",
 	    ZIO_COMPRESS_DEFAULT, PROP_INHERIT,
 	    ZFS_TYPE_FILESYSTEM | ZFS_TYPE_VOLUME,
-	    "on | off | lzjb | gzip | gzip-[1-9] | zle | lz4 | "
+	    "on | off | auto | lzjb | gzip | gzip-[1-9] | zle | lz4 | "
 	    "zstd | zstd-[1-19] | "
 	    "zstd-fast | zstd-fast-[1-10,20,30,40,50,60,70,80,90,100,500,1000]",
 	    "COMPRESS", compress_table, sfeatures);
@@ -451,6 +451,15 @@ static uint_t zfs_arc_meta_balance = 500;
  */
 static uint_t zfs_arc_dnode_limit_percent = 10;
 
+/*
+ * Percentage of arc_c that may be used to keep decompressed copies of
+ * compressed blocks which keep getting decompressed (see "Decompressed block
+ * cache" below), and the number of times a block has to be decompressed
+ * before it is worth keeping.  Disabled by default.
+ */
+uint_t zfs_arc_dcache_percent = 0;
+uint_t zfs_arc_dcache_min_decompress = 4;
+
 /*
  * These tunables are Linux-specific
  */
@@ -624,6 +633,10 @@ arc_stats_t arc_stats = {
 	{ "arc_raw_size",		KSTAT_DATA_UINT64 },
 	{ "cached_only_in_progress",	KSTAT_DATA_UINT64 },
 	{ "abd_chunk_waste_size",	KSTAT_DATA_UINT64 },
+	{ "dcache_hits",		KSTAT_DATA_UINT64 },
+	{ "dcache_misses",		KSTAT_DATA_UINT64 },
+	{ "dcache_evictions",		KSTAT_DATA_UINT64 },
+	{ "dcache_size",		KSTAT_DATA_UINT64 },
 };
 
 arc_sums_t arc_sums;
@@ -1877,7 +1890,7 @@ arc_hdr_decrypt(arc_buf_hdr_t *hdr, spa_t *spa, const zbookmark_phys_t *zb)
 	ret = spa_do_crypt_abd(B_FALSE, spa, zb, hdr->b_crypt_hdr.b_ot,
 	    B_FALSE, bswap, hdr->b_crypt_hdr.b_salt, hdr->b_crypt_hdr.b_iv,
 	    hdr->b_crypt_hdr.b_mac, HDR_GET_PSIZE(hdr), hdr->b_l1hdr.b_pabd,
-	    hdr->b_crypt_hdr.b_rabd, &no_crypt);
+	    hdr->b_crypt_hdr.b_rabd, &no_crypt, NULL);
 	if (ret != 0)
 		goto error;
 
@@ -1998,6 +2011,284 @@ arc_buf_untransform_in_place(arc_buf_t *buf)
 	hdr->b_crypt_hdr.b_ebufcnt -= 1;
 }
 
+/*
+ * Decompressed block cache
+ *
+ * With compressed ARC, a hdr only keeps its data decompressed for as long as
+ * some buf on it is decompressed.  A block which is read over and over again
+ * through short-lived bufs is decompressed again by every arc_buf_fill().
+ * Once a block has been decompressed zfs_arc_dcache_min_decompress times, a
+ * copy of its decompressed data is kept here, keyed by its hdr, and later
+ * fills copy from it instead.  The cache has its own LRU and is limited to
+ * zfs_arc_dcache_percent of arc_c; its memory counts towards arc_size, so
+ * the ARC shrinks the rest of the cache to make room for it.
+ *
+ * Entries are only made for hdrs in the hash table, whose data can't change,
+ * and are dropped with the hdr's b_pabd, or when the hdr loses its identity.
+ * b_dcached is set on the hdr under its hash lock and arc_dcache_lock when an
+ * entry is added, and cleared under arc_dcache_lock whenever the entry goes,
+ * be it through the hdr or by eviction from the LRU, so that an evicted block
+ * can be admitted again.  It may be read without arc_dcache_lock as a hint;
+ * a stale B_TRUE only costs a lookup which finds nothing.  Entries in the
+ * cache always refer to live hdrs, as the hdr removes its entry before it
+ * goes away.  Lock ordering is hash lock, then arc_dcache_lock.
+ */
+typedef struct arc_dcache_ent {
+	avl_node_t		ade_avl;
+	list_node_t		ade_lru;
+	arc_buf_hdr_t		*ade_hdr;
+	void			*ade_data;
+	uint64_t		ade_size;
+	uint_t			ade_refs;	/* fills copying from it */
+	boolean_t		ade_removed;
+} arc_dcache_ent_t;
+
+static kmutex_t arc_dcache_lock;
+static avl_tree_t arc_dcache_tree;
+static list_t arc_dcache_lru;		/* most recently used first */
+static uint64_t arc_dcache_size;
+
+static int
+arc_dcache_compare(const void *x1, const void *x2)
+{
+	const arc_dcache_ent_t *e1 = x1;
+	const arc_dcache_ent_t *e2 = x2;
+
+	return (TREE_PCMP(e1->ade_hdr, e2->ade_hdr));
+}
+
+static uint64_t
+arc_dcache_limit(void)
+{
+	return (arc_c / 100 * MIN(zfs_arc_dcache_percent, 100));
+}
+
+static arc_dcache_ent_t *
+arc_dcache_find(arc_buf_hdr_t *hdr)
+{
+	arc_dcache_ent_t search;
+
+	ASSERT(MUTEX_HELD(&arc_dcache_lock));
+	search.ade_hdr = hdr;
+	return (avl_find(&arc_dcache_tree, &search, NULL));
+}
+
+static void
+arc_dcache_free(arc_dcache_ent_t *ade)
+{
+	ASSERT0(ade->ade_refs);
+	arc_space_return(ade->ade_size, ARC_SPACE_DCACHE);
+	zio_data_buf_free(ade->ade_data, ade->ade_size);
+	kmem_free(ade, sizeof (*ade));
+}
+
+/*
+ * Take an entry out of the cache and clear its hdr's b_dcached.  If a fill
+ * is still copying from it, the last one to finish frees it.
+ */
+static boolean_t
+arc_dcache_unlink(arc_dcache_ent_t *ade)
+{
+	ASSERT(MUTEX_HELD(&arc_dcache_lock));
+	avl_remove(&arc_dcache_tree, ade);
+	list_remove(&arc_dcache_lru, ade);
+	arc_dcache_size -= ade->ade_size;
+	ade->ade_hdr->b_l1hdr.b_dcached = B_FALSE;
+	ade->ade_removed = B_TRUE;
+	return (ade->ade_refs == 0);
+}
+
+/*
+ * Evict least recently used entries until the cache is no bigger than limit,
+ * returning the number of bytes evicted.
+ */
+static uint64_t
+arc_dcache_trim(uint64_t limit)
+{
+	arc_dcache_ent_t *ade;
+	list_t free_list;
+	uint64_t evicted = 0;
+
+	if (arc_dcache_size <= limit)
+		return (0);
+
+	list_create(&free_list, sizeof (arc_dcache_ent_t),
+	    offsetof(arc_dcache_ent_t, ade_lru));
+
+	mutex_enter(&arc_dcache_lock);
+	while (arc_dcache_size > limit &&
+	    (ade = list_tail(&arc_dcache_lru)) != NULL) {
+		evicted += ade->ade_size;
+		if (arc_dcache_unlink(ade))
+			list_insert_head(&free_list, ade);
+		ARCSTAT_BUMP(arcstat_dcache_evictions);
+	}
+	mutex_exit(&arc_dcache_lock);
+
+	while ((ade = list_remove_head(&free_list)) != NULL)
+		arc_dcache_free(ade);
+	list_destroy(&free_list);
+
+	return (evicted);
+}
+
+/*
+ * Fill a decompressed buf from the cache, returning whether it could.
+ */
+static boolean_t
+arc_dcache_fill(arc_buf_t *buf)
+{
+	arc_buf_hdr_t *hdr = buf->b_hdr;
+	arc_dcache_ent_t *ade;
+	boolean_t last;
+
+	if (!hdr->b_l1hdr.b_dcached)
+		return (B_FALSE);
+
+	mutex_enter(&arc_dcache_lock);
+	ade = arc_dcache_find(hdr);
+	if (ade == NULL) {
+		mutex_exit(&arc_dcache_lock);
+		return (B_FALSE);
+	}
+	ASSERT3U(ade->ade_size, ==, arc_buf_size(buf));
+	ade->ade_refs++;
+	if (ade != list_head(&arc_dcache_lru)) {
+		list_remove(&arc_dcache_lru, ade);
+		list_insert_head(&arc_dcache_lru, ade);
+	}
+	mutex_exit(&arc_dcache_lock);
+
+	memcpy(buf->b_data, ade->ade_data, ade->ade_size);
+
+	mutex_enter(&arc_dcache_lock);
+	last = (--ade->ade_refs == 0 && ade->ade_removed);
+	mutex_exit(&arc_dcache_lock);
+	if (last)
+		arc_dcache_free(ade);
+
+	ARCSTAT_BUMP(arcstat_dcache_hits);
+	return (B_TRUE);
+}
+
+/*
+ * Called after decompressing the hdr's data into buf, before any byteswap.
+ * Counts the decompression, and keeps a copy of the data once the block has
+ * been decompressed often enough.  The caller holds the hash lock if
+ * hash_lock is NULL.
+ */
+static void
+arc_dcache_admit(arc_buf_t *buf, kmutex_t *hash_lock)
+{
+	arc_buf_hdr_t *hdr = buf->b_hdr;
+	uint64_t limit = arc_dcache_limit();
+	uint64_t size = arc_buf_size(buf);
+	arc_dcache_ent_t *ade;
+	boolean_t admit;
+
+	if (limit == 0 || HDR_PROTECTED(hdr))
+		return;
+
+	ARCSTAT_BUMP(arcstat_dcache_misses);
+
+	if (hash_lock != NULL)
+		mutex_enter(hash_lock);
+	admit = HDR_IN_HASH_TABLE(hdr) && !hdr->b_l1hdr.b_dcached &&
+	    size <= limit;
+	if (admit) {
+		if (hdr->b_l1hdr.b_decompress_cnt < UINT16_MAX)
+			hdr->b_l1hdr.b_decompress_cnt++;
+		admit = hdr->b_l1hdr.b_decompress_cnt >=
+		    zfs_arc_dcache_min_decompress;
+	}
+	if (hash_lock != NULL)
+		mutex_exit(hash_lock);
+	if (!admit)
+		return;
+
+	ade = kmem_alloc(sizeof (*ade), KM_SLEEP);
+	ade->ade_hdr = hdr;
+	ade->ade_data = zio_data_buf_alloc(size);
+	ade->ade_size = size;
+	ade->ade_refs = 0;
+	ade->ade_removed = B_FALSE;
+	memcpy(ade->ade_data, buf->b_data, size);
+	arc_space_consume(size, ARC_SPACE_DCACHE);
+
+	/*
+	 * The hdr can't have been destroyed while we allocated, buf holds
+	 * it, but it may have lost its identity or been added by another
+	 * fill in the meantime.
+	 */
+	if (hash_lock != NULL)
+		mutex_enter(hash_lock);
+	admit = HDR_IN_HASH_TABLE(hdr) && !hdr->b_l1hdr.b_dcached;
+	if (admit) {
+		mutex_enter(&arc_dcache_lock);
+		if (arc_dcache_find(hdr) == NULL) {
+			avl_add(&arc_dcache_tree, ade);
+			list_insert_head(&arc_dcache_lru, ade);
+			arc_dcache_size += size;
+		} else {
+			admit = B_FALSE;
+		}
+		hdr->b_l1hdr.b_dcached = B_TRUE;
+		mutex_exit(&arc_dcache_lock);
+	}
+	if (hash_lock != NULL)
+		mutex_exit(hash_lock);
+
+	if (!admit)
+		arc_dcache_free(ade);
+	else
+		(void) arc_dcache_trim(limit);
+}
+
+/*
+ * Forget about the hdr's decompressed data, because its b_pabd is going away
+ * or it is losing its identity.  Called with the hash lock held, or on a hdr
+ * nobody else can find.
+ */
+static void
+arc_dcache_remove(arc_buf_hdr_t *hdr)
+{
+	arc_dcache_ent_t *ade;
+	boolean_t last = B_FALSE;
+
+	ASSERT(HDR_HAS_L1HDR(hdr));
+	hdr->b_l1hdr.b_decompress_cnt = 0;
+	if (!hdr->b_l1hdr.b_dcached)
+		return;
+
+	mutex_enter(&arc_dcache_lock);
+	if ((ade = arc_dcache_find(hdr)) != NULL)
+		last = arc_dcache_unlink(ade);
+	mutex_exit(&arc_dcache_lock);
+	if (last)
+		arc_dcache_free(ade);
+}
+
+static void
+arc_dcache_init(void)
+{
+	mutex_init(&arc_dcache_lock, NULL, MUTEX_DEFAULT, NULL);
+	avl_create(&arc_dcache_tree, arc_dcache_compare,
+	    sizeof (arc_dcache_ent_t), offsetof(arc_dcache_ent_t, ade_avl));
+	list_create(&arc_dcache_lru, sizeof (arc_dcache_ent_t),
+	    offsetof(arc_dcache_ent_t, ade_lru));
+	arc_dcache_size = 0;
+}
+
+static void
+arc_dcache_fini(void)
+{
+	(void) arc_dcache_trim(0);
+	ASSERT0(arc_dcache_size);
+	list_destroy(&arc_dcache_lru);
+	avl_destroy(&arc_dcache_tree);
+	mutex_destroy(&arc_dcache_lock);
+}
+
 /*
  * Given a buf that has a data buffer attached to it, this function will
  * efficiently fill the buf with data of the specified compression setting from
@@ -2141,13 +2432,14 @@ arc_buf_fill(arc_buf_t *buf, spa_t *spa, const zbookmark_phys_t *zb,
 
 		/*
 		 * Try copying the data from another buf which already has a
-		 * decompressed version. If that's not possible, it's time to
-		 * bite the bullet and decompress the data from the hdr.
+		 * decompressed version, or from the decompressed block cache.
+		 * If that's not possible, it's time to bite the bullet and
+		 * decompress the data from the hdr.
 		 */
 		if (arc_buf_try_copy_decompressed_data(buf)) {
 			/* Skip byteswapping and checksumming (already done) */
 			return (0);
-		} else {
+		} else if (!arc_dcache_fill(buf)) {
 			error = zio_decompress_data(HDR_GET_COMPRESS(hdr),
 			    hdr->b_l1hdr.b_pabd, buf->b_data,
 			    HDR_GET_PSIZE(hdr), HDR_GET_LSIZE(hdr),
@@ -2169,6 +2461,7 @@ arc_buf_fill(arc_buf_t *buf, spa_t *spa, const zbookmark_phys_t *zb,
 					mutex_exit(hash_lock);
 				return (SET_ERROR(EIO));
 			}
+			arc_dcache_admit(buf, hash_lock);
 		}
 	}
 
@@ -2657,9 +2950,13 @@ arc_space_consume(uint64_t space, arc_space_type_t type)
 		 */
 		ARCSTAT_INCR(arcstat_abd_chunk_waste_size, space);
 		break;
+	case ARC_SPACE_DCACHE:
+		ARCSTAT_INCR(arcstat_dcache_size, space);
+		break;
 	}
 
-	if (type != ARC_SPACE_DATA && type != ARC_SPACE_ABD_CHUNK_WASTE)
+	if (type != ARC_SPACE_DATA && type != ARC_SPACE_ABD_CHUNK_WASTE &&
+	    type != ARC_SPACE_DCACHE)
 		ARCSTAT_INCR(arcstat_meta_used, space);
 
 	aggsum_add(&arc_sums.arcstat_size, space);
@@ -2697,9 +2994,13 @@ arc_space_return(uint64_t space, arc_space_type_t type)
 	case ARC_SPACE_ABD_CHUNK_WASTE:
 		ARCSTAT_INCR(arcstat_abd_chunk_waste_size, -space);
 		break;
+	case ARC_SPACE_DCACHE:
+		ARCSTAT_INCR(arcstat_dcache_size, -space);
+		break;
 	}
 
-	if (type != ARC_SPACE_DATA && type != ARC_SPACE_ABD_CHUNK_WASTE)
+	if (type != ARC_SPACE_DATA && type != ARC_SPACE_ABD_CHUNK_WASTE &&
+	    type != ARC_SPACE_DCACHE)
 		ARCSTAT_INCR(arcstat_meta_used, -space);
 
 	ASSERT(aggsum_compare(&arc_sums.arcstat_size, space) >= 0);
@@ -3239,6 +3540,9 @@ arc_hdr_free_abd(arc_buf_hdr_t *hdr, boolean_t free_rdata)
 	ASSERT(hdr->b_l1hdr.b_pabd != NULL || HDR_HAS_RABD(hdr));
 	IMPLY(free_rdata, HDR_HAS_RABD(hdr));
 
+	if (!free_rdata)
+		arc_dcache_remove(hdr);
+
 	/*
 	 * If the hdr is currently being written to the l2arc then
 	 * we defer freeing the data by adding it to the l2arc_free_on_write
@@ -3327,6 +3631,8 @@ arc_hdr_alloc(uint64_t spa, int32_t psize, int32_t lsize,
 	hdr->b_l1hdr.b_mfu_ghost_hits = 0;
 	hdr->b_l1hdr.b_bufcnt = 0;
 	hdr->b_l1hdr.b_buf = NULL;
+	hdr->b_l1hdr.b_decompress_cnt = 0;
+	hdr->b_l1hdr.b_dcached = B_FALSE;
 
 	ASSERT(zfs_refcount_is_zero(&hdr->b_l1hdr.b_refcnt));
 
@@ -3380,6 +3686,8 @@ arc_hdr_realloc(arc_buf_hdr_t *hdr, kmem_cache_t *old, kmem_cache_t *new)
 		/* Verify previous threads set to NULL before freeing */
 		ASSERT3P(nhdr->b_l1hdr.b_pabd, ==, NULL);
 		ASSERT(!HDR_HAS_RABD(hdr));
+		nhdr->b_l1hdr.b_decompress_cnt = 0;
+		nhdr->b_l1hdr.b_dcached = B_FALSE;
 	} else {
 		ASSERT3P(hdr->b_l1hdr.b_buf, ==, NULL);
 		ASSERT0(hdr->b_l1hdr.b_bufcnt);
@@ -3405,6 +3713,7 @@ arc_hdr_realloc(arc_buf_hdr_t *hdr, kmem_cache_t *old, kmem_cache_t *new)
 		VERIFY(!HDR_L2_WRITING(hdr));
 		VERIFY3P(hdr->b_l1hdr.b_pabd, ==, NULL);
 		ASSERT(!HDR_HAS_RABD(hdr));
+		ASSERT(!hdr->b_l1hdr.b_dcached);
 
 		arc_hdr_clear_flags(nhdr, ARC_FLAG_HAS_L1HDR);
 	}
@@ -3508,6 +3817,9 @@ arc_hdr_realloc_crypt(arc_buf_hdr_t *hdr, boolean_t need_crypt)
 	nhdr->b_l1hdr.b_mfu_ghost_hits = hdr->b_l1hdr.b_mfu_ghost_hits;
 	nhdr->b_l1hdr.b_acb = hdr->b_l1hdr.b_acb;
 	nhdr->b_l1hdr.b_pabd = hdr->b_l1hdr.b_pabd;
+	ASSERT(!hdr->b_l1hdr.b_dcached);
+	nhdr->b_l1hdr.b_decompress_cnt = 0;
+	nhdr->b_l1hdr.b_dcached = B_FALSE;
 
 	/*
 	 * This zfs_refcount_add() exists only to ensure that the individual
@@ -3549,6 +3861,7 @@ arc_hdr_realloc_crypt(arc_buf_hdr_t *hdr, boolean_t need_crypt)
 	hdr->b_l1hdr.b_mru_ghost_hits = 0;
 	hdr->b_l1hdr.b_mfu_hits = 0;
 	hdr->b_l1hdr.b_mfu_ghost_hits = 0;
+	hdr->b_l1hdr.b_decompress_cnt = 0;
 	hdr->b_l1hdr.b_acb = NULL;
 	hdr->b_l1hdr.b_pabd = NULL;
 
@@ -3851,6 +4164,7 @@ arc_hdr_destroy(arc_buf_hdr_t *hdr)
 	if (HDR_HAS_L1HDR(hdr)) {
 		ASSERT(!multilist_link_active(&hdr->b_l1hdr.b_arc_node));
 		ASSERT3P(hdr->b_l1hdr.b_acb, ==, NULL);
+		ASSERT(!hdr->b_l1hdr.b_dcached);
 #ifdef ZFS_DEBUG
 		ASSERT3P(hdr->b_l1hdr.b_freeze_cksum, ==, NULL);
 #endif
@@ -4425,6 +4739,9 @@ arc_evict(void)
 	static uint64_t gsrd, gsrm, gsfd, gsfm;
 	uint64_t ngrd, ngrm, ngfd, ngfm;
 
+	/* The decompressed block cache may be over its share of arc_c. */
+	total_evicted += arc_dcache_trim(arc_dcache_limit());
+
 	/* Get current size of ARC states we can evict from. */
 	mrud = zfs_refcount_count(&arc_mru->arcs_size[ARC_BUFC_DATA]) +
 	    zfs_refcount_count(&arc_anon->arcs_size[ARC_BUFC_DATA]);
@@ -6481,6 +6798,7 @@ arc_release(arc_buf_t *buf, const void *tag)
 		hdr->b_l1hdr.b_mru_ghost_hits = 0;
 		hdr->b_l1hdr.b_mfu_hits = 0;
 		hdr->b_l1hdr.b_mfu_ghost_hits = 0;
+		arc_dcache_remove(hdr);
 		arc_change_state(arc_anon, hdr);
 		hdr->b_l1hdr.b_arc_access = 0;
 
@@ -6604,7 +6922,7 @@ arc_write_ready(zio_t *zio)
 	}
 	HDR_SET_PSIZE(hdr, psize);
 	arc_hdr_set_compress(hdr, compress);
-	hdr->b_complevel = zio->io_prop.zp_complevel;
+	hdr->b_complevel = zio->io_complevel;
 
 	if (zio->io_error != 0 || psize == 0)
 		goto out;
@@ -7216,6 +7534,14 @@ arc_kstat_update(kstat_t *ksp, int rw)
 	    wmsum_value(&arc_sums.arcstat_cached_only_in_progress);
 	as->arcstat_abd_chunk_waste_size.value.ui64 =
 	    wmsum_value(&arc_sums.arcstat_abd_chunk_waste_size);
+	as->arcstat_dcache_hits.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_dcache_hits);
+	as->arcstat_dcache_misses.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_dcache_misses);
+	as->arcstat_dcache_evictions.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_dcache_evictions);
+	as->arcstat_dcache_size.value.ui64 =
+	    wmsum_value(&arc_sums.arcstat_dcache_size);
 
 	return (0);
 }
@@ -7522,6 +7848,10 @@ arc_state_init(void)
 	wmsum_init(&arc_sums.arcstat_raw_size, 0);
 	wmsum_init(&arc_sums.arcstat_cached_only_in_progress, 0);
 	wmsum_init(&arc_sums.arcstat_abd_chunk_waste_size, 0);
+	wmsum_init(&arc_sums.arcstat_dcache_hits, 0);
+	wmsum_init(&arc_sums.arcstat_dcache_misses, 0);
+	wmsum_init(&arc_sums.arcstat_dcache_evictions, 0);
+	wmsum_init(&arc_sums.arcstat_dcache_size, 0);
 
 	arc_anon->arcs_state = ARC_STATE_ANON;
 	arc_mru->arcs_state = ARC_STATE_MRU;
@@ -7680,6 +8010,10 @@ arc_state_fini(void)
 	wmsum_fini(&arc_sums.arcstat_raw_size);
 	wmsum_fini(&arc_sums.arcstat_cached_only_in_progress);
 	wmsum_fini(&arc_sums.arcstat_abd_chunk_waste_size);
+	wmsum_fini(&arc_sums.arcstat_dcache_hits);
+	wmsum_fini(&arc_sums.arcstat_dcache_misses);
+	wmsum_fini(&arc_sums.arcstat_dcache_evictions);
+	wmsum_fini(&arc_sums.arcstat_dcache_size);
 }
 
 uint64_t
@@ -7704,6 +8038,7 @@ arc_init(void)
 	mutex_init(&arc_evict_lock, NULL, MUTEX_DEFAULT, NULL);
 	list_create(&arc_evict_waiters, sizeof (arc_evict_waiter_t),
 	    offsetof(arc_evict_waiter_t, aew_node));
+	arc_dcache_init();
 
 	arc_min_prefetch_ms = 1000;
 	arc_min_prescient_prefetch_ms = 6000;
@@ -7841,6 +8176,7 @@ arc_fini(void)
 
 	/* Use B_TRUE to ensure *all* buffers are evicted */
 	arc_flush(NULL, B_TRUE);
+	arc_dcache_fini();
 
 	if (arc_ksp != NULL) {
 		kstat_delete(arc_ksp);
@@ -8545,7 +8881,7 @@ l2arc_untransform(zio_t *zio, l2arc_read_callback_t *cb)
 		ret = spa_do_crypt_abd(B_FALSE, spa, &cb->l2rcb_zb,
 		    BP_GET_TYPE(bp), BP_GET_DEDUP(bp), BP_SHOULD_BYTESWAP(bp),
 		    salt, iv, mac, HDR_GET_PSIZE(hdr), eabd,
-		    hdr->b_l1hdr.b_pabd, &no_crypt);
+		    hdr->b_l1hdr.b_pabd, &no_crypt, NULL);
 		if (ret != 0) {
 			arc_free_data_abd(hdr, eabd, arc_hdr_size(hdr), hdr);
 			goto error;
@@ -10909,5 +11245,11 @@ ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, eviction_pct, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, evict_batch_limit, UINT, ZMOD_RW,
 	"The number of headers to evict per sublist before moving to the next");
 
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, dcache_percent, UINT, ZMOD_RW,
+	"Percent of ARC size for caching decompressed blocks");
+
+ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, dcache_min_decompress, UINT, ZMOD_RW,
+	"Decompressions of a block before it is cached decompressed");
+
 ZFS_MODULE_PARAM(zfs_arc, zfs_arc_, prune_task_threads, INT, ZMOD_RW,
 	"Number of arc_prune threads");
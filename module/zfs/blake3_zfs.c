@@ -28,6 +28,32 @@
 #include <sys/blake3.h>
 #include <sys/abd.h>
 
+/*
+ * Blocks of at least twice this size are cut into subtrees of this size
+ * (rounded down to a power of 2), which are hashed in parallel on
+ * blake3_parallel_taskq and merged into the same checksum.
+ */
+static uint_t zfs_blake3_parallel_size = 1024 * 1024;
+
+static taskq_t *blake3_parallel_taskq = NULL;
+
+typedef struct blake3_parallel {
+	kmutex_t	bp_lock;
+	kcondvar_t	bp_cv;
+	uint_t		bp_pending;
+	abd_t		*bp_abd;
+	const BLAKE3_CTX *bp_parent;
+} blake3_parallel_t;
+
+typedef struct blake3_subtree {
+	blake3_parallel_t *bs_parallel;
+	uint64_t	bs_off;
+	uint64_t	bs_len;
+	uint8_t		bs_cv_pair[2 * BLAKE3_OUT_LEN];
+	BLAKE3_CTX	bs_ctx;
+	taskq_ent_t	bs_ent;
+} blake3_subtree_t;
+
 static int
 blake3_incremental(void *buf, size_t size, void *arg)
 {
@@ -38,13 +64,115 @@ blake3_incremental(void *buf, size_t size, void *arg)
 	return (0);
 }
 
+static void
+blake3_subtree_hash(blake3_subtree_t *bs)
+{
+	blake3_parallel_t *bp = bs->bs_parallel;
+	uint64_t chunk_counter = bs->bs_off / BLAKE3_CHUNK_LEN;
+
+	Blake3_SubtreeInit(&bs->bs_ctx, bp->bp_parent, chunk_counter);
+	(void) abd_iterate_func(bp->bp_abd, bs->bs_off, bs->bs_len,
+	    blake3_incremental, &bs->bs_ctx);
+	Blake3_SubtreeFinal(&bs->bs_ctx, chunk_counter, bs->bs_cv_pair);
+}
+
+static void
+blake3_subtree_task(void *arg)
+{
+	blake3_subtree_t *bs = arg;
+	blake3_parallel_t *bp = bs->bs_parallel;
+
+	blake3_subtree_hash(bs);
+
+	mutex_enter(&bp->bp_lock);
+	if (--bp->bp_pending == 0)
+		cv_broadcast(&bp->bp_cv);
+	mutex_exit(&bp->bp_lock);
+}
+
 /*
- * Computes a native 256-bit BLAKE3 MAC checksum. Please note that this
- * function requires the presence of a ctx_template that should be allocated
- * using abd_checksum_blake3_tmpl_init.
+ * The size of the subtrees to cut a block of the given size into, or 0 to
+ * hash it on a single thread.
+ */
+static uint64_t
+blake3_parallel_subtree(uint64_t size)
+{
+	uint64_t sub = zfs_blake3_parallel_size;
+
+	if (blake3_parallel_taskq == NULL || sub == 0)
+		return (0);
+
+	sub = MAX(1ULL << (highbit64(sub) - 1), 64 * 1024);
+	return (size >= 2 * sub ? sub : 0);
+}
+
+/*
+ * BLAKE3 is a tree hash, so the subtrees of a large block can be hashed on
+ * several threads at once and merged without changing the result.  The
+ * calling thread hashes the first subtree itself while the others run, and
+ * whatever is left after the last whole subtree once they are merged.
+ */
+static void
+blake3_checksum_parallel(abd_t *abd, uint64_t size, const BLAKE3_CTX *tmpl,
+    uint64_t sub, zio_cksum_t *zcp)
+{
+	blake3_parallel_t bp;
+	blake3_subtree_t *subtrees;
+	BLAKE3_CTX *ctx;
+	uint64_t nsub = size / sub;
+
+	subtrees = kmem_zalloc(nsub * sizeof (blake3_subtree_t), KM_SLEEP);
+	ctx = kmem_alloc(sizeof (*ctx), KM_SLEEP);
+	memcpy(ctx, tmpl, sizeof (*ctx));
+
+	mutex_init(&bp.bp_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&bp.bp_cv, NULL, CV_DEFAULT, NULL);
+	bp.bp_pending = nsub - 1;
+	bp.bp_abd = abd;
+	bp.bp_parent = ctx;
+
+	for (uint64_t i = 0; i < nsub; i++) {
+		blake3_subtree_t *bs = &subtrees[i];
+
+		bs->bs_parallel = &bp;
+		bs->bs_off = i * sub;
+		bs->bs_len = sub;
+		taskq_init_ent(&bs->bs_ent);
+		if (i > 0) {
+			taskq_dispatch_ent(blake3_parallel_taskq,
+			    blake3_subtree_task, bs, 0, &bs->bs_ent);
+		}
+	}
+
+	blake3_subtree_hash(&subtrees[0]);
+
+	mutex_enter(&bp.bp_lock);
+	while (bp.bp_pending != 0)
+		cv_wait(&bp.bp_cv, &bp.bp_lock);
+	mutex_exit(&bp.bp_lock);
+
+	for (uint64_t i = 0; i < nsub; i++)
+		Blake3_SubtreeAdd(ctx, subtrees[i].bs_cv_pair, sub);
+	if (size > nsub * sub) {
+		(void) abd_iterate_func(abd, nsub * sub, size - nsub * sub,
+		    blake3_incremental, ctx);
+	}
+	Blake3_Final(ctx, (uint8_t *)zcp);
+
+	cv_destroy(&bp.bp_cv);
+	mutex_destroy(&bp.bp_lock);
+	memset(ctx, 0, sizeof (*ctx));
+	kmem_free(ctx, sizeof (*ctx));
+	memset(subtrees, 0, nsub * sizeof (blake3_subtree_t));
+	kmem_free(subtrees, nsub * sizeof (blake3_subtree_t));
+}
+
+/*
+ * Computes a native 256-bit BLAKE3 MAC checksum of a block on the calling
+ * thread only.
  */
 void
-abd_checksum_blake3_native(abd_t *abd, uint64_t size, const void *ctx_template,
+abd_checksum_blake3_serial(abd_t *abd, uint64_t size, const void *ctx_template,
     zio_cksum_t *zcp)
 {
 	ASSERT(ctx_template != NULL);
@@ -68,6 +196,25 @@ abd_checksum_blake3_native(abd_t *abd, uint64_t size, const void *ctx_template,
 #endif
 }
 
+/*
+ * Computes a native 256-bit BLAKE3 MAC checksum. Please note that this
+ * function requires the presence of a ctx_template that should be allocated
+ * using abd_checksum_blake3_tmpl_init.
+ */
+void
+abd_checksum_blake3_native(abd_t *abd, uint64_t size, const void *ctx_template,
+    zio_cksum_t *zcp)
+{
+	uint64_t sub = blake3_parallel_subtree(size);
+
+	ASSERT(ctx_template != NULL);
+
+	if (sub != 0)
+		blake3_checksum_parallel(abd, size, ctx_template, sub, zcp);
+	else
+		abd_checksum_blake3_serial(abd, size, ctx_template, zcp);
+}
+
 /*
  * Byteswapped version of abd_checksum_blake3_native. This just invokes
  * the native checksum function and byteswaps the resulting checksum (since
@@ -118,3 +265,22 @@ abd_checksum_blake3_tmpl_free(void *ctx_template)
 	memset(ctx, 0, sizeof (*ctx));
 	kmem_free(ctx, sizeof (*ctx));
 }
+
+void
+abd_checksum_blake3_init(void)
+{
+	blake3_parallel_taskq = taskq_create("z_blake3_par", 100, minclsyspri,
+	    1, INT_MAX, TASKQ_THREADS_CPU_PCT | TASKQ_DYNAMIC);
+}
+
+void
+abd_checksum_blake3_fini(void)
+{
+	if (blake3_parallel_taskq != NULL) {
+		taskq_destroy(blake3_parallel_taskq);
+		blake3_parallel_taskq = NULL;
+	}
+}
+
+ZFS_MODULE_PARAM(zfs, zfs_, blake3_parallel_size, UINT, ZMOD_RW,
+	"Subtree size for parallel BLAKE3 hashing of large blocks");
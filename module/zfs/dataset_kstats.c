@@ -37,6 +37,8 @@ static dataset_kstat_values_t empty_dataset_kstats = {
 	{ "nread",	KSTAT_DATA_UINT64 },
 	{ "nunlinks",	KSTAT_DATA_UINT64 },
 	{ "nunlinked",	KSTAT_DATA_UINT64 },
+	{ "namecache_hits",	KSTAT_DATA_UINT64 },
+	{ "namecache_misses",	KSTAT_DATA_UINT64 },
 	{
 	{ "zil_commit_count",			KSTAT_DATA_UINT64 },
 	{ "zil_commit_writer_count",		KSTAT_DATA_UINT64 },
@@ -80,6 +82,10 @@ dataset_kstats_update(kstat_t *ksp, int rw)
 	    wmsum_value(&dk->dk_sums.dss_nunlinks);
 	dkv->dkv_nunlinked.value.ui64 =
 	    wmsum_value(&dk->dk_sums.dss_nunlinked);
+	dkv->dkv_namecache_hits.value.ui64 =
+	    wmsum_value(&dk->dk_sums.dss_namecache_hits);
+	dkv->dkv_namecache_misses.value.ui64 =
+	    wmsum_value(&dk->dk_sums.dss_namecache_misses);
 
 	zil_kstat_values_update(&dkv->dkv_zil_stats, &dk->dk_zil_sums);
 
@@ -169,6 +175,8 @@ dataset_kstats_create(dataset_kstats_t *dk, objset_t *objset)
 	wmsum_init(&dk->dk_sums.dss_nread, 0);
 	wmsum_init(&dk->dk_sums.dss_nunlinks, 0);
 	wmsum_init(&dk->dk_sums.dss_nunlinked, 0);
+	wmsum_init(&dk->dk_sums.dss_namecache_hits, 0);
+	wmsum_init(&dk->dk_sums.dss_namecache_misses, 0);
 	zil_sums_init(&dk->dk_zil_sums);
 
 	dk->dk_kstats = kstat;
@@ -195,6 +203,8 @@ dataset_kstats_destroy(dataset_kstats_t *dk)
 	wmsum_fini(&dk->dk_sums.dss_nread);
 	wmsum_fini(&dk->dk_sums.dss_nunlinks);
 	wmsum_fini(&dk->dk_sums.dss_nunlinked);
+	wmsum_fini(&dk->dk_sums.dss_namecache_hits);
+	wmsum_fini(&dk->dk_sums.dss_namecache_misses);
 	zil_sums_fini(&dk->dk_zil_sums);
 }
 
@@ -241,3 +251,15 @@ dataset_kstats_update_nunlinked_kstat(dataset_kstats_t *dk, int64_t delta)
 
 	wmsum_add(&dk->dk_sums.dss_nunlinked, delta);
 }
+
+void
+dataset_kstats_update_namecache_kstats(dataset_kstats_t *dk, boolean_t hit)
+{
+	if (dk->dk_kstats == NULL)
+		return;
+
+	if (hit)
+		wmsum_add(&dk->dk_sums.dss_namecache_hits, 1);
+	else
+		wmsum_add(&dk->dk_sums.dss_namecache_misses, 1);
+}
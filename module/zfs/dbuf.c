@@ -4705,6 +4705,19 @@ dbuf_write_ready(zio_t *zio, arc_buf_t *buf, void *vdb)
 				fill = 1;
 			}
 		}
+
+		/*
+		 * Let compression=auto know whether this object's blocks
+		 * have been compressing; see zio_compress_auto().
+		 */
+		if (zio->io_prop.zp_compress == ZIO_COMPRESS_ZSTD &&
+		    zio->io_prop.zp_complevel == ZIO_ZSTD_LEVEL_AUTO &&
+		    !BP_IS_HOLE(bp)) {
+			if (BP_GET_COMPRESS(bp) != ZIO_COMPRESS_OFF)
+				dn->dn_compress_misses = 0;
+			else if (dn->dn_compress_misses < UINT8_MAX)
+				dn->dn_compress_misses++;
+		}
 	} else {
 		blkptr_t *ibp = db->db.db_data;
 		ASSERT3U(db->db.db_size, ==, 1<<dn->dn_phys->dn_indblkshift);
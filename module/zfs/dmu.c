@@ -2139,6 +2139,10 @@ dmu_write_policy(objset_t *os, dnode_t *dn, int level, int wp, zio_prop_t *zp)
 	zp->zp_dedup = dedup;
 	zp->zp_dedup_verify = dedup && dedup_verify;
 	zp->zp_nopwrite = nopwrite;
+	zp->zp_incompressible = (dn != NULL && !ismd &&
+	    compress == ZIO_COMPRESS_ZSTD &&
+	    complevel == ZIO_ZSTD_LEVEL_AUTO &&
+	    dn->dn_compress_misses >= ZIO_COMPRESS_AUTO_MISSES);
 	zp->zp_encrypt = encrypt;
 	zp->zp_byteorder = ZFS_HOST_BYTEORDER;
 	memset(zp->zp_salt, 0, ZIO_DATA_SALT_LEN);
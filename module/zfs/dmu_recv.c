@@ -1402,13 +1402,37 @@ do_corrective_recv(struct receive_writer_arg *rwa, struct drr_write *drrw,
 	}
 
 	if (!rwa->raw && BP_GET_COMPRESS(bp) != ZIO_COMPRESS_OFF) {
+		uint8_t complevel = rwa->os->os_complevel;
+
+		/*
+		 * compression=auto picks the zstd level per block and the bp
+		 * doesn't record it.  Use the level auto always gives blocks
+		 * that must compress the same way every time; a block written
+		 * at another level fails the checksum comparison below.
+		 */
+		if (BP_GET_COMPRESS(bp) == ZIO_COMPRESS_ZSTD &&
+		    complevel == ZIO_ZSTD_LEVEL_AUTO)
+			complevel = ZIO_ZSTD_LEVEL_DEFAULT;
+
 		/* Recompress the data */
 		abd_t *cabd = abd_alloc_linear(BP_GET_PSIZE(bp),
 		    B_FALSE);
 		void *buf = abd_to_buf(cabd);
 		uint64_t csize = zio_compress_data(BP_GET_COMPRESS(bp),
-		    abd, &buf, abd_get_size(abd),
-		    rwa->os->os_complevel);
+		    abd, &buf, abd_get_size(abd), complevel);
+
+		/*
+		 * The data no longer compresses into the block it has to
+		 * replace, so it can't be the same data.
+		 */
+		if (csize > BP_GET_PSIZE(bp)) {
+			abd_free(cabd);
+			rrd->abd = abd;
+			if (zfs_recv_best_effort_corrective != 0)
+				return (0);
+			return (SET_ERROR(ECKSUM));
+		}
+		ASSERT3U(csize, <=, BP_GET_PSIZE(bp));
 		abd_zero_off(cabd, csize, BP_GET_PSIZE(bp) - csize);
 		/* Swap in newly compressed data into the abd */
 		abd_free(abd);
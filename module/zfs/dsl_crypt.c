@@ -2781,14 +2781,15 @@ error:
 /*
  * This function serves as a multiplexer for encryption and decryption of
  * all blocks (except the L2ARC). For encryption, it will populate the IV,
- * salt, MAC, and cabd (the ciphertext). On decryption it will simply use
- * these fields to populate pabd (the plaintext).
+ * salt, MAC, and cabd (the ciphertext), passing the ciphertext to sink on
+ * the way if it can (see zio_do_crypt_data()). On decryption it will simply
+ * use these fields to populate pabd (the plaintext).
  */
 int
 spa_do_crypt_abd(boolean_t encrypt, spa_t *spa, const zbookmark_phys_t *zb,
     dmu_object_type_t ot, boolean_t dedup, boolean_t bswap, uint8_t *salt,
     uint8_t *iv, uint8_t *mac, uint_t datalen, abd_t *pabd, abd_t *cabd,
-    boolean_t *no_crypt)
+    boolean_t *no_crypt, zio_crypt_sink_t *sink)
 {
 	int ret;
 	dsl_crypto_key_t *dck = NULL;
@@ -2837,7 +2838,7 @@ spa_do_crypt_abd(boolean_t encrypt, spa_t *spa, const zbookmark_phys_t *zb,
 
 	/* call lower level function to perform encryption / decryption */
 	ret = zio_do_crypt_data(encrypt, &dck->dck_key, ot, bswap, salt, iv,
-	    mac, datalen, plainbuf, cipherbuf, no_crypt);
+	    mac, datalen, plainbuf, cipherbuf, no_crypt, sink);
 
 	/*
 	 * Handle injected decryption faults. Unfortunately, we cannot inject
@@ -2230,10 +2230,10 @@ dsl_flush_pending_livelist(dsl_dataset_t *ds, dmu_tx_t *tx)
 	}
 
 	/* Insert each entry into the on-disk livelist */
-	bplist_iterate(&dd->dd_pending_allocs,
-	    dsl_deadlist_insert_alloc_cb, &dd->dd_livelist, tx);
-	bplist_iterate(&dd->dd_pending_frees,
-	    dsl_deadlist_insert_free_cb, &dd->dd_livelist, tx);
+	dsl_deadlist_insert_bplist(&dd->dd_livelist,
+	    &dd->dd_pending_allocs, B_FALSE, tx);
+	dsl_deadlist_insert_bplist(&dd->dd_livelist,
+	    &dd->dd_pending_frees, B_TRUE, tx);
 
 	/* Attempt to condense every pair of adjacent entries */
 	try_condense_arg_t arg = {
@@ -2249,8 +2249,8 @@ dsl_dataset_sync_done(dsl_dataset_t *ds, dmu_tx_t *tx)
 {
 	objset_t *os = ds->ds_objset;
 
-	bplist_iterate(&ds->ds_pending_deadlist,
-	    dsl_deadlist_insert_alloc_cb, &ds->ds_deadlist, tx);
+	dsl_deadlist_insert_bplist(&ds->ds_deadlist,
+	    &ds->ds_pending_deadlist, B_FALSE, tx);
 
 	if (dsl_deadlist_is_open(&ds->ds_dir->dd_livelist)) {
 		dsl_flush_pending_livelist(ds, tx);
@@ -4504,9 +4504,27 @@ dsl_dataset_set_compression_check(void *arg, dmu_tx_t *tx)
 	if (!spa_feature_is_enabled(dp->dp_spa, f))
 		return (SET_ERROR(ENOTSUP));
 
+	if (ZIO_COMPRESS_LEVEL(ddsca->ddsca_value) == ZIO_ZSTD_LEVEL_AUTO &&
+	    !spa_feature_is_enabled(dp->dp_spa, SPA_FEATURE_COMPRESS_AUTO))
+		return (SET_ERROR(ENOTSUP));
+
 	return (0);
 }
 
+static void
+dsl_dataset_set_compression_activate(dsl_dataset_t *ds, spa_feature_t f,
+    dmu_tx_t *tx)
+{
+	ASSERT3S(spa_feature_table[f].fi_type, ==, ZFEATURE_TYPE_BOOLEAN);
+
+	if (zfeature_active(f, ds->ds_feature[f]) != B_TRUE) {
+		ds->ds_feature_activation[f] = (void *)B_TRUE;
+		dsl_dataset_activate_feature(ds->ds_object, f,
+		    ds->ds_feature_activation[f], tx);
+		ds->ds_feature[f] = ds->ds_feature_activation[f];
+	}
+}
+
 static void
 dsl_dataset_set_compression_sync(void *arg, dmu_tx_t *tx)
 {
@@ -4517,14 +4535,12 @@ dsl_dataset_set_compression_sync(void *arg, dmu_tx_t *tx)
 	uint64_t compval = ZIO_COMPRESS_ALGO(ddsca->ddsca_value);
 	spa_feature_t f = zio_compress_to_feature(compval);
 	ASSERT3S(f, !=, SPA_FEATURE_NONE);
-	ASSERT3S(spa_feature_table[f].fi_type, ==, ZFEATURE_TYPE_BOOLEAN);
 
 	VERIFY0(dsl_dataset_hold(dp, ddsca->ddsca_name, FTAG, &ds));
-	if (zfeature_active(f, ds->ds_feature[f]) != B_TRUE) {
-		ds->ds_feature_activation[f] = (void *)B_TRUE;
-		dsl_dataset_activate_feature(ds->ds_object, f,
-		    ds->ds_feature_activation[f], tx);
-		ds->ds_feature[f] = ds->ds_feature_activation[f];
+	dsl_dataset_set_compression_activate(ds, f, tx);
+	if (ZIO_COMPRESS_LEVEL(ddsca->ddsca_value) == ZIO_ZSTD_LEVEL_AUTO) {
+		dsl_dataset_set_compression_activate(ds,
+		    SPA_FEATURE_COMPRESS_AUTO, tx);
 	}
 	dsl_dataset_rele(ds, FTAG);
 }
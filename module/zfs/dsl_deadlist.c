@@ -24,11 +24,13 @@
  * Copyright (c) 2014 Spectra Logic Corporation, All rights reserved.
  */
 
+#include <sys/bplist.h>
 #include <sys/dmu.h>
 #include <sys/zap.h>
 #include <sys/zfs_context.h>
 #include <sys/dsl_pool.h>
 #include <sys/dsl_dataset.h>
+#include <cityhash.h>
 
 /*
  * Deadlist concurrency:
@@ -111,6 +113,21 @@ uint64_t zfs_livelist_max_entries = 500000;
  */
 int zfs_livelist_min_percent_shared = 75;
 
+/*
+ * Maximum number of blkptrs buffered and sorted by birth txg before they
+ * are inserted into a deadlist in bulk (see dsl_deadlist_bulk_flush()).
+ * Each buffered blkptr costs 144 bytes.
+ */
+uint_t zfs_deadlist_bulk_max_entries = 16384;
+
+/*
+ * Maximum number of blkptrs of a sublist gathered and sorted at once by
+ * dsl_process_sub_livelist().  Larger sublists are processed in several
+ * passes, each over a hash partition of the blkptrs.  Each gathered blkptr
+ * costs 152 bytes.
+ */
+uint_t zfs_livelist_sort_max_entries = 65536;
+
 static int
 dsl_deadlist_compare(const void *arg1, const void *arg2)
 {
@@ -450,13 +467,41 @@ dle_prefetch_subobj(dsl_deadlist_t *dl, dsl_deadlist_entry_t *dle,
 		bpobj_prefetch_subobj(&dle->dle_bpobj, obj);
 }
 
+/*
+ * Find the entry a blkptr born in the given txg belongs to: the one with the
+ * largest mintxg that is strictly less than the birth txg.
+ */
+static dsl_deadlist_entry_t *
+dsl_deadlist_find_entry(dsl_deadlist_t *dl, const blkptr_t *bp)
+{
+	dsl_deadlist_entry_t dle_tofind;
+	dsl_deadlist_entry_t *dle;
+	avl_index_t where;
+
+	ASSERT(MUTEX_HELD(&dl->dl_lock));
+
+	dle_tofind.dle_mintxg = bp->blk_birth;
+	dle = avl_find(&dl->dl_tree, &dle_tofind, &where);
+	if (dle == NULL)
+		dle = avl_nearest(&dl->dl_tree, where, AVL_BEFORE);
+	else
+		dle = AVL_PREV(&dl->dl_tree, dle);
+
+	if (dle == NULL) {
+		zfs_panic_recover("blkptr at %p has invalid BLK_BIRTH %llu",
+		    bp, (longlong_t)bp->blk_birth);
+		dle = avl_first(&dl->dl_tree);
+	}
+
+	ASSERT3P(dle, !=, NULL);
+	return (dle);
+}
+
 void
 dsl_deadlist_insert(dsl_deadlist_t *dl, const blkptr_t *bp, boolean_t bp_freed,
     dmu_tx_t *tx)
 {
-	dsl_deadlist_entry_t dle_tofind;
 	dsl_deadlist_entry_t *dle;
-	avl_index_t where;
 
 	if (dl->dl_oldfmt) {
 		bpobj_enqueue(&dl->dl_bpobj, bp, bp_freed, tx);
@@ -474,22 +519,195 @@ dsl_deadlist_insert(dsl_deadlist_t *dl, const blkptr_t *bp, boolean_t bp_freed,
 	dl->dl_phys->dl_comp += sign * BP_GET_PSIZE(bp);
 	dl->dl_phys->dl_uncomp += sign * BP_GET_UCSIZE(bp);
 
-	dle_tofind.dle_mintxg = bp->blk_birth;
-	dle = avl_find(&dl->dl_tree, &dle_tofind, &where);
-	if (dle == NULL)
-		dle = avl_nearest(&dl->dl_tree, where, AVL_BEFORE);
-	else
-		dle = AVL_PREV(&dl->dl_tree, dle);
+	dle = dsl_deadlist_find_entry(dl, bp);
+	dle_enqueue(dl, dle, bp, bp_freed, tx);
+	mutex_exit(&dl->dl_lock);
+}
 
-	if (dle == NULL) {
-		zfs_panic_recover("blkptr at %p has invalid BLK_BIRTH %llu",
-		    bp, (longlong_t)bp->blk_birth);
-		dle = avl_first(&dl->dl_tree);
+/*
+ * Bulk insertion.
+ *
+ * Inserting blkptrs one at a time costs an AVL lookup, a trip through
+ * dl_lock and, worst of all, a hop to a different bpobj (and thus a
+ * different dbuf) for nearly every blkptr when they arrive in no particular
+ * birth order, which is the common case when destroying or promoting
+ * snapshots with many siblings.  Instead we buffer the incoming blkptrs,
+ * sort them by birth txg and then walk the deadlist entries in step with
+ * the sorted blkptrs, so that each entry's bpobj is appended to
+ * sequentially and the entry lookup is only done when the birth txg moves
+ * past the current entry.
+ *
+ * The sort is stable with respect to arrival order; livelists depend on
+ * the FREE of a blkptr never preceding its ALLOC within a sublist.
+ */
+typedef struct dsl_deadlist_bulk_key {
+	uint64_t dbk_birth;
+	uint32_t dbk_idx;
+	boolean_t dbk_freed;
+} dsl_deadlist_bulk_key_t;
+
+typedef struct dsl_deadlist_bulk {
+	dsl_deadlist_t *dlb_dl;
+	blkptr_t *dlb_bps;
+	dsl_deadlist_bulk_key_t *dlb_keys;
+	uint32_t dlb_count;
+	uint32_t dlb_size;
+} dsl_deadlist_bulk_t;
+
+static int
+dsl_deadlist_bulk_compare(const void *arg1, const void *arg2)
+{
+	const dsl_deadlist_bulk_key_t *k1 = arg1;
+	const dsl_deadlist_bulk_key_t *k2 = arg2;
+
+	int cmp = TREE_CMP(k1->dbk_birth, k2->dbk_birth);
+	if (likely(cmp))
+		return (cmp);
+	return (TREE_CMP(k1->dbk_idx, k2->dbk_idx));
+}
+
+static void
+dsl_deadlist_bulk_init(dsl_deadlist_bulk_t *dlb, dsl_deadlist_t *dl)
+{
+	memset(dlb, 0, sizeof (*dlb));
+	dlb->dlb_dl = dl;
+}
+
+static void
+dsl_deadlist_bulk_fini(dsl_deadlist_bulk_t *dlb)
+{
+	ASSERT0(dlb->dlb_count);
+	if (dlb->dlb_size != 0) {
+		vmem_free(dlb->dlb_bps, dlb->dlb_size * sizeof (blkptr_t));
+		vmem_free(dlb->dlb_keys,
+		    dlb->dlb_size * sizeof (dsl_deadlist_bulk_key_t));
 	}
+}
 
-	ASSERT3P(dle, !=, NULL);
-	dle_enqueue(dl, dle, bp, bp_freed, tx);
+static void
+dsl_deadlist_bulk_flush(dsl_deadlist_bulk_t *dlb, dmu_tx_t *tx)
+{
+	dsl_deadlist_t *dl = dlb->dlb_dl;
+	spa_t *spa = dmu_objset_spa(dl->dl_os);
+	dsl_deadlist_entry_t *dle = NULL, *dle_next = NULL;
+	int64_t used = 0, comp = 0, uncomp = 0;
+
+	if (dlb->dlb_count == 0)
+		return;
+
+	if (dl->dl_oldfmt) {
+		for (uint32_t i = 0; i < dlb->dlb_count; i++) {
+			bpobj_enqueue(&dl->dl_bpobj, &dlb->dlb_bps[i],
+			    dlb->dlb_keys[i].dbk_freed, tx);
+		}
+		dlb->dlb_count = 0;
+		return;
+	}
+
+	qsort(dlb->dlb_keys, dlb->dlb_count, sizeof (dsl_deadlist_bulk_key_t),
+	    dsl_deadlist_bulk_compare);
+
+	mutex_enter(&dl->dl_lock);
+	dsl_deadlist_load_tree(dl);
+	dmu_buf_will_dirty(dl->dl_dbuf, tx);
+
+	for (uint32_t i = 0; i < dlb->dlb_count; i++) {
+		const dsl_deadlist_bulk_key_t *dbk = &dlb->dlb_keys[i];
+		const blkptr_t *bp = &dlb->dlb_bps[dbk->dbk_idx];
+		int sign = dbk->dbk_freed ? -1 : +1;
+
+		used += sign * bp_get_dsize_sync(spa, bp);
+		comp += sign * BP_GET_PSIZE(bp);
+		uncomp += sign * BP_GET_UCSIZE(bp);
+
+		/*
+		 * Births are non-decreasing, so the current entry remains
+		 * the right one until we pass the next entry's mintxg.
+		 */
+		if (dle == NULL || bp->blk_birth <= dle->dle_mintxg ||
+		    (dle_next != NULL &&
+		    bp->blk_birth > dle_next->dle_mintxg)) {
+			dle = dsl_deadlist_find_entry(dl, bp);
+			dle_next = AVL_NEXT(&dl->dl_tree, dle);
+		}
+		dle_enqueue(dl, dle, bp, dbk->dbk_freed, tx);
+	}
+
+	dl->dl_phys->dl_used += used;
+	dl->dl_phys->dl_comp += comp;
+	dl->dl_phys->dl_uncomp += uncomp;
 	mutex_exit(&dl->dl_lock);
+
+	dlb->dlb_count = 0;
+}
+
+static void
+dsl_deadlist_bulk_add(dsl_deadlist_bulk_t *dlb, const blkptr_t *bp,
+    boolean_t bp_freed, dmu_tx_t *tx)
+{
+	if (dlb->dlb_count == dlb->dlb_size) {
+		if (dlb->dlb_size != 0 &&
+		    dlb->dlb_size >= zfs_deadlist_bulk_max_entries) {
+			dsl_deadlist_bulk_flush(dlb, tx);
+		} else {
+			uint32_t nsize = MIN(MAX(dlb->dlb_size * 2, 64),
+			    MAX(zfs_deadlist_bulk_max_entries, 1));
+			blkptr_t *bps = vmem_alloc(nsize * sizeof (blkptr_t),
+			    KM_SLEEP);
+			dsl_deadlist_bulk_key_t *keys = vmem_alloc(nsize *
+			    sizeof (dsl_deadlist_bulk_key_t), KM_SLEEP);
+			if (dlb->dlb_size != 0) {
+				memcpy(bps, dlb->dlb_bps,
+				    dlb->dlb_count * sizeof (blkptr_t));
+				memcpy(keys, dlb->dlb_keys, dlb->dlb_count *
+				    sizeof (dsl_deadlist_bulk_key_t));
+				vmem_free(dlb->dlb_bps,
+				    dlb->dlb_size * sizeof (blkptr_t));
+				vmem_free(dlb->dlb_keys, dlb->dlb_size *
+				    sizeof (dsl_deadlist_bulk_key_t));
+			}
+			dlb->dlb_bps = bps;
+			dlb->dlb_keys = keys;
+			dlb->dlb_size = nsize;
+		}
+	}
+
+	uint32_t idx = dlb->dlb_count++;
+	dlb->dlb_bps[idx] = *bp;
+	dlb->dlb_keys[idx].dbk_birth = bp->blk_birth;
+	dlb->dlb_keys[idx].dbk_idx = idx;
+	dlb->dlb_keys[idx].dbk_freed = bp_freed;
+}
+
+static int
+dsl_deadlist_bulk_alloc_cb(void *arg, const blkptr_t *bp, dmu_tx_t *tx)
+{
+	dsl_deadlist_bulk_add(arg, bp, B_FALSE, tx);
+	return (0);
+}
+
+static int
+dsl_deadlist_bulk_free_cb(void *arg, const blkptr_t *bp, dmu_tx_t *tx)
+{
+	dsl_deadlist_bulk_add(arg, bp, B_TRUE, tx);
+	return (0);
+}
+
+/*
+ * Insert every blkptr on the bplist into the deadlist, emptying the bplist.
+ * All of them are recorded as ALLOCs, or as FREEs if bp_freed is set.
+ */
+void
+dsl_deadlist_insert_bplist(dsl_deadlist_t *dl, bplist_t *bpl,
+    boolean_t bp_freed, dmu_tx_t *tx)
+{
+	dsl_deadlist_bulk_t dlb;
+
+	dsl_deadlist_bulk_init(&dlb, dl);
+	bplist_iterate(bpl, bp_freed ? dsl_deadlist_bulk_free_cb :
+	    dsl_deadlist_bulk_alloc_cb, &dlb, tx);
+	dsl_deadlist_bulk_flush(&dlb, tx);
+	dsl_deadlist_bulk_fini(&dlb);
 }
 
 int
@@ -847,8 +1065,7 @@ static int
 dsl_deadlist_insert_cb(void *arg, const blkptr_t *bp, boolean_t bp_freed,
     dmu_tx_t *tx)
 {
-	dsl_deadlist_t *dl = arg;
-	dsl_deadlist_insert(dl, bp, bp_freed, tx);
+	dsl_deadlist_bulk_add(arg, bp, bp_freed, tx);
 	return (0);
 }
 
@@ -868,10 +1085,14 @@ dsl_deadlist_merge(dsl_deadlist_t *dl, uint64_t obj, dmu_tx_t *tx)
 
 	VERIFY0(dmu_object_info(dl->dl_os, obj, &doi));
 	if (doi.doi_type == DMU_OT_BPOBJ) {
+		dsl_deadlist_bulk_t dlb;
 		bpobj_t bpo;
+		dsl_deadlist_bulk_init(&dlb, dl);
 		VERIFY0(bpobj_open(&bpo, dl->dl_os, obj));
-		VERIFY0(bpobj_iterate(&bpo, dsl_deadlist_insert_cb, dl, tx));
+		VERIFY0(bpobj_iterate(&bpo, dsl_deadlist_insert_cb, &dlb, tx));
 		bpobj_close(&bpo);
+		dsl_deadlist_bulk_flush(&dlb, tx);
+		dsl_deadlist_bulk_fini(&dlb);
 		return;
 	}
 
@@ -978,105 +1199,156 @@ dsl_deadlist_move_bpobj(dsl_deadlist_t *dl, bpobj_t *bpo, uint64_t mintxg,
 	mutex_exit(&dl->dl_lock);
 }
 
-typedef struct livelist_entry {
-	blkptr_t le_bp;
-	uint32_t le_refcnt;
-	avl_node_t le_node;
-} livelist_entry_t;
+/*
+ * Sub-livelist processing.
+ *
+ * Rather than matching FREE/ALLOC pairs through an AVL tree as we go, we
+ * stream the sublist into flat arrays, sort the (compact) keys by dva[0]
+ * and then by iteration order, and match each run of equal keys in a single
+ * sequential pass.  To bound memory, a sublist larger than
+ * zfs_livelist_sort_max_entries is processed in several passes, each one
+ * gathering only the blkptrs whose dva[0] hashes to that pass.  All entries
+ * of one blkptr hash alike, so each run is still seen whole.
+ */
+typedef struct livelist_key {
+	uint64_t lk_vdev;
+	uint64_t lk_offset;
+	uint32_t lk_idx;
+	boolean_t lk_freed;
+} livelist_key_t;
 
 static int
 livelist_compare(const void *larg, const void *rarg)
 {
-	const blkptr_t *l = &((livelist_entry_t *)larg)->le_bp;
-	const blkptr_t *r = &((livelist_entry_t *)rarg)->le_bp;
+	const livelist_key_t *l = larg;
+	const livelist_key_t *r = rarg;
 
 	/* Sort them according to dva[0] */
-	uint64_t l_dva0_vdev = DVA_GET_VDEV(&l->blk_dva[0]);
-	uint64_t r_dva0_vdev = DVA_GET_VDEV(&r->blk_dva[0]);
-
-	if (l_dva0_vdev != r_dva0_vdev)
-		return (TREE_CMP(l_dva0_vdev, r_dva0_vdev));
+	if (l->lk_vdev != r->lk_vdev)
+		return (TREE_CMP(l->lk_vdev, r->lk_vdev));
 
 	/* if vdevs are equal, sort by offsets. */
-	uint64_t l_dva0_offset = DVA_GET_OFFSET(&l->blk_dva[0]);
-	uint64_t r_dva0_offset = DVA_GET_OFFSET(&r->blk_dva[0]);
-	if (l_dva0_offset == r_dva0_offset)
-		ASSERT3U(l->blk_birth, ==, r->blk_birth);
-	return (TREE_CMP(l_dva0_offset, r_dva0_offset));
+	if (l->lk_offset != r->lk_offset)
+		return (TREE_CMP(l->lk_offset, r->lk_offset));
+
+	/* and keep entries for the same blkptr in iteration order */
+	return (TREE_CMP(l->lk_idx, r->lk_idx));
 }
 
 struct livelist_iter_arg {
-	avl_tree_t *avl;
-	bplist_t *to_free;
+	blkptr_t *bps;
+	livelist_key_t *keys;
+	uint32_t count;
+	uint32_t size;
+	uint64_t pass;
+	uint64_t npasses;
+	uint64_t seen;
+	uint64_t cur_size;
+	uint64_t first_size;
 	zthr_t *t;
 };
 
 /*
- * Expects an AVL tree which is incrementally filled will FREE blkptrs
- * and used to match up ALLOC/FREE pairs. ALLOC'd blkptrs without a
- * corresponding FREE are stored in the supplied bplist.
- *
- * Note that multiple FREE and ALLOC entries for the same blkptr may
- * be encountered when dedup is involved. For this reason we keep a
- * refcount for all the FREE entries of each blkptr and ensure that
- * each of those FREE entries has a corresponding ALLOC preceding it.
+ * Gather the blkptrs of a sublist, in iteration order, for
+ * dsl_process_sub_livelist().
  */
 static int
 dsl_livelist_iterate(void *arg, const blkptr_t *bp, boolean_t bp_freed,
     dmu_tx_t *tx)
 {
 	struct livelist_iter_arg *lia = arg;
-	avl_tree_t *avl = lia->avl;
-	bplist_t *to_free = lia->to_free;
 	zthr_t *t = lia->t;
 	ASSERT(tx == NULL);
 
 	if ((t != NULL) && (zthr_has_waiters(t) || zthr_iscancelled(t)))
 		return (SET_ERROR(EINTR));
 
-	livelist_entry_t node;
-	node.le_bp = *bp;
-	livelist_entry_t *found = avl_find(avl, &node, NULL);
-	if (bp_freed) {
-		if (found == NULL) {
-			/* first free entry for this blkptr */
-			livelist_entry_t *e =
-			    kmem_alloc(sizeof (livelist_entry_t), KM_SLEEP);
-			e->le_bp = *bp;
-			e->le_refcnt = 1;
-			avl_add(avl, e);
-		} else {
-			/* dedup block free */
-			ASSERT(BP_GET_DEDUP(bp));
-			ASSERT3U(BP_GET_CHECKSUM(bp), ==,
-			    BP_GET_CHECKSUM(&found->le_bp));
-			ASSERT3U(found->le_refcnt + 1, >, found->le_refcnt);
-			found->le_refcnt++;
+	/*
+	 * Blkptrs appended to the sublist after the first pass started are
+	 * iterated first; skip them so that every pass sees the same entries.
+	 */
+	if (lia->pass > 0 && lia->seen++ < lia->cur_size - lia->first_size)
+		return (0);
+
+	if (lia->npasses > 1 && cityhash4(DVA_GET_VDEV(&bp->blk_dva[0]),
+	    DVA_GET_OFFSET(&bp->blk_dva[0]), 0, 0) % lia->npasses != lia->pass)
+		return (0);
+
+	if (lia->count == lia->size) {
+		uint32_t nsize = MAX(lia->size * 2, 1024);
+		blkptr_t *bps = vmem_alloc(nsize * sizeof (blkptr_t), KM_SLEEP);
+		livelist_key_t *keys =
+		    vmem_alloc(nsize * sizeof (livelist_key_t), KM_SLEEP);
+		if (lia->size != 0) {
+			memcpy(bps, lia->bps, lia->count * sizeof (blkptr_t));
+			memcpy(keys, lia->keys,
+			    lia->count * sizeof (livelist_key_t));
+			vmem_free(lia->bps, lia->size * sizeof (blkptr_t));
+			vmem_free(lia->keys,
+			    lia->size * sizeof (livelist_key_t));
 		}
-	} else {
-		if (found == NULL) {
+		lia->bps = bps;
+		lia->keys = keys;
+		lia->size = nsize;
+	}
+
+	uint32_t idx = lia->count++;
+	lia->bps[idx] = *bp;
+	lia->keys[idx].lk_vdev = DVA_GET_VDEV(&bp->blk_dva[0]);
+	lia->keys[idx].lk_offset = DVA_GET_OFFSET(&bp->blk_dva[0]);
+	lia->keys[idx].lk_idx = idx;
+	lia->keys[idx].lk_freed = bp_freed;
+	return (0);
+}
+
+/*
+ * Match up the FREE and ALLOC entries of one blkptr (a run of equal keys,
+ * in iteration order). ALLOC'd blkptrs without a corresponding FREE are
+ * stored in the supplied bplist.
+ *
+ * Note that multiple FREE and ALLOC entries for the same blkptr may
+ * be encountered when dedup is involved. For this reason we keep a
+ * refcount for all the FREE entries of each blkptr and ensure that
+ * each of those FREE entries has a corresponding ALLOC preceding it.
+ */
+static void
+dsl_livelist_match_run(const blkptr_t *bps, const livelist_key_t *keys,
+    uint32_t start, uint32_t end, bplist_t *to_free)
+{
+	const blkptr_t *first = &bps[keys[start].lk_idx];
+	uint64_t refcnt = 0;
+
+	for (uint32_t i = start; i < end; i++) {
+		const blkptr_t *bp = &bps[keys[i].lk_idx];
+
+		ASSERT3U(bp->blk_birth, ==, first->blk_birth);
+		if (keys[i].lk_freed) {
+			if (refcnt != 0) {
+				/* dedup block free */
+				ASSERT(BP_GET_DEDUP(bp));
+				ASSERT3U(BP_GET_CHECKSUM(bp), ==,
+				    BP_GET_CHECKSUM(first));
+			}
+			refcnt++;
+		} else if (refcnt == 0) {
 			/* block is currently marked as allocated */
 			bplist_append(to_free, bp);
 		} else {
 			/* alloc matches a free entry */
-			ASSERT3U(found->le_refcnt, !=, 0);
-			found->le_refcnt--;
-			if (found->le_refcnt == 0) {
-				/* all tracked free pairs have been matched */
-				avl_remove(avl, found);
-				kmem_free(found, sizeof (livelist_entry_t));
-			} else {
+			refcnt--;
+			if (refcnt != 0) {
 				/*
 				 * This is definitely a deduped blkptr so
 				 * let's validate it.
 				 */
 				ASSERT(BP_GET_DEDUP(bp));
 				ASSERT3U(BP_GET_CHECKSUM(bp), ==,
-				    BP_GET_CHECKSUM(&found->le_bp));
+				    BP_GET_CHECKSUM(first));
 			}
 		}
 	}
-	return (0);
+	/* all tracked free pairs must have been matched */
+	VERIFY0(refcnt);
 }
 
 /*
@@ -1087,25 +1359,58 @@ int
 dsl_process_sub_livelist(bpobj_t *bpobj, bplist_t *to_free, zthr_t *t,
     uint64_t *size)
 {
-	avl_tree_t avl;
-	avl_create(&avl, livelist_compare, sizeof (livelist_entry_t),
-	    offsetof(livelist_entry_t, le_node));
-
-	/* process the sublist */
 	struct livelist_iter_arg arg = {
-	    .avl = &avl,
-	    .to_free = to_free,
+	    .bps = NULL,
+	    .keys = NULL,
+	    .count = 0,
+	    .size = 0,
+	    .pass = 0,
+	    .npasses = 1,
+	    .seen = 0,
+	    .cur_size = 0,
+	    .first_size = 0,
 	    .t = t
 	};
-	int err = bpobj_iterate_nofree(bpobj, dsl_livelist_iterate, &arg, size);
-	VERIFY(err != 0 || avl_numnodes(&avl) == 0);
+	uint64_t max = MAX(zfs_livelist_sort_max_entries, 1);
+	int err = 0;
 
-	void *cookie = NULL;
-	livelist_entry_t *le = NULL;
-	while ((le = avl_destroy_nodes(&avl, &cookie)) != NULL) {
-		kmem_free(le, sizeof (livelist_entry_t));
+	if (bpobj->bpo_phys->bpo_num_blkptrs > max) {
+		arg.npasses = (bpobj->bpo_phys->bpo_num_blkptrs + max - 1) /
+		    max;
+	}
+
+	for (arg.pass = 0; err == 0 && arg.pass < arg.npasses; arg.pass++) {
+		/* gather this pass's share of the sublist */
+		arg.count = 0;
+		arg.seen = 0;
+		err = bpobj_iterate_nofree(bpobj, dsl_livelist_iterate, &arg,
+		    &arg.cur_size);
+		if (arg.pass == 0)
+			arg.first_size = arg.cur_size;
+		if (err != 0 || arg.count == 0)
+			continue;
+
+		/* and process it in sorted runs */
+		qsort(arg.keys, arg.count, sizeof (livelist_key_t),
+		    livelist_compare);
+		uint32_t start = 0;
+		for (uint32_t i = 1; i <= arg.count; i++) {
+			if (i < arg.count &&
+			    arg.keys[i].lk_vdev == arg.keys[start].lk_vdev &&
+			    arg.keys[i].lk_offset == arg.keys[start].lk_offset)
+				continue;
+			dsl_livelist_match_run(arg.bps, arg.keys, start, i,
+			    to_free);
+			start = i;
+		}
+	}
+
+	if (arg.size != 0) {
+		vmem_free(arg.bps, arg.size * sizeof (blkptr_t));
+		vmem_free(arg.keys, arg.size * sizeof (livelist_key_t));
 	}
-	avl_destroy(&avl);
+	if (size != NULL)
+		*size = arg.first_size;
 	return (err);
 }
 
@@ -1114,3 +1419,9 @@ ZFS_MODULE_PARAM(zfs_livelist, zfs_livelist_, max_entries, U64, ZMOD_RW,
 
 ZFS_MODULE_PARAM(zfs_livelist, zfs_livelist_, min_percent_shared, INT, ZMOD_RW,
 	"Threshold at which livelist is disabled");
+
+ZFS_MODULE_PARAM(zfs, zfs_, deadlist_bulk_max_entries, UINT, ZMOD_RW,
+	"Max blkptrs sorted per bulk deadlist insertion");
+
+ZFS_MODULE_PARAM(zfs_livelist, zfs_livelist_, sort_max_entries, UINT, ZMOD_RW,
+	"Max blkptrs of a sub-livelist sorted per pass");
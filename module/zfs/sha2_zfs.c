@@ -30,6 +30,7 @@
 #include <sys/sha2.h>
 #include <sys/abd.h>
 #include <sys/qat.h>
+#include <sys/zfs_chksum.h>
 
 static int
 sha_incremental(void *buf, size_t size, void *arg)
@@ -100,3 +101,69 @@ abd_checksum_sha512_byteswap(abd_t *abd, uint64_t size,
 	zcp->zc_word[2] = BSWAP_64(tmp.zc_word[2]);
 	zcp->zc_word[3] = BSWAP_64(tmp.zc_word[3]);
 }
+
+/*
+ * The number of blocks abd_checksum_sha2_multi() hashes side by side with
+ * the selected multi-buffer implementation.
+ */
+int
+abd_checksum_sha2_lanes(enum zio_checksum checksum)
+{
+	ASSERT(checksum == ZIO_CHECKSUM_SHA256 ||
+	    checksum == ZIO_CHECKSUM_SHA512);
+
+	return (SHA2MultiBufferLanes(checksum == ZIO_CHECKSUM_SHA256 ?
+	    SHA256 : SHA512_256));
+}
+
+/*
+ * Native SHA256 or SHA512 checksums of n linear abds, at most
+ * ZIO_CHECKSUM_MULTI_MAX, zcp[i] being what
+ * abd_checksum_sha256() or abd_checksum_sha512_native() return for abd[i].
+ * If there are enough blocks to make it pay off, they are hashed side by
+ * side by SHA2MultiBuffer(), else one by one.
+ */
+void
+abd_checksum_sha2_multi(enum zio_checksum checksum, int n,
+    abd_t *const abd[], const uint64_t size[], zio_cksum_t zcp[])
+{
+	int algotype = (checksum == ZIO_CHECKSUM_SHA256) ? SHA256 : SHA512_256;
+	const void *data[ZIO_CHECKSUM_MULTI_MAX];
+	size_t len[ZIO_CHECKSUM_MULTI_MAX];
+	void *digest[ZIO_CHECKSUM_MULTI_MAX];
+
+	ASSERT(checksum == ZIO_CHECKSUM_SHA256 ||
+	    checksum == ZIO_CHECKSUM_SHA512);
+	ASSERT3S(n, <=, ZIO_CHECKSUM_MULTI_MAX);
+
+	if (n < chksum_sha2_mb_min(algotype)) {
+		for (int i = 0; i < n; i++) {
+			if (checksum == ZIO_CHECKSUM_SHA256) {
+				abd_checksum_sha256(abd[i], size[i], NULL,
+				    &zcp[i]);
+			} else {
+				abd_checksum_sha512_native(abd[i], size[i],
+				    NULL, &zcp[i]);
+			}
+		}
+		return;
+	}
+
+	for (int i = 0; i < n; i++) {
+		data[i] = abd_to_buf(abd[i]);
+		len[i] = size[i];
+		digest[i] = &zcp[i];
+	}
+
+	SHA2MultiBuffer(algotype, n, data, len, digest);
+
+	/* see abd_checksum_sha256() */
+	if (checksum == ZIO_CHECKSUM_SHA256) {
+		for (int i = 0; i < n; i++) {
+			zcp[i].zc_word[0] = BE_64(zcp[i].zc_word[0]);
+			zcp[i].zc_word[1] = BE_64(zcp[i].zc_word[1]);
+			zcp[i].zc_word[2] = BE_64(zcp[i].zc_word[2]);
+			zcp[i].zc_word[3] = BE_64(zcp[i].zc_word[3]);
+		}
+	}
+}
@@ -88,6 +88,7 @@
 #include <sys/zfeature.h>
 #include <sys/dsl_destroy.h>
 #include <sys/zvol.h>
+#include <sys/wmsum.h>
 
 #ifdef	_KERNEL
 #include <sys/fm/protocol.h>
@@ -150,6 +151,11 @@ static const char *const zio_taskq_types[ZIO_TASKQ_TYPES] = {
  * The different taskq priorities are to handle the different contexts (issue
  * and interrupt) and then to reserve threads for ZIO_PRIORITY_NOW I/Os that
  * need to be handled with minimum delay.
+ *
+ * On NUMA systems the ZTI_BATCH and ZTI_SCALE taskqs can be split into one
+ * group per node with CPUs (see zio_taskq_numa), each group's threads running
+ * on that node's CPUs. A dispatch then picks a taskq from the group of the
+ * node nearest the zio's data, or failing that the dispatching CPU's node.
  */
 static const zio_taskq_info_t zio_taskqs[ZIO_TYPES][ZIO_TASKQ_TYPES] = {
 	/* ISSUE	ISSUE_HIGH	INTR		INTR_HIGH */
@@ -171,6 +177,7 @@ static void spa_vdev_resilver_done(spa_t *spa);
 
 static uint_t	zio_taskq_batch_pct = 80;	  /* 1 thread per cpu in pset */
 static uint_t	zio_taskq_batch_tpq;		  /* threads per taskq */
+static int	zio_taskq_numa = 0;		  /* per-node taskq groups */
 static const boolean_t	zio_taskq_sysdc = B_TRUE; /* use SDC scheduling class */
 static const uint_t	zio_taskq_basedc = 80;	  /* base duty cycle */
 
@@ -1015,6 +1022,88 @@ spa_get_errlists(spa_t *spa, avl_tree_t *last, avl_tree_t *scrub)
 	    offsetof(spa_error_entry_t, se_avl));
 }
 
+/*
+ * Per-node counts of zio taskq dispatches, and of those sent to a node other
+ * than the dispatching CPU's, exported as kstat.zfs.misc.zio_taskq_nodes.
+ */
+typedef struct spa_taskq_node_sums {
+	wmsum_t	stns_dispatched;
+	wmsum_t	stns_remote;
+} spa_taskq_node_sums_t;
+
+static uint_t spa_taskq_nnodes;
+static spa_taskq_node_sums_t *spa_taskq_node_sums;
+static kstat_named_t *spa_taskq_node_stats;
+static kstat_t *spa_taskq_node_ksp;
+
+static int
+spa_taskq_node_kstat_update(kstat_t *ksp, int rw)
+{
+	kstat_named_t *ks = ksp->ks_data;
+
+	if (rw == KSTAT_WRITE)
+		return (SET_ERROR(EACCES));
+
+	for (uint_t n = 0; n < spa_taskq_nnodes; n++) {
+		ks[2 * n].value.ui64 =
+		    wmsum_value(&spa_taskq_node_sums[n].stns_dispatched);
+		ks[2 * n + 1].value.ui64 =
+		    wmsum_value(&spa_taskq_node_sums[n].stns_remote);
+	}
+
+	return (0);
+}
+
+void
+spa_taskq_stat_init(void)
+{
+	spa_taskq_nnodes = MAX(max_nnodes, 1);
+	spa_taskq_node_sums = kmem_zalloc(spa_taskq_nnodes *
+	    sizeof (spa_taskq_node_sums_t), KM_SLEEP);
+	spa_taskq_node_stats = kmem_zalloc(2 * spa_taskq_nnodes *
+	    sizeof (kstat_named_t), KM_SLEEP);
+
+	for (uint_t n = 0; n < spa_taskq_nnodes; n++) {
+		kstat_named_t *ks = &spa_taskq_node_stats[2 * n];
+
+		wmsum_init(&spa_taskq_node_sums[n].stns_dispatched, 0);
+		wmsum_init(&spa_taskq_node_sums[n].stns_remote, 0);
+		(void) snprintf(ks[0].name, KSTAT_STRLEN,
+		    "node%u_dispatched", n);
+		ks[0].data_type = KSTAT_DATA_UINT64;
+		(void) snprintf(ks[1].name, KSTAT_STRLEN, "node%u_remote", n);
+		ks[1].data_type = KSTAT_DATA_UINT64;
+	}
+
+	spa_taskq_node_ksp = kstat_create("zfs", 0, "zio_taskq_nodes", "misc",
+	    KSTAT_TYPE_NAMED, 2 * spa_taskq_nnodes, KSTAT_FLAG_VIRTUAL);
+	if (spa_taskq_node_ksp != NULL) {
+		spa_taskq_node_ksp->ks_data = spa_taskq_node_stats;
+		spa_taskq_node_ksp->ks_update = spa_taskq_node_kstat_update;
+		kstat_install(spa_taskq_node_ksp);
+	}
+}
+
+void
+spa_taskq_stat_fini(void)
+{
+	if (spa_taskq_node_ksp != NULL) {
+		kstat_delete(spa_taskq_node_ksp);
+		spa_taskq_node_ksp = NULL;
+	}
+
+	for (uint_t n = 0; n < spa_taskq_nnodes; n++) {
+		wmsum_fini(&spa_taskq_node_sums[n].stns_dispatched);
+		wmsum_fini(&spa_taskq_node_sums[n].stns_remote);
+	}
+	kmem_free(spa_taskq_node_stats, 2 * spa_taskq_nnodes *
+	    sizeof (kstat_named_t));
+	kmem_free(spa_taskq_node_sums, spa_taskq_nnodes *
+	    sizeof (spa_taskq_node_sums_t));
+	spa_taskq_node_stats = NULL;
+	spa_taskq_node_sums = NULL;
+}
+
 static void
 spa_taskqs_init(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 {
@@ -1023,7 +1112,7 @@ spa_taskqs_init(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 	uint_t value = ztip->zti_value;
 	uint_t count = ztip->zti_count;
 	spa_taskqs_t *tqs = &spa->spa_zio_taskq[t][q];
-	uint_t cpus, flags = TASKQ_DYNAMIC;
+	uint_t cpus, nodes = 1, flags = TASKQ_DYNAMIC;
 	boolean_t batch = B_FALSE;
 
 	switch (mode) {
@@ -1086,8 +1175,20 @@ spa_taskqs_init(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 		break;
 	}
 
+	/*
+	 * Round the taskq count up to a multiple of the node count so that
+	 * every node gets an equal share of the threads.
+	 */
+	if (zio_taskq_numa && spa_taskq_nnodes > 1 &&
+	    (mode == ZTI_MODE_BATCH || mode == ZTI_MODE_SCALE)) {
+		nodes = spa_taskq_nnodes;
+		count = roundup(count, nodes);
+		value = MAX(1, (zio_taskq_batch_pct + count / 2) / count);
+	}
+
 	ASSERT3U(count, >, 0);
 	tqs->stqs_count = count;
+	tqs->stqs_nodes = nodes;
 	tqs->stqs_taskq = kmem_alloc(count * sizeof (taskq_t *), KM_SLEEP);
 
 	for (uint_t i = 0; i < count; i++) {
@@ -1132,8 +1233,13 @@ spa_taskqs_init(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 #error "unknown OS"
 #endif
 			}
-			tq = taskq_create_proc(name, value, pri, 50,
-			    INT_MAX, spa->spa_proc, flags);
+			if (nodes > 1) {
+				tq = taskq_create_node(name, value, pri, 50,
+				    INT_MAX, i / (count / nodes), flags);
+			} else {
+				tq = taskq_create_proc(name, value, pri, 50,
+				    INT_MAX, spa->spa_proc, flags);
+			}
 		}
 
 		tqs->stqs_taskq[i] = tq;
@@ -1160,27 +1266,50 @@ spa_taskqs_fini(spa_t *spa, zio_type_t t, zio_taskq_type_t q)
 }
 
 /*
- * Dispatch a task to the appropriate taskq for the ZFS I/O type and priority.
- * Note that a type may have multiple discrete taskqs to avoid lock contention
- * on the taskq itself. In that case we choose which taskq at random by using
- * the low bits of gethrtime().
+ * Choose one of the taskqs of a type. A type may have multiple discrete
+ * taskqs to avoid lock contention on the taskq itself; in that case we
+ * choose at random by using the low bits of gethrtime(). When the taskqs
+ * are grouped per NUMA node the choice is limited to the group of the
+ * given node, or of the current CPU's node if none is given (node < 0).
  */
-void
-spa_taskq_dispatch_ent(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
-    task_func_t *func, void *arg, uint_t flags, taskq_ent_t *ent)
+static taskq_t *
+spa_taskq_select(spa_taskqs_t *tqs, int node)
 {
-	spa_taskqs_t *tqs = &spa->spa_zio_taskq[t][q];
-	taskq_t *tq;
+	uint_t count = tqs->stqs_count;
+	uint_t nodes = tqs->stqs_nodes;
+	uint_t base = 0;
 
 	ASSERT3P(tqs->stqs_taskq, !=, NULL);
-	ASSERT3U(tqs->stqs_count, !=, 0);
+	ASSERT3U(count, !=, 0);
 
-	if (tqs->stqs_count == 1) {
-		tq = tqs->stqs_taskq[0];
-	} else {
-		tq = tqs->stqs_taskq[((uint64_t)gethrtime()) % tqs->stqs_count];
+	if (nodes > 1) {
+		uint_t local = CPU_NODEID_UNSTABLE % nodes;
+		uint_t n = (node >= 0 && (uint_t)node < nodes) ? node : local;
+
+		wmsum_add(&spa_taskq_node_sums[n].stns_dispatched, 1);
+		if (n != local)
+			wmsum_add(&spa_taskq_node_sums[n].stns_remote, 1);
+
+		count /= nodes;
+		base = n * count;
 	}
 
+	if (count == 1)
+		return (tqs->stqs_taskq[base]);
+
+	return (tqs->stqs_taskq[base + ((uint64_t)gethrtime()) % count]);
+}
+
+/*
+ * Dispatch a task to the appropriate taskq for the ZFS I/O type and priority,
+ * preferring the taskqs of the given NUMA node if there are per-node ones.
+ */
+void
+spa_taskq_dispatch_ent(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
+    task_func_t *func, void *arg, uint_t flags, taskq_ent_t *ent, int node)
+{
+	taskq_t *tq = spa_taskq_select(&spa->spa_zio_taskq[t][q], node);
+
 	taskq_dispatch_ent(tq, func, arg, flags, ent);
 }
 
@@ -1191,19 +1320,9 @@ void
 spa_taskq_dispatch_sync(spa_t *spa, zio_type_t t, zio_taskq_type_t q,
     task_func_t *func, void *arg, uint_t flags)
 {
-	spa_taskqs_t *tqs = &spa->spa_zio_taskq[t][q];
-	taskq_t *tq;
+	taskq_t *tq = spa_taskq_select(&spa->spa_zio_taskq[t][q], -1);
 	taskqid_t id;
 
-	ASSERT3P(tqs->stqs_taskq, !=, NULL);
-	ASSERT3U(tqs->stqs_count, !=, 0);
-
-	if (tqs->stqs_count == 1) {
-		tq = tqs->stqs_taskq[0];
-	} else {
-		tq = tqs->stqs_taskq[((uint64_t)gethrtime()) % tqs->stqs_count];
-	}
-
 	id = taskq_dispatch(tq, func, arg, flags);
 	if (id)
 		taskq_wait_id(tq, id);
@@ -2804,8 +2923,8 @@ spa_livelist_condense_sync(void *arg, dmu_tx_t *tx)
 	ASSERT(bpobj_is_empty(&first->dle_bpobj));
 	dsl_deadlist_remove_entry(ll, next->dle_mintxg, tx);
 
-	bplist_iterate(&lca->to_keep, dsl_deadlist_insert_alloc_cb, ll, tx);
-	bplist_iterate(&new_frees, dsl_deadlist_insert_free_cb, ll, tx);
+	dsl_deadlist_insert_bplist(ll, &lca->to_keep, B_FALSE, tx);
+	dsl_deadlist_insert_bplist(ll, &new_frees, B_TRUE, tx);
 	bplist_destroy(&new_frees);
 
 	char dsname[ZFS_MAX_DATASET_NAME_LEN];
@@ -10155,6 +10274,9 @@ ZFS_MODULE_PARAM(zfs_zio, zio_, taskq_batch_pct, UINT, ZMOD_RD,
 ZFS_MODULE_PARAM(zfs_zio, zio_, taskq_batch_tpq, UINT, ZMOD_RD,
 	"Number of threads per IO worker taskqueue");
 
+ZFS_MODULE_PARAM(zfs_zio, zio_, taskq_numa, INT, ZMOD_RW,
+	"Split IO worker taskqueues per NUMA node");
+
 /* BEGIN CSTYLED */
 ZFS_MODULE_PARAM(zfs, zfs_, max_missing_tvds, U64, ZMOD_RW,
 	"Allow importing pool with up to this number of missing top-level "
@@ -2440,6 +2440,7 @@ spa_init(spa_mode_t mode)
 	unique_init();
 	zfs_btree_init();
 	metaslab_stat_init();
+	spa_taskq_stat_init();
 	brt_init();
 	ddt_init();
 	zio_init();
@@ -2476,6 +2477,7 @@ spa_fini(void)
 	zio_fini();
 	ddt_fini();
 	brt_fini();
+	spa_taskq_stat_fini();
 	metaslab_stat_fini();
 	zfs_btree_fini();
 	unique_fini();
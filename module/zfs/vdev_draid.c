@@ -1435,6 +1435,43 @@ vdev_draid_group_degraded(vdev_t *vd, uint64_t offset)
 	return (B_FALSE);
 }
 
+/*
+ * Fill in the ids of the children making up the redundancy group at the
+ * given offset, and return their number.  cids must have room for
+ * VDEV_DRAID_MAX_CHILDREN entries.
+ *
+ * The offset must start a row of the group, which always holds for the
+ * rebuild I/Os this is used for.  Every dRAID allocation is a whole number
+ * of rows (vdev_draid_asize()) and metaslabs start on a row boundary
+ * (vdev_draid_metaslab_init()), so the allocated ranges a rebuild walks
+ * begin and end on row boundaries.  vdev_draid_rebuild_asize() then cuts
+ * them into chunks which are whole rows and never cross into the next
+ * group, so each rebuild I/O starts on a row and touches only the children
+ * returned here.
+ */
+int
+vdev_draid_group_children(vdev_t *vd, uint64_t offset, uint8_t *cids)
+{
+	vdev_draid_config_t *vdc = vd->vdev_tsd;
+
+	ASSERT3P(vd->vdev_ops, ==, &vdev_draid_ops);
+	ASSERT3U(vdev_draid_get_astart(vd, offset), ==, offset);
+
+	uint64_t groupstart, perm;
+	(void) vdev_draid_logical_to_physical(vd, offset, &perm, &groupstart);
+
+	uint8_t *base;
+	uint64_t iter;
+	vdev_draid_get_perm(vdc, perm, &base, &iter);
+
+	for (uint64_t i = 0; i < vdc->vdc_groupwidth; i++) {
+		uint64_t c = (groupstart + i) % vdc->vdc_ndisks;
+		cids[i] = vdev_draid_permute_id(vdc, base, iter, c);
+	}
+
+	return (vdc->vdc_groupwidth);
+}
+
 /*
  * Determine if the txg is missing.  Used by healing resilver.
  */
@@ -48,6 +48,11 @@ vdev_indirect_mapping_verify(vdev_indirect_mapping_t *vim)
 
 		ASSERT3U(vim->vim_phys->vimp_max_offset, >=, offset + size);
 	}
+	if (vim->vim_index != NULL) {
+		ASSERT3U(vim->vim_index_count, ==,
+		    DIV_ROUND_UP(vim->vim_phys->vimp_num_entries,
+		    VIM_INDEX_STRIDE));
+	}
 	if (vim->vim_havecounts) {
 		ASSERT(vim->vim_phys->vimp_counts_object != 0);
 	}
@@ -184,12 +189,36 @@ vdev_indirect_mapping_entry_for_offset_impl(vdev_indirect_mapping_t *vim,
 	uint64_t last = vim->vim_phys->vimp_num_entries - 1;
 	uint64_t base = 0;
 
+	/*
+	 * Use the sparse index to find the one stride of entries that
+	 * can contain the offset: the last one starting at or before it
+	 * (or the first one, if the offset is before all entries).  If
+	 * the offset isn't mapped, the next entry is either in this
+	 * stride or is the first entry of the next one, which is what
+	 * the search below falls through to in that case.
+	 */
+	if (vim->vim_index != NULL) {
+		uint64_t lo = 0;
+		uint64_t hi = vim->vim_index_count;
+
+		while (hi - lo > 1) {
+			uint64_t i = lo + ((hi - lo) >> 1);
+			if (vim->vim_index[i] <= offset)
+				lo = i;
+			else
+				hi = i;
+		}
+		base = lo << VIM_INDEX_SHIFT;
+		last = MIN(base + VIM_INDEX_STRIDE,
+		    vim->vim_phys->vimp_num_entries) - 1;
+	}
+
 	/*
 	 * We don't define these inside of the while loop because we use
 	 * their value in the case that offset isn't in the mapping.
 	 */
-	uint64_t mid;
-	int result;
+	uint64_t mid = base;
+	int result = 0;
 
 	while (last >= base) {
 		mid = base + ((last - base) >> 1);
@@ -285,11 +314,45 @@ vdev_indirect_mapping_entry_for_offset_or_next(vdev_indirect_mapping_t *vim,
 	    B_TRUE));
 }
 
+/*
+ * (Re)build the sparse index over vim_entries after it has been loaded or
+ * extended.
+ */
+static void
+vdev_indirect_mapping_build_index(vdev_indirect_mapping_t *vim)
+{
+	uint64_t num_entries = vim->vim_phys->vimp_num_entries;
+
+	if (vim->vim_index != NULL) {
+		vmem_free(vim->vim_index,
+		    vim->vim_index_count * sizeof (*vim->vim_index));
+		vim->vim_index = NULL;
+		vim->vim_index_count = 0;
+	}
+
+	if (num_entries <= VIM_INDEX_STRIDE)
+		return;
+
+	vim->vim_index_count = DIV_ROUND_UP(num_entries, VIM_INDEX_STRIDE);
+	vim->vim_index = vmem_alloc(vim->vim_index_count *
+	    sizeof (*vim->vim_index), KM_SLEEP);
+	for (uint64_t i = 0; i < vim->vim_index_count; i++) {
+		vim->vim_index[i] = DVA_MAPPING_GET_SRC_OFFSET(
+		    &vim->vim_entries[i << VIM_INDEX_SHIFT]);
+	}
+}
+
 void
 vdev_indirect_mapping_close(vdev_indirect_mapping_t *vim)
 {
 	ASSERT(vdev_indirect_mapping_verify(vim));
 
+	if (vim->vim_index != NULL) {
+		vmem_free(vim->vim_index,
+		    vim->vim_index_count * sizeof (*vim->vim_index));
+		vim->vim_index = NULL;
+	}
+
 	if (vim->vim_phys->vimp_num_entries > 0) {
 		uint64_t map_size = vdev_indirect_mapping_size(vim);
 		vmem_free(vim->vim_entries, map_size);
@@ -362,6 +425,7 @@ vdev_indirect_mapping_open(objset_t *os, uint64_t mapping_object)
 		vim->vim_entries = vmem_alloc(map_size, KM_SLEEP);
 		VERIFY0(dmu_read(os, vim->vim_object, 0, map_size,
 		    vim->vim_entries, DMU_READ_PREFETCH));
+		vdev_indirect_mapping_build_index(vim);
 	}
 
 	ASSERT(vdev_indirect_mapping_verify(vim));
@@ -488,6 +552,7 @@ vdev_indirect_mapping_add_entries(vdev_indirect_mapping_t *vim,
 	VERIFY0(dmu_read(vim->vim_objset, vim->vim_object, old_size,
 	    new_size - old_size, &vim->vim_entries[old_count],
 	    DMU_READ_PREFETCH));
+	vdev_indirect_mapping_build_index(vim);
 
 	zfs_dbgmsg("txg %llu: wrote %llu entries to "
 	    "indirect mapping obj %llu; max offset=0x%llx",
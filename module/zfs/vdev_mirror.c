@@ -53,6 +53,9 @@ typedef struct mirror_stats {
 
 	kstat_named_t vdev_mirror_stat_preferred_found;
 	kstat_named_t vdev_mirror_stat_preferred_not_found;
+
+	kstat_named_t vdev_mirror_stat_split_reads;
+	kstat_named_t vdev_mirror_stat_split_retries;
 } mirror_stats_t;
 
 static mirror_stats_t mirror_stats = {
@@ -70,7 +73,10 @@ static mirror_stats_t mirror_stats = {
 	{ "preferred_found",			KSTAT_DATA_UINT64 },
 	/* Preferred child vdev not found or equal load  */
 	{ "preferred_not_found",		KSTAT_DATA_UINT64 },
-
+	/* Read split across several children */
+	{ "split_reads",			KSTAT_DATA_UINT64 },
+	/* Split read which had to be retried from a single child */
+	{ "split_retries",			KSTAT_DATA_UINT64 },
 };
 
 #define	MIRROR_STAT(stat)		(mirror_stats.stat.value.ui64)
@@ -107,6 +113,7 @@ typedef struct mirror_child {
 	uint64_t	mc_offset;
 	int		mc_error;
 	int		mc_load;
+	hrtime_t	mc_latency;
 	uint8_t		mc_tried;
 	uint8_t		mc_skipped;
 	uint8_t		mc_speculative;
@@ -120,6 +127,7 @@ typedef struct mirror_map {
 	boolean_t	mm_resilvering;
 	boolean_t	mm_rebuilding;
 	boolean_t	mm_root;
+	boolean_t	mm_split;
 	mirror_child_t	mm_child[];
 } mirror_map_t;
 
@@ -144,6 +152,21 @@ static int zfs_vdev_mirror_rotating_seek_offset = 1 * 1024 * 1024;
 static int zfs_vdev_mirror_non_rotating_inc = 0;
 static int zfs_vdev_mirror_non_rotating_seek_inc = 1;
 
+/*
+ * Scale the load of each child by its recent read latency relative to the
+ * fastest child, so that reads go to the child expected to complete them
+ * first.  This keeps most reads off the slow side of a mixed HDD/SSD mirror,
+ * or off a disk that is failing slowly.
+ */
+static int zfs_vdev_mirror_latency_aware = 1;
+
+/*
+ * Reads of at least this many bytes from a mirror of non-rotating children
+ * are split across all lightly loaded children and read in parallel.  Zero
+ * disables splitting.
+ */
+uint_t zfs_vdev_mirror_split_size = 1024 * 1024;
+
 static inline size_t
 vdev_mirror_map_size(int children)
 {
@@ -242,6 +265,28 @@ vdev_mirror_load(mirror_map_t *mm, vdev_t *vd, uint64_t zio_offset)
 	return (load + zfs_vdev_mirror_rotating_seek_inc);
 }
 
+/*
+ * Turn a child's load into an estimate of how long a new read would take to
+ * complete on it: the load, plus one for the new read, times the child's
+ * recent read latency.  The latency is expressed in quarters of that of the
+ * fastest child, which keeps loads comparable to the unscaled ones, and lets
+ * children of about the same speed still compare equal and share the reads.
+ * The scale is capped at 16 times that of the fastest child, so that a few
+ * slow reads don't take a child out of use entirely.  Children which haven't
+ * been read from recently are taken to be as fast as the fastest child, so
+ * they get some reads to measure them by, see vdev_queue_read_latency().
+ */
+static int
+vdev_mirror_latency_load(int load, hrtime_t latency, hrtime_t min_latency)
+{
+	uint64_t scale = 4;
+
+	if (latency > min_latency)
+		scale = MIN(latency * 4 / min_latency, 16 * 4);
+
+	return (MIN((load + 1) * scale, INT_MAX - 1));
+}
+
 static boolean_t
 vdev_mirror_rebuilding(vdev_t *vd)
 {
@@ -529,11 +574,11 @@ vdev_mirror_child_select(zio_t *zio)
 {
 	mirror_map_t *mm = zio->io_vsd;
 	uint64_t txg = zio->io_txg;
+	hrtime_t min_latency = 0;
 	int c, lowest_load;
 
 	ASSERT(zio->io_bp == NULL || BP_PHYSICAL_BIRTH(zio->io_bp) == txg);
 
-	lowest_load = INT_MAX;
 	mm->mm_preferred_cnt = 0;
 	for (c = 0; c < mm->mm_children; c++) {
 		mirror_child_t *mc;
@@ -560,10 +605,29 @@ vdev_mirror_child_select(zio_t *zio)
 		if (mc->mc_vd->vdev_ops == &vdev_draid_spare_ops) {
 			mm->mm_preferred[0] = c;
 			mm->mm_preferred_cnt = 1;
-			break;
+			MIRROR_BUMP(vdev_mirror_stat_preferred_found);
+			return (c);
 		}
 
 		mc->mc_load = vdev_mirror_load(mm, mc->mc_vd, mc->mc_offset);
+		mc->mc_latency = mm->mm_root ? 0 :
+		    vdev_queue_read_latency(mc->mc_vd);
+		if (mc->mc_latency != 0 &&
+		    (min_latency == 0 || mc->mc_latency < min_latency))
+			min_latency = mc->mc_latency;
+	}
+
+	lowest_load = INT_MAX;
+	for (c = 0; c < mm->mm_children; c++) {
+		mirror_child_t *mc = &mm->mm_child[c];
+
+		if (mc->mc_tried || mc->mc_skipped)
+			continue;
+
+		if (zfs_vdev_mirror_latency_aware && min_latency != 0) {
+			mc->mc_load = vdev_mirror_latency_load(mc->mc_load,
+			    mc->mc_latency, min_latency);
+		}
 		if (mc->mc_load > lowest_load)
 			continue;
 
@@ -600,6 +664,118 @@ vdev_mirror_child_select(zio_t *zio)
 	return (-1);
 }
 
+/*
+ * Split a large read into one chunk per child whose load is at most about
+ * twice that of child c, the one vdev_mirror_child_select() picked, and read
+ * the chunks in parallel.  This is only done for ordinary reads from mirrors
+ * of non-rotating leaves.  The chunks can't be checked on their own, so
+ * vdev_mirror_io_done() verifies the checksum of the whole block in place of
+ * the zio's own checksum stage, and if it or any of the chunks fails, retries
+ * the read from one child at a time to find a good copy and repair the others.
+ */
+static boolean_t
+vdev_mirror_split_read(zio_t *zio, int c)
+{
+	mirror_map_t *mm = zio->io_vsd;
+	vdev_t *vd = zio->io_vd;
+	int limit = MAX(2 * mm->mm_child[c].mc_load,
+	    mm->mm_child[c].mc_load + 1);
+	uint64_t align, chunk, offset;
+	int n = 0;
+
+	if (zfs_vdev_mirror_split_size == 0 ||
+	    zio->io_size < zfs_vdev_mirror_split_size ||
+	    vd == NULL || vd->vdev_ops != &vdev_mirror_ops ||
+	    mm->mm_rebuilding ||
+	    (zio->io_flags & (ZIO_FLAG_SCRUB | ZIO_FLAG_RESILVER |
+	    ZIO_FLAG_IO_REPAIR | ZIO_FLAG_IO_RETRY)) ||
+	    mm->mm_child[c].mc_vd->vdev_ops == &vdev_draid_spare_ops)
+		return (B_FALSE);
+
+	align = 1ULL << vd->vdev_top->vdev_ashift;
+	if (P2PHASE(zio->io_size, align) != 0)
+		return (B_FALSE);
+
+	for (int i = 0; i < mm->mm_children; i++) {
+		mirror_child_t *mc = &mm->mm_child[i];
+
+		if (mc->mc_tried || mc->mc_skipped ||
+		    !mc->mc_vd->vdev_ops->vdev_op_leaf ||
+		    !mc->mc_vd->vdev_nonrot || mc->mc_load > limit)
+			continue;
+		mm->mm_preferred[n++] = i;
+	}
+
+	chunk = P2ROUNDUP(zio->io_size / MAX(n, 1), align);
+	n = MIN(n, howmany(zio->io_size, chunk));
+	if (n < 2)
+		return (B_FALSE);
+
+	mm->mm_split = B_TRUE;
+	offset = 0;
+	for (int i = 0; i < n; i++) {
+		mirror_child_t *mc = &mm->mm_child[mm->mm_preferred[i]];
+		uint64_t size = MIN(chunk, zio->io_size - offset);
+
+		mc->mc_abd = abd_get_offset_size(zio->io_abd, offset, size);
+		zio_nowait(zio_vdev_child_io(zio, NULL, mc->mc_vd,
+		    mc->mc_offset + offset, mc->mc_abd, size, ZIO_TYPE_READ,
+		    zio->io_priority, 0, vdev_mirror_child_done, mc));
+		offset += size;
+	}
+	ASSERT3U(offset, ==, zio->io_size);
+
+	MIRROR_BUMP(vdev_mirror_stat_split_reads);
+	return (B_TRUE);
+}
+
+/*
+ * Check the result of a split read.  Returns B_FALSE if it has to be retried,
+ * after resetting the children for that.
+ */
+static boolean_t
+vdev_mirror_split_done(zio_t *zio)
+{
+	mirror_map_t *mm = zio->io_vsd;
+	zio_bad_cksum_t info;
+	int error = 0;
+
+	for (int c = 0; c < mm->mm_children; c++) {
+		mirror_child_t *mc = &mm->mm_child[c];
+
+		if (mc->mc_abd == NULL)
+			continue;
+		error = zio_worst_error(error, mc->mc_error);
+		abd_free(mc->mc_abd);
+		mc->mc_abd = NULL;
+	}
+	mm->mm_split = B_FALSE;
+
+	/*
+	 * Verify the block here only if this zio was going to.  Otherwise a
+	 * parent that does verify it retries the read if it is bad, and the
+	 * retry isn't split.
+	 */
+	if (error == 0 && (zio->io_bp == NULL || !zio_checksum_pending(zio)))
+		return (B_TRUE);
+
+	if (error == 0 && zio_checksum_error(zio, &info) == 0) {
+		zio_checksum_verified(zio);
+		return (B_TRUE);
+	}
+
+	MIRROR_BUMP(vdev_mirror_stat_split_retries);
+	for (int c = 0; c < mm->mm_children; c++) {
+		mirror_child_t *mc = &mm->mm_child[c];
+
+		mc->mc_error = 0;
+		mc->mc_tried = 0;
+		mc->mc_skipped = 0;
+		mc->mc_speculative = 0;
+	}
+	return (B_FALSE);
+}
+
 static void
 vdev_mirror_io_start(zio_t *zio)
 {
@@ -653,9 +829,14 @@ vdev_mirror_io_start(zio_t *zio)
 			return;
 		}
 		/*
-		 * For normal reads just pick one child.
+		 * For normal reads just pick one child, unless the read is
+		 * large enough to split across several.
 		 */
 		c = vdev_mirror_child_select(zio);
+		if (c >= 0 && vdev_mirror_split_read(zio, c)) {
+			zio_execute(zio);
+			return;
+		}
 		children = (c >= 0);
 	} else {
 		ASSERT(zio->io_type == ZIO_TYPE_WRITE);
@@ -720,6 +901,9 @@ vdev_mirror_io_done(zio_t *zio)
 	if (mm == NULL)
 		return;
 
+	if (mm->mm_split && vdev_mirror_split_done(zio))
+		return;
+
 	for (c = 0; c < mm->mm_children; c++) {
 		mc = &mm->mm_child[c];
 
@@ -1038,3 +1222,9 @@ ZFS_MODULE_PARAM(zfs_vdev_mirror, zfs_vdev_mirror_, non_rotating_inc, INT,
 
 ZFS_MODULE_PARAM(zfs_vdev_mirror, zfs_vdev_mirror_, non_rotating_seek_inc, INT,
 	ZMOD_RW, "Non-rotating media load increment for seeking I/Os");
+
+ZFS_MODULE_PARAM(zfs_vdev_mirror, zfs_vdev_mirror_, latency_aware, INT,
+	ZMOD_RW, "Scale load by read latency when selecting a child");
+
+ZFS_MODULE_PARAM(zfs_vdev_mirror, zfs_vdev_mirror_, split_size, UINT,
+	ZMOD_RW, "Minimum size of reads split across non-rotating children");
@@ -203,6 +203,14 @@ static uint_t zfs_vdev_aggregation_limit_non_rotating = SPA_OLD_MAXBLOCKSIZE;
 static uint_t zfs_vdev_read_gap_limit = 32 << 10;
 static uint_t zfs_vdev_write_gap_limit = 4 << 10;
 
+/*
+ * A device's average read latency is forgotten once it hasn't been updated
+ * for this long.  The mirror code steers reads away from children which
+ * were slow, and so would never measure them again; this way a child which
+ * had a few slow reads is tried again after a while.
+ */
+static uint_t zfs_vdev_read_latency_max_age_ms = 1000;
+
 /*
  * Define the queue depth percentage for each top-level. This percentage is
  * used in conjunction with zfs_vdev_async_max_active to determine how many
@@ -978,6 +986,21 @@ vdev_queue_io_done(zio_t *zio)
 	mutex_enter(&vq->vq_lock);
 	vdev_queue_pending_remove(vq, zio);
 
+	/*
+	 * Keep an exponentially weighted moving average of the time the
+	 * device takes to service reads, with a weight of 1/8 for each new
+	 * one, for the mirror code to compare its children by.
+	 */
+	if (zio->io_type == ZIO_TYPE_READ && zio->io_delay != 0) {
+		if (vq->vq_read_latency == 0 || now - vq->vq_read_latency_ts >
+		    MSEC2NSEC(zfs_vdev_read_latency_max_age_ms))
+			vq->vq_read_latency = zio->io_delay;
+		else
+			vq->vq_read_latency +=
+			    (zio->io_delay - vq->vq_read_latency) / 8;
+		vq->vq_read_latency_ts = now;
+	}
+
 	while ((nio = vdev_queue_io_to_issue(vq)) != NULL) {
 		mutex_exit(&vq->vq_lock);
 		if (nio->io_done == vdev_queue_agg_io_done) {
@@ -1047,7 +1070,7 @@ vdev_queue_change_io_priority(zio_t *zio, zio_priority_t priority)
 }
 
 /*
- * As these two methods are only used for load calculations we're not
+ * As these methods are only used for load calculations we're not
  * concerned if we get an incorrect value on 32bit platforms due to lack of
  * vq_lock mutex use here, instead we prefer to keep it lock free for
  * performance.
@@ -1064,6 +1087,23 @@ vdev_queue_last_offset(vdev_t *vd)
 	return (vd->vdev_queue.vq_last_offset);
 }
 
+/*
+ * Return the device's average read latency, or 0 if it hasn't been read from
+ * recently enough to know.
+ */
+hrtime_t
+vdev_queue_read_latency(vdev_t *vd)
+{
+	vdev_queue_t *vq = &vd->vdev_queue;
+	hrtime_t latency = vq->vq_read_latency;
+
+	if (gethrtime() - vq->vq_read_latency_ts >
+	    MSEC2NSEC(zfs_vdev_read_latency_max_age_ms))
+		return (0);
+
+	return (latency);
+}
+
 uint64_t
 vdev_queue_class_length(vdev_t *vd, zio_priority_t p)
 {
@@ -1086,6 +1126,9 @@ ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, read_gap_limit, UINT, ZMOD_RW,
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, write_gap_limit, UINT, ZMOD_RW,
 	"Aggregate write I/O over gap");
 
+ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, read_latency_max_age_ms, UINT, ZMOD_RW,
+	"Age in ms after which a vdev's average read latency is forgotten");
+
 ZFS_MODULE_PARAM(zfs_vdev, zfs_vdev_, max_active, UINT, ZMOD_RW,
 	"Maximum number of active I/Os per vdev");
 
@@ -1957,28 +1957,101 @@ raidz_restore_orig_data(raidz_map_t *rm)
 }
 
 /*
- * returns EINVAL if reconstruction of the block will not be possible
- * returns ECKSUM if this specific reconstruction failed
- * returns 0 on successful reconstruction
+ * Check whether a combination of targeted children is worth reconstructing.
+ * Returns EINVAL if reconstruction will not be possible because some row
+ * would have more bad columns than parity, and EALREADY if one of the targets
+ * makes no difference to any row: it's already known to be bad, it holds no
+ * data in the rows it appears in, or it's a parity column which wouldn't have
+ * been used for the reconstruction anyway.  Such a combination rebuilds the
+ * same data as the combination without that target.
  */
 static int
-raidz_reconstruct(zio_t *zio, int *ltgts, int ntgts, int nparity)
+raidz_reconstruct_check(raidz_map_t *rm, const int *tgts, int ntgts,
+    int nparity)
 {
-	raidz_map_t *rm = zio->io_vsd;
+	uint_t needed = 0;
+
+	for (int r = 0; r < rm->rm_nrows; r++) {
+		raidz_row_t *rr = rm->rm_row[r];
+		int ptgts[VDEV_RAIDZ_MAXPARITY]; /* value is column */
+		int pt_lt[VDEV_RAIDZ_MAXPARITY]; /* value is index in tgts */
+		int npt = 0;
+		int dead = 0;
+		int dead_data = 0;
+
+		for (int c = 0; c < rr->rr_cols; c++) {
+			raidz_col_t *rc = &rr->rr_col[c];
+			if (rc->rc_error != 0) {
+				dead++;
+				if (c >= nparity)
+					dead_data++;
+				continue;
+			}
+			if (rc->rc_size == 0)
+				continue;
+			for (int lt = 0; lt < ntgts; lt++) {
+				if (rc->rc_devidx != tgts[lt])
+					continue;
+
+				dead++;
+				if (c >= nparity) {
+					dead_data++;
+					needed |= 1U << lt;
+				} else {
+					ptgts[npt] = c;
+					pt_lt[npt++] = lt;
+				}
+				break;
+			}
+		}
+		if (dead > nparity)
+			return (EINVAL);
+
+		/*
+		 * The missing data is rebuilt from the first dead_data parity
+		 * columns which are neither bad nor targeted, so a targeted
+		 * parity column only matters if it would otherwise have been
+		 * one of those.
+		 */
+		for (int i = 0; i < npt; i++) {
+			int valid = 0;
+
+			for (int c = 0, j = 0; c < ptgts[i]; c++) {
+				if (j < npt && c == ptgts[j])
+					j++;
+				else if (rr->rr_col[c].rc_error == 0)
+					valid++;
+			}
+			if (valid < dead_data)
+				needed |= 1U << pt_lt[i];
+		}
+	}
 
+	return (needed == (1U << ntgts) - 1 ? 0 : EALREADY);
+}
+
+/*
+ * Reconstruct the columns of each row on the targeted children, as well as
+ * those already known to be bad, and check the result.
+ * returns ECKSUM if this specific reconstruction failed
+ * returns 0 on successful reconstruction, in which case the original contents
+ * of the targeted columns are left in rc_orig_data for the caller to report
+ */
+static int
+raidz_reconstruct(raidz_map_t *rm, const int *tgts, int ntgts, int nparity,
+    vdev_raidz_verify_f *verify_cb, void *arg)
+{
 	/* Reconstruct each row */
 	for (int r = 0; r < rm->rm_nrows; r++) {
 		raidz_row_t *rr = rm->rm_row[r];
 		int my_tgts[VDEV_RAIDZ_MAXPARITY]; /* value is child id */
 		int t = 0;
-		int dead = 0;
 		int dead_data = 0;
 
 		for (int c = 0; c < rr->rr_cols; c++) {
 			raidz_col_t *rc = &rr->rr_col[c];
 			ASSERT0(rc->rc_need_orig_restore);
 			if (rc->rc_error != 0) {
-				dead++;
 				if (c >= nparity)
 					dead_data++;
 				continue;
@@ -1986,7 +2059,7 @@ raidz_reconstruct(zio_t *zio, int *ltgts, int ntgts, int nparity)
 			if (rc->rc_size == 0)
 				continue;
 			for (int lt = 0; lt < ntgts; lt++) {
-				if (rc->rc_devidx == ltgts[lt]) {
+				if (rc->rc_devidx == tgts[lt]) {
 					if (rc->rc_orig_data == NULL) {
 						rc->rc_orig_data =
 						    abd_alloc_linear(
@@ -1996,7 +2069,6 @@ raidz_reconstruct(zio_t *zio, int *ltgts, int ntgts, int nparity)
 					}
 					rc->rc_need_orig_restore = B_TRUE;
 
-					dead++;
 					if (c >= nparity)
 						dead_data++;
 					my_tgts[t++] = c;
@@ -2004,53 +2076,14 @@ raidz_reconstruct(zio_t *zio, int *ltgts, int ntgts, int nparity)
 				}
 			}
 		}
-		if (dead > nparity) {
-			/* reconstruction not possible */
-			raidz_restore_orig_data(rm);
-			return (EINVAL);
-		}
+		ASSERT3S(t, <=, nparity);
 		if (dead_data > 0)
 			vdev_raidz_reconstruct_row(rm, rr, my_tgts, t);
 	}
 
 	/* Check for success */
-	if (raidz_checksum_verify(zio) == 0) {
-
-		/* Reconstruction succeeded - report errors */
-		for (int i = 0; i < rm->rm_nrows; i++) {
-			raidz_row_t *rr = rm->rm_row[i];
-
-			for (int c = 0; c < rr->rr_cols; c++) {
-				raidz_col_t *rc = &rr->rr_col[c];
-				if (rc->rc_need_orig_restore) {
-					/*
-					 * Note: if this is a parity column,
-					 * we don't really know if it's wrong.
-					 * We need to let
-					 * vdev_raidz_io_done_verified() check
-					 * it, and if we set rc_error, it will
-					 * think that it is a "known" error
-					 * that doesn't need to be checked
-					 * or corrected.
-					 */
-					if (rc->rc_error == 0 &&
-					    c >= rr->rr_firstdatacol) {
-						vdev_raidz_checksum_error(zio,
-						    rc, rc->rc_orig_data);
-						rc->rc_error =
-						    SET_ERROR(ECKSUM);
-					}
-					rc->rc_need_orig_restore = B_FALSE;
-				}
-			}
-
-			vdev_raidz_io_done_verified(zio, rr);
-		}
-
-		zio_checksum_verified(zio);
-
+	if (verify_cb(rm, arg))
 		return (0);
-	}
 
 	/* Reconstruction failed - restore original data */
 	raidz_restore_orig_data(rm);
@@ -2058,12 +2091,21 @@ raidz_reconstruct(zio_t *zio, int *ltgts, int ntgts, int nparity)
 }
 
 /*
- * Iterate over all combinations of N bad vdevs and attempt a reconstruction.
- * Note that the algorithm below is non-optimal because it doesn't take into
- * account how reconstruction is actually performed. For example, with
- * triple-parity RAID-Z the reconstruction procedure is the same if column 4
- * is targeted as invalid as if columns 1 and 4 are targeted since in both
- * cases we'd only use parity information in column 0.
+ * Iterate over all combinations of N bad children and attempt a
+ * reconstruction, until one of them passes verify_cb().  Children are targeted
+ * in the order given, so the most likely culprits should come first; a NULL
+ * order targets them by child ID.  On success, the targeted columns are
+ * flagged with rc_need_orig_restore and their original contents left in
+ * rc_orig_data.
+ *
+ * The reconstruction procedure for a row only depends on which data columns
+ * are missing and which parity columns are used to rebuild them, which are
+ * always the first valid ones.  For example, with triple-parity RAID-Z the
+ * reconstruction is the same if column 4 is targeted as invalid as if columns
+ * 1 and 4 are targeted since in both cases we'd only use parity information
+ * in column 0.  As long as every combination of fewer children has already
+ * been tried, such combinations are skipped without reconstructing or
+ * verifying anything.
  *
  * The order that we find the various possible combinations of failed
  * disks is dictated by these rules:
@@ -2104,32 +2146,21 @@ raidz_reconstruct(zio_t *zio, int *ltgts, int ntgts, int nparity)
  * These additional permutations are not currently checked but could be as
  * a future improvement.
  */
-static int
-vdev_raidz_combrec(zio_t *zio)
+int
+vdev_raidz_combrec_map(raidz_map_t *rm, int nparity, int n, const int *order,
+    vdev_raidz_verify_f *verify_cb, void *arg)
 {
-	int nparity = vdev_get_nparity(zio->io_vd);
-	raidz_map_t *rm = zio->io_vsd;
-
-	/* Check if there's enough data to attempt reconstrution. */
-	for (int i = 0; i < rm->rm_nrows; i++) {
-		raidz_row_t *rr = rm->rm_row[i];
-		int total_errors = 0;
-
-		for (int c = 0; c < rr->rr_cols; c++) {
-			if (rr->rr_col[c].rc_error)
-				total_errors++;
-		}
-
-		if (total_errors > nparity)
-			return (vdev_raidz_worst_error(rr));
-	}
+	/*
+	 * The block has already failed to verify with only the known bad
+	 * columns reconstructed.
+	 */
+	boolean_t tried_fewer = B_TRUE;
 
 	for (int num_failures = 1; num_failures <= nparity; num_failures++) {
 		int tstore[VDEV_RAIDZ_MAXPARITY + 2];
-		int *ltgts = &tstore[1]; /* value is logical child ID */
-
-		/* Determine number of logical children, n */
-		int n = zio->io_vd->vdev_children;
+		int *ltgts = &tstore[1]; /* value is index in order */
+		int tgts[VDEV_RAIDZ_MAXPARITY]; /* value is child id */
+		boolean_t tried_all = B_TRUE;
 
 		ASSERT3U(num_failures, <=, nparity);
 		ASSERT3U(num_failures, <=, VDEV_RAIDZ_MAXPARITY);
@@ -2142,16 +2173,24 @@ vdev_raidz_combrec(zio_t *zio)
 		ltgts[num_failures] = n;
 
 		for (;;) {
-			int err = raidz_reconstruct(zio, ltgts, num_failures,
-			    nparity);
+			for (int i = 0; i < num_failures; i++)
+				tgts[i] = order ? order[ltgts[i]] : ltgts[i];
+
+			int err = raidz_reconstruct_check(rm, tgts,
+			    num_failures, nparity);
 			if (err == EINVAL) {
 				/*
 				 * Reconstruction not possible with this #
 				 * failures; try more failures.
 				 */
+				tried_all = B_FALSE;
 				break;
-			} else if (err == 0)
-				return (0);
+			} else if (err == 0 || !tried_fewer) {
+				err = raidz_reconstruct(rm, tgts, num_failures,
+				    nparity, verify_cb, arg);
+				if (err == 0)
+					return (0);
+			}
 
 			/* Compute next targets to try */
 			for (int t = 0; ; t++) {
@@ -2185,11 +2224,118 @@ vdev_raidz_combrec(zio_t *zio)
 			if (ltgts[num_failures - 1] == n)
 				break;
 		}
+		tried_fewer = tried_fewer && tried_all;
 	}
 
 	return (ECKSUM);
 }
 
+static boolean_t
+raidz_combrec_verify(raidz_map_t *rm, void *arg)
+{
+	zio_t *zio = arg;
+
+	ASSERT3P(zio->io_vsd, ==, rm);
+	return (raidz_checksum_verify(zio) == 0);
+}
+
+/*
+ * Attempt combinatorial reconstruction of a block which failed its checksum,
+ * targeting first the children which have seen the most errors.
+ */
+static int
+vdev_raidz_combrec(zio_t *zio)
+{
+	vdev_t *vd = zio->io_vd;
+	int nparity = vdev_get_nparity(vd);
+	raidz_map_t *rm = zio->io_vsd;
+
+	/* Check if there's enough data to attempt reconstrution. */
+	for (int i = 0; i < rm->rm_nrows; i++) {
+		raidz_row_t *rr = rm->rm_row[i];
+		int total_errors = 0;
+
+		for (int c = 0; c < rr->rr_cols; c++) {
+			if (rr->rr_col[c].rc_error)
+				total_errors++;
+		}
+
+		if (total_errors > nparity)
+			return (vdev_raidz_worst_error(rr));
+	}
+
+	/*
+	 * Silent damage tends to keep turning up on the same children, so
+	 * sort them by their error counts, keeping them in child ID order
+	 * otherwise.
+	 */
+	int n = vd->vdev_children;
+	int *order = kmem_alloc(n * sizeof (int), KM_SLEEP);
+	uint64_t *errors = kmem_alloc(n * sizeof (uint64_t), KM_SLEEP);
+
+	for (int c = 0; c < n; c++) {
+		vdev_t *cvd = vd->vdev_child[c];
+		uint64_t e;
+		int i;
+
+		mutex_enter(&cvd->vdev_stat_lock);
+		e = cvd->vdev_stat.vs_checksum_errors +
+		    cvd->vdev_stat.vs_read_errors;
+		mutex_exit(&cvd->vdev_stat_lock);
+
+		for (i = c; i > 0 && errors[i - 1] < e; i--) {
+			errors[i] = errors[i - 1];
+			order[i] = order[i - 1];
+		}
+		errors[i] = e;
+		order[i] = c;
+	}
+
+	int err = vdev_raidz_combrec_map(rm, nparity, n, order,
+	    raidz_combrec_verify, zio);
+
+	kmem_free(errors, n * sizeof (uint64_t));
+	kmem_free(order, n * sizeof (int));
+
+	if (err != 0)
+		return (err);
+
+	/* Reconstruction succeeded - report errors */
+	for (int i = 0; i < rm->rm_nrows; i++) {
+		raidz_row_t *rr = rm->rm_row[i];
+
+		for (int c = 0; c < rr->rr_cols; c++) {
+			raidz_col_t *rc = &rr->rr_col[c];
+			if (rc->rc_need_orig_restore) {
+				/*
+				 * Note: if this is a parity column,
+				 * we don't really know if it's wrong.
+				 * We need to let
+				 * vdev_raidz_io_done_verified() check
+				 * it, and if we set rc_error, it will
+				 * think that it is a "known" error
+				 * that doesn't need to be checked
+				 * or corrected.
+				 */
+				if (rc->rc_error == 0 &&
+				    c >= rr->rr_firstdatacol) {
+					vdev_raidz_checksum_error(zio,
+					    rc, rc->rc_orig_data);
+					rc->rc_error =
+					    SET_ERROR(ECKSUM);
+				}
+				rc->rc_need_orig_restore = B_FALSE;
+			}
+		}
+
+		vdev_raidz_io_done_verified(zio, rr);
+	}
+
+	zio_checksum_verified(zio);
+
+	return (0);
+}
+
 void
 vdev_raidz_reconstruct(raidz_map_t *rm, const int *t, int nt)
 {
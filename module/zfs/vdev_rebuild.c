@@ -113,6 +113,10 @@ static uint64_t zfs_rebuild_max_segment = 1024 * 1024;
  * the vdev queues full of I/Os at all times and not overflowing the queues
  * to cause long latency, which would cause long txg sync times.
  *
+ * For dRAID this is enforced for each child, scaled down for children whose
+ * reads are currently slower than those of the fastest child.  Other vdev
+ * types only limit the total for the top-level vdev.
+ *
  * A large default value can be safely used here because the default target
  * segment size is also large (zfs_rebuild_max_segment=1M).  This helps keep
  * the queue depth short.
@@ -473,6 +477,195 @@ vdev_rebuild_clear_sync(void *arg, dmu_tx_t *tx)
 	mutex_exit(&vd->vdev_rebuild_lock);
 }
 
+/*
+ * A dRAID rebuild I/O reads from, and writes to, each child of a single
+ * redundancy group, the same amount on each.  Fill in their ids and return
+ * how many there are.  Children aren't tracked for other vdev types.
+ */
+static int
+vdev_rebuild_io_children(vdev_rebuild_t *vr, uint64_t start, uint64_t size,
+    uint8_t *cids, uint64_t *child_bytes)
+{
+	*child_bytes = 0;
+	if (vr->vr_children == 0)
+		return (0);
+
+	int n = vdev_draid_group_children(vr->vr_top_vdev, start, cids);
+	*child_bytes = size / n;
+
+	return (n);
+}
+
+/*
+ * Whether any of the children an I/O would go to already have as much
+ * rebuild I/O in flight as they're allowed.
+ */
+static boolean_t
+vdev_rebuild_children_busy(vdev_rebuild_t *vr, const uint8_t *cids, int n,
+    uint64_t child_bytes)
+{
+	ASSERT(MUTEX_HELD(&vr->vr_io_lock));
+
+	for (int i = 0; i < n; i++) {
+		uint64_t inflight = vr->vr_child_inflight[cids[i]];
+
+		if (inflight != 0 && inflight + child_bytes >
+		    vr->vr_child_inflight_max[cids[i]])
+			return (B_TRUE);
+	}
+
+	return (B_FALSE);
+}
+
+/*
+ * Allow each dRAID child up to zfs_rebuild_vdev_limit bytes of rebuild I/O
+ * in flight, reduced in proportion to how much slower its reads currently
+ * are than the fastest child's.  Every group spans a different set of
+ * children, so this keeps a slow child from accumulating a queue which
+ * takes much longer to drain than everyone else's, while the others are
+ * kept busy with the groups which don't include it.
+ */
+static void
+vdev_rebuild_update_child_limits(vdev_rebuild_t *vr)
+{
+	vdev_t *vd = vr->vr_top_vdev;
+	spa_t *spa = vd->vdev_spa;
+	hrtime_t fastest = 0;
+
+	spa_config_enter(spa, SCL_CONFIG, FTAG, RW_READER);
+	for (uint64_t c = 0; c < vr->vr_children; c++) {
+		vdev_t *cvd = vd->vdev_child[c];
+		hrtime_t lat;
+
+		if (!cvd->vdev_ops->vdev_op_leaf)
+			continue;
+		lat = vdev_queue_read_latency(cvd);
+		if (lat != 0 && (fastest == 0 || lat < fastest))
+			fastest = lat;
+	}
+
+	mutex_enter(&vr->vr_io_lock);
+	for (uint64_t c = 0; c < vr->vr_children; c++) {
+		vdev_t *cvd = vd->vdev_child[c];
+		uint64_t limit = zfs_rebuild_vdev_limit;
+
+		if (cvd->vdev_ops->vdev_op_leaf && fastest != 0) {
+			hrtime_t lat = vdev_queue_read_latency(cvd);
+			if (lat > fastest)
+				limit = limit * fastest / lat;
+		}
+		vr->vr_child_inflight_max[c] = MAX(limit,
+		    zfs_rebuild_max_segment);
+	}
+	cv_broadcast(&vr->vr_io_cv);
+	mutex_exit(&vr->vr_io_lock);
+	spa_config_exit(spa, SCL_CONFIG, FTAG);
+}
+
+/*
+ * Number of kstat entries reported for each dRAID child being rebuilt.
+ */
+#define	VDEV_REBUILD_CHILD_STATS	3
+
+static int
+vdev_rebuild_child_kstat_update(kstat_t *ksp, int rw)
+{
+	vdev_rebuild_t *vr = ksp->ks_private;
+	kstat_named_t *ks = ksp->ks_data;
+	uint64_t ms = MAX(NSEC2MSEC(gethrtime() - vr->vr_pass_start_time), 1);
+
+	if (rw == KSTAT_WRITE)
+		return (SET_ERROR(EACCES));
+
+	for (uint64_t c = 0; c < vr->vr_children; c++) {
+		uint64_t issued = vr->vr_child_issued[c];
+
+		ks[0].value.ui64 = issued;
+		ks[1].value.ui64 = vr->vr_child_inflight[c];
+		ks[2].value.ui64 = issued * 1000 / ms;
+		ks += VDEV_REBUILD_CHILD_STATS;
+	}
+
+	return (0);
+}
+
+/*
+ * Publish the bytes issued to, bytes in flight on, and issue rate of each
+ * child of a dRAID vdev being rebuilt as the zfs/<pool>/rebuild_<vdev id>
+ * kstat, for as long as the rebuild is running.
+ */
+static void
+vdev_rebuild_child_kstat_init(vdev_rebuild_t *vr)
+{
+	vdev_t *vd = vr->vr_top_vdev;
+	uint64_t n = vr->vr_children * VDEV_REBUILD_CHILD_STATS;
+
+	vr->vr_child_stats = kmem_zalloc(n * sizeof (kstat_named_t),
+	    KM_SLEEP);
+	for (uint64_t c = 0; c < vr->vr_children; c++) {
+		kstat_named_t *ks =
+		    &vr->vr_child_stats[c * VDEV_REBUILD_CHILD_STATS];
+
+		(void) snprintf(ks[0].name, KSTAT_STRLEN, "child%llu_issued",
+		    (u_longlong_t)c);
+		(void) snprintf(ks[1].name, KSTAT_STRLEN, "child%llu_inflight",
+		    (u_longlong_t)c);
+		(void) snprintf(ks[2].name, KSTAT_STRLEN,
+		    "child%llu_bytes_per_sec", (u_longlong_t)c);
+		for (int i = 0; i < VDEV_REBUILD_CHILD_STATS; i++)
+			ks[i].data_type = KSTAT_DATA_UINT64;
+	}
+
+	char *module = kmem_asprintf("zfs/%s", spa_name(vd->vdev_spa));
+	char *name = kmem_asprintf("rebuild_%llu", (u_longlong_t)vd->vdev_id);
+	kstat_t *ksp = kstat_create(module, 0, name, "misc", KSTAT_TYPE_NAMED,
+	    n, KSTAT_FLAG_VIRTUAL);
+	vr->vr_child_ksp = ksp;
+
+	if (ksp != NULL) {
+		ksp->ks_lock = &vr->vr_io_lock;
+		ksp->ks_data = vr->vr_child_stats;
+		ksp->ks_private = vr;
+		ksp->ks_update = vdev_rebuild_child_kstat_update;
+		kstat_install(ksp);
+	}
+	kmem_strfree(name);
+	kmem_strfree(module);
+}
+
+static void
+vdev_rebuild_child_kstat_fini(vdev_rebuild_t *vr)
+{
+	if (vr->vr_child_ksp != NULL) {
+		kstat_delete(vr->vr_child_ksp);
+		vr->vr_child_ksp = NULL;
+	}
+	kmem_free(vr->vr_child_stats, vr->vr_children *
+	    VDEV_REBUILD_CHILD_STATS * sizeof (kstat_named_t));
+	vr->vr_child_stats = NULL;
+}
+
+/*
+ * Log how much each dRAID child was asked to rebuild and at what rate.
+ */
+static void
+vdev_rebuild_log_children(vdev_rebuild_t *vr)
+{
+	vdev_t *vd = vr->vr_top_vdev;
+	uint64_t ms = MAX(NSEC2MSEC(gethrtime() - vr->vr_pass_start_time), 1);
+
+	for (uint64_t c = 0; c < vr->vr_children; c++) {
+		vdev_t *cvd = vd->vdev_child[c];
+
+		zfs_dbgmsg("rebuild of %s child %llu (%s): issued %llu bytes "
+		    "in %llu ms, %llu KiB/s", vd->vdev_spa->spa_name,
+		    (u_longlong_t)c,
+		    cvd->vdev_path != NULL ? cvd->vdev_path : "-",
+		    (u_longlong_t)vr->vr_child_issued[c], (u_longlong_t)ms,
+		    (u_longlong_t)(vr->vr_child_issued[c] * 1000 / 1024 / ms));
+	}
+}
+
 /*
  * The zio_done_func_t callback for each rebuild I/O issued.  It's responsible
  * for updating the rebuild stats and limiting the number of in flight I/Os.
@@ -483,6 +676,11 @@ vdev_rebuild_cb(zio_t *zio)
 	vdev_rebuild_t *vr = zio->io_private;
 	vdev_rebuild_phys_t *vrp = &vr->vr_rebuild_phys;
 	vdev_t *vd = vr->vr_top_vdev;
+	const dva_t *dva = &zio->io_bp->blk_dva[0];
+	uint8_t cids[VDEV_DRAID_MAX_CHILDREN];
+	uint64_t child_bytes;
+	int nchildren = vdev_rebuild_io_children(vr, DVA_GET_OFFSET(dva),
+	    DVA_GET_ASIZE(dva), cids, &child_bytes);
 
 	mutex_enter(&vr->vr_io_lock);
 	if (zio->io_error == ENXIO && !vdev_writeable(vd)) {
@@ -503,6 +701,10 @@ vdev_rebuild_cb(zio_t *zio)
 
 	ASSERT3U(vr->vr_bytes_inflight, >, 0);
 	vr->vr_bytes_inflight -= zio->io_size;
+	for (int i = 0; i < nchildren; i++) {
+		ASSERT3U(vr->vr_child_inflight[cids[i]], >=, child_bytes);
+		vr->vr_child_inflight[cids[i]] -= child_bytes;
+	}
 	cv_broadcast(&vr->vr_io_cv);
 	mutex_exit(&vr->vr_io_lock);
 
@@ -576,13 +778,21 @@ vdev_rebuild_range(vdev_rebuild_t *vr, uint64_t start, uint64_t size)
 		return (0);
 	}
 
+	uint8_t cids[VDEV_DRAID_MAX_CHILDREN];
+	uint64_t child_bytes;
+	int nchildren = vdev_rebuild_io_children(vr, start, size, cids,
+	    &child_bytes);
+
 	mutex_enter(&vr->vr_io_lock);
 
 	/* Limit in flight rebuild I/Os */
-	while (vr->vr_bytes_inflight >= vr->vr_bytes_inflight_max)
+	while (vr->vr_bytes_inflight >= vr->vr_bytes_inflight_max ||
+	    vdev_rebuild_children_busy(vr, cids, nchildren, child_bytes))
 		cv_wait(&vr->vr_io_cv, &vr->vr_io_lock);
 
 	vr->vr_bytes_inflight += psize;
+	for (int i = 0; i < nchildren; i++)
+		vr->vr_child_inflight[cids[i]] += child_bytes;
 	mutex_exit(&vr->vr_io_lock);
 
 	dmu_tx_t *tx = dmu_tx_create_dd(spa_get_dsl(spa)->dp_mos_dir);
@@ -604,6 +814,9 @@ vdev_rebuild_range(vdev_rebuild_t *vr, uint64_t start, uint64_t size)
 	if (vdev_rebuild_should_stop(vd)) {
 		mutex_enter(&vr->vr_io_lock);
 		vr->vr_bytes_inflight -= psize;
+		for (int i = 0; i < nchildren; i++)
+			vr->vr_child_inflight[cids[i]] -= child_bytes;
+		cv_broadcast(&vr->vr_io_cv);
 		mutex_exit(&vr->vr_io_lock);
 		spa_config_exit(vd->vdev_spa, SCL_STATE_ALL, vd);
 		mutex_exit(&vd->vdev_rebuild_lock);
@@ -616,6 +829,12 @@ vdev_rebuild_range(vdev_rebuild_t *vr, uint64_t start, uint64_t size)
 	vr->vr_scan_offset[txg & TXG_MASK] = start + size;
 	vr->vr_pass_bytes_issued += size;
 	vr->vr_rebuild_phys.vrp_bytes_issued += size;
+	if (nchildren != 0) {
+		mutex_enter(&vr->vr_io_lock);
+		for (int i = 0; i < nchildren; i++)
+			vr->vr_child_issued[cids[i]] += child_bytes;
+		mutex_exit(&vr->vr_io_lock);
+	}
 
 	zio_nowait(zio_read(spa->spa_txg_zio[txg & TXG_MASK], spa, &blk,
 	    abd_alloc(psize, B_FALSE), psize, vdev_rebuild_cb, vr,
@@ -634,6 +853,7 @@ vdev_rebuild_ranges(vdev_rebuild_t *vr)
 	vdev_t *vd = vr->vr_top_vdev;
 	zfs_btree_t *t = &vr->vr_scan_tree->rt_root;
 	zfs_btree_index_t idx;
+	hrtime_t update_limits_time = 0;
 	int error;
 
 	for (range_seg_t *rs = zfs_btree_first(t, &idx); rs != NULL;
@@ -662,6 +882,12 @@ vdev_rebuild_ranges(vdev_rebuild_t *vr)
 			chunk_size = vd->vdev_ops->vdev_op_rebuild_asize(vd,
 			    start, size, zfs_rebuild_max_segment);
 
+			if (vr->vr_children != 0 &&
+			    gethrtime() >= update_limits_time) {
+				vdev_rebuild_update_child_limits(vr);
+				update_limits_time = gethrtime() + SEC2NSEC(1);
+			}
+
 			error = vdev_rebuild_range(vr, start, chunk_size);
 			if (error != 0)
 				return (error);
@@ -790,6 +1016,16 @@ vdev_rebuild_thread(void *arg)
 	vr->vr_pass_bytes_issued = 0;
 	vr->vr_pass_bytes_skipped = 0;
 
+	if (vd->vdev_ops == &vdev_draid_ops) {
+		uint64_t size = vd->vdev_children * sizeof (uint64_t);
+
+		vr->vr_children = vd->vdev_children;
+		vr->vr_child_inflight = kmem_zalloc(size, KM_SLEEP);
+		vr->vr_child_inflight_max = kmem_zalloc(size, KM_SLEEP);
+		vr->vr_child_issued = kmem_zalloc(size, KM_SLEEP);
+		vdev_rebuild_child_kstat_init(vr);
+	}
+
 	uint64_t update_est_time = gethrtime();
 	vdev_rebuild_update_bytes_est(vd, 0);
 
@@ -918,11 +1154,24 @@ vdev_rebuild_thread(void *arg)
 
 	mutex_exit(&vr->vr_io_lock);
 
+	if (vr->vr_children != 0)
+		vdev_rebuild_child_kstat_fini(vr);
+
 	mutex_destroy(&vr->vr_io_lock);
 	cv_destroy(&vr->vr_io_cv);
 
 	spa_config_enter(spa, SCL_CONFIG, FTAG, RW_READER);
 
+	if (vr->vr_children != 0) {
+		uint64_t size = vr->vr_children * sizeof (uint64_t);
+
+		vdev_rebuild_log_children(vr);
+		kmem_free(vr->vr_child_inflight, size);
+		kmem_free(vr->vr_child_inflight_max, size);
+		kmem_free(vr->vr_child_issued, size);
+		vr->vr_children = 0;
+	}
+
 	dsl_pool_t *dp = spa_get_dsl(spa);
 	dmu_tx_t *tx = dmu_tx_create_dd(dp->dp_mos_dir);
 	VERIFY0(dmu_tx_assign(tx, TXG_WAIT));
@@ -83,7 +83,10 @@
  * than a manual TRIM to encounter tiny ranges.  Ranges less than or equal to
  * 'zfs_trim_extent_bytes_min' (32k) are considered too small to efficiently
  * TRIM and are skipped.  This means small amounts of freed space may not
- * be automatically trimmed.
+ * be automatically trimmed.  The latency of every TRIM I/O is tracked per
+ * leaf vdev, and on devices which are slow to TRIM (see
+ * 'zfs_trim_latency_target_ms') the automatic TRIM skips larger ranges
+ * still, and issues fewer TRIMs at a time.
  *
  * Furthermore, devices with attached hot spares and devices being actively
  * replaced are skipped.  This is done to avoid adding additional stress to
@@ -136,6 +139,22 @@ static unsigned int zfs_trim_queue_limit = 10;
  */
 static unsigned int zfs_trim_txg_batch = 32;
 
+/*
+ * Target latency of a single TRIM I/O.  Some devices stall other I/O for
+ * a long time on every TRIM, however small.  When the average latency of
+ * TRIMs to a leaf vdev exceeds this target, automatic TRIM doubles the
+ * smallest extent it will issue to that vdev (up to
+ * zfs_trim_extent_bytes_max) each time it visits a metaslab, and only
+ * keeps one TRIM outstanding at a time.  Once the latency drops below
+ * half of the target, or nothing more has been measured, the smallest
+ * extent is halved again, back down to zfs_trim_extent_bytes_min.  The
+ * latency is measured on all TRIMs, so a manual TRIM also profiles the
+ * device.  The average latency, throughput and chosen extent size are
+ * kept in the leaf vdev ZAP.  Zero, the default, disables this, and no
+ * profile is kept or stored at all.
+ */
+static unsigned int zfs_trim_latency_target_ms = 0;
+
 /*
  * The trim_args are a control structure which describe how a leaf vdev
  * should be trimmed.  The core elements are the vdev, the metaslab being
@@ -375,6 +394,43 @@ vdev_trim_change_state(vdev_t *vd, vdev_trim_state_t new_state,
 		spa_notify_waiters(spa);
 }
 
+/*
+ * Folds a completed TRIM I/O in to the vdev's TRIM profile.  The averages
+ * are weighted 1/8 towards each new TRIM.  Only the time the device took to
+ * service the TRIM (io_delay) is counted, not the time it spent waiting in
+ * the vdev queue, where TRIMs are the lowest priority class and can sit for
+ * a long time on a busy pool.
+ */
+static void
+vdev_trim_profile_update(vdev_t *vd, zio_t *zio)
+{
+	ASSERT(MUTEX_HELD(&vd->vdev_trim_io_lock));
+
+	if (zfs_trim_latency_target_ms == 0 ||
+	    zio->io_error != 0 || zio->io_delay <= 0)
+		return;
+
+	if (vd->vdev_trim_latency == 0) {
+		vd->vdev_trim_latency = zio->io_delay;
+		vd->vdev_trim_size = zio->io_orig_size;
+	} else {
+		vd->vdev_trim_latency =
+		    (vd->vdev_trim_latency * 7 + zio->io_delay) / 8;
+		vd->vdev_trim_size =
+		    (vd->vdev_trim_size * 7 + zio->io_orig_size) / 8;
+	}
+	vd->vdev_trim_profile_ops++;
+}
+
+static boolean_t
+vdev_trim_is_slow(vdev_t *vd)
+{
+	ASSERT(MUTEX_HELD(&vd->vdev_trim_io_lock));
+
+	return (zfs_trim_latency_target_ms != 0 &&
+	    vd->vdev_trim_latency > MSEC2NSEC(zfs_trim_latency_target_ms));
+}
+
 /*
  * The zio_done_func_t done callback for each manual TRIM issued.  It is
  * responsible for updating the TRIM stats, reissuing failed TRIM I/Os,
@@ -406,6 +462,7 @@ vdev_trim_cb(zio_t *zio)
 		}
 
 		vd->vdev_trim_bytes_done += zio->io_orig_size;
+		vdev_trim_profile_update(vd, zio);
 	}
 
 	ASSERT3U(vd->vdev_trim_inflight[TRIM_TYPE_MANUAL], >, 0);
@@ -437,6 +494,7 @@ vdev_autotrim_cb(zio_t *zio)
 		spa_iostats_trim_add(vd->vdev_spa, TRIM_TYPE_AUTO,
 		    1, zio->io_orig_size, 0, 0, 0, 0);
 	}
+	vdev_trim_profile_update(vd, zio);
 
 	ASSERT3U(vd->vdev_trim_inflight[TRIM_TYPE_AUTO], >, 0);
 	vd->vdev_trim_inflight[TRIM_TYPE_AUTO]--;
@@ -467,6 +525,7 @@ vdev_trim_simple_cb(zio_t *zio)
 		spa_iostats_trim_add(vd->vdev_spa, TRIM_TYPE_SIMPLE,
 		    1, zio->io_orig_size, 0, 0, 0, 0);
 	}
+	vdev_trim_profile_update(vd, zio);
 
 	ASSERT3U(vd->vdev_trim_inflight[TRIM_TYPE_SIMPLE], >, 0);
 	vd->vdev_trim_inflight[TRIM_TYPE_SIMPLE]--;
@@ -512,9 +571,15 @@ vdev_trim_range(trim_args_t *ta, uint64_t start, uint64_t size)
 	}
 	ta->trim_bytes_done += size;
 
-	/* Limit in flight trimming I/Os */
+	/*
+	 * Limit in flight trimming I/Os.  Only one automatic TRIM at a
+	 * time is issued to a device which is slow to TRIM.
+	 */
+	uint64_t queue_limit = zfs_trim_queue_limit;
+	if (ta->trim_type == TRIM_TYPE_AUTO && vdev_trim_is_slow(vd))
+		queue_limit = 1;
 	while (vd->vdev_trim_inflight[0] + vd->vdev_trim_inflight[1] +
-	    vd->vdev_trim_inflight[2] >= zfs_trim_queue_limit) {
+	    vd->vdev_trim_inflight[2] >= queue_limit) {
 		cv_wait(&vd->vdev_trim_io_cv, &vd->vdev_trim_io_lock);
 	}
 	vd->vdev_trim_inflight[ta->trim_type]++;
@@ -1187,9 +1252,136 @@ vdev_trim_range_verify(void *arg, uint64_t start, uint64_t size)
 	VERIFY(range_tree_contains(msp->ms_allocatable, start, size));
 }
 
+/*
+ * Returns the smallest extent the automatic TRIM should issue to a leaf
+ * vdev, adjusting it according to how slow the vdev is to TRIM.  See
+ * zfs_trim_latency_target_ms.  If no TRIM has completed since the last
+ * adjustment there's nothing new to go on, and since that may well be
+ * because everything was skipped as too small, smaller extents are tried
+ * again.
+ */
+static uint64_t
+vdev_autotrim_extent_min(vdev_t *vd, uint64_t extent_min, uint64_t extent_max)
+{
+	uint64_t target = MSEC2NSEC(zfs_trim_latency_target_ms);
+
+	if (target == 0)
+		return (extent_min);
+
+	mutex_enter(&vd->vdev_trim_io_lock);
+	uint64_t cur = MAX(vd->vdev_autotrim_extent_min, extent_min);
+	uint64_t new_min = cur;
+
+	boolean_t measured =
+	    (vd->vdev_trim_profile_ops != vd->vdev_autotrim_profile_ops);
+	vd->vdev_autotrim_profile_ops = vd->vdev_trim_profile_ops;
+
+	if (!measured) {
+		new_min = cur / 2;
+	} else if (vdev_trim_is_slow(vd)) {
+		new_min = MAX(cur, 1ULL << vd->vdev_top->vdev_ashift) * 2;
+	} else if (vd->vdev_trim_latency < target / 2) {
+		new_min = cur / 2;
+	}
+	new_min = MIN(MAX(new_min, extent_min), extent_max);
+
+	if (new_min != vd->vdev_autotrim_extent_min) {
+		vd->vdev_autotrim_extent_min = new_min;
+		vd->vdev_trim_profile_dirty = B_TRUE;
+	}
+	mutex_exit(&vd->vdev_trim_io_lock);
+
+	return (new_min);
+}
+
+/*
+ * The sync task for storing a leaf vdev's TRIM profile in its ZAP.  Like
+ * vdev_trim_zap_update_sync() this is passed the guid of the vdev, which
+ * may have been removed by now.
+ */
+static void
+vdev_trim_profile_sync(void *arg, dmu_tx_t *tx)
+{
+	uint64_t guid = *(uint64_t *)arg;
+	kmem_free(arg, sizeof (uint64_t));
+
+	vdev_t *vd = spa_lookup_by_guid(tx->tx_pool->dp_spa, guid, B_FALSE);
+	if (vd == NULL || vd->vdev_top->vdev_removing ||
+	    !vdev_is_concrete(vd) || vd->vdev_leaf_zap == 0)
+		return;
+
+	mutex_enter(&vd->vdev_trim_io_lock);
+	uint64_t latency = vd->vdev_trim_latency;
+	uint64_t throughput = (latency == 0) ? 0 :
+	    vd->vdev_trim_size * NANOSEC / latency;
+	uint64_t extent_min = vd->vdev_autotrim_extent_min;
+	mutex_exit(&vd->vdev_trim_io_lock);
+
+	objset_t *mos = vd->vdev_spa->spa_meta_objset;
+	VERIFY0(zap_update(mos, vd->vdev_leaf_zap, VDEV_LEAF_ZAP_TRIM_LATENCY,
+	    sizeof (latency), 1, &latency, tx));
+	VERIFY0(zap_update(mos, vd->vdev_leaf_zap,
+	    VDEV_LEAF_ZAP_TRIM_THROUGHPUT, sizeof (throughput), 1,
+	    &throughput, tx));
+	VERIFY0(zap_update(mos, vd->vdev_leaf_zap,
+	    VDEV_LEAF_ZAP_TRIM_EXTENT_MIN, sizeof (extent_min), 1,
+	    &extent_min, tx));
+}
+
+/*
+ * Load the TRIM profile of a leaf vdev, as last stored by
+ * vdev_trim_profile_sync(), so that the automatic TRIM doesn't need to
+ * learn it again after every import.
+ */
+static void
+vdev_trim_profile_load(vdev_t *vd)
+{
+	objset_t *mos = vd->vdev_spa->spa_meta_objset;
+	uint64_t latency, throughput, extent_min;
+
+	if (zfs_trim_latency_target_ms == 0 || vd->vdev_leaf_zap == 0 ||
+	    zap_lookup(mos, vd->vdev_leaf_zap, VDEV_LEAF_ZAP_TRIM_LATENCY,
+	    sizeof (latency), 1, &latency) != 0 ||
+	    zap_lookup(mos, vd->vdev_leaf_zap, VDEV_LEAF_ZAP_TRIM_THROUGHPUT,
+	    sizeof (throughput), 1, &throughput) != 0 ||
+	    zap_lookup(mos, vd->vdev_leaf_zap, VDEV_LEAF_ZAP_TRIM_EXTENT_MIN,
+	    sizeof (extent_min), 1, &extent_min) != 0)
+		return;
+
+	mutex_enter(&vd->vdev_trim_io_lock);
+	if (vd->vdev_trim_latency == 0) {
+		vd->vdev_trim_latency = latency;
+		vd->vdev_trim_size = throughput * latency / NANOSEC;
+		vd->vdev_autotrim_extent_min = extent_min;
+	}
+	mutex_exit(&vd->vdev_trim_io_lock);
+}
+
+/*
+ * Store the TRIM profiles of the leaves of a top-level vdev which have
+ * changed.  Must be called without the config lock held.
+ */
+static void
+vdev_autotrim_profile_update(spa_t *spa, uint64_t *guids, uint64_t count)
+{
+	if (count == 0)
+		return;
+
+	dmu_tx_t *tx = dmu_tx_create_dd(spa_get_dsl(spa)->dp_mos_dir);
+	VERIFY0(dmu_tx_assign(tx, TXG_WAIT));
+	for (uint64_t c = 0; c < count; c++) {
+		uint64_t *guid = kmem_zalloc(sizeof (uint64_t), KM_SLEEP);
+		*guid = guids[c];
+		dsl_sync_task_nowait(spa_get_dsl(spa),
+		    vdev_trim_profile_sync, guid, tx);
+	}
+	dmu_tx_commit(tx);
+}
+
 /*
  * Each automatic TRIM thread is responsible for managing the trimming of a
- * top-level vdev in the pool.  No automatic TRIM state is maintained on-disk.
+ * top-level vdev in the pool.  Apart from the TRIM profile of each leaf,
+ * no automatic TRIM state is maintained on-disk.
  *
  * N.B. This behavior is different from a manual TRIM where a thread
  * is created for each leaf vdev, instead of each top-level vdev.
@@ -1207,6 +1399,15 @@ vdev_autotrim_thread(void *arg)
 	mutex_exit(&vd->vdev_autotrim_lock);
 	spa_config_enter(spa, SCL_CONFIG, FTAG, RW_READER);
 
+	if (vd->vdev_children == 0) {
+		vdev_trim_profile_load(vd);
+	} else {
+		for (uint64_t c = 0; c < vd->vdev_children; c++) {
+			if (vd->vdev_child[c]->vdev_ops->vdev_op_leaf)
+				vdev_trim_profile_load(vd->vdev_child[c]);
+		}
+	}
+
 	while (!vdev_autotrim_should_stop(vd)) {
 		int txgs_per_trim = MAX(zfs_trim_txg_batch, 1);
 		uint64_t extent_bytes_max = zfs_trim_extent_bytes_max;
@@ -1337,6 +1538,9 @@ vdev_autotrim_thread(void *arg)
 				if (!cvd->vdev_ops->vdev_op_leaf)
 					continue;
 
+				ta->trim_extent_bytes_min =
+				    vdev_autotrim_extent_min(cvd,
+				    extent_bytes_min, extent_bytes_max);
 				ta->trim_tree = range_tree_create(NULL,
 				    RANGE_SEG64, NULL, 0, 0);
 				range_tree_walk(trim_tree,
@@ -1424,8 +1628,31 @@ vdev_autotrim_thread(void *arg)
 				break;
 		}
 
+		/*
+		 * Note which leaves have a changed TRIM profile, to store
+		 * it once the config lock has been dropped.
+		 */
+		uint64_t children = MAX(vd->vdev_children, 1);
+		uint64_t *guids = kmem_alloc(children * sizeof (uint64_t),
+		    KM_SLEEP);
+		uint64_t dirty = 0;
+		for (uint64_t c = 0; c < children; c++) {
+			vdev_t *cvd = (vd->vdev_children == 0) ? vd :
+			    vd->vdev_child[c];
+
+			mutex_enter(&cvd->vdev_trim_io_lock);
+			if (cvd->vdev_trim_profile_dirty) {
+				cvd->vdev_trim_profile_dirty = B_FALSE;
+				guids[dirty++] = cvd->vdev_guid;
+			}
+			mutex_exit(&cvd->vdev_trim_io_lock);
+		}
+
 		spa_config_exit(spa, SCL_CONFIG, FTAG);
 
+		vdev_autotrim_profile_update(spa, guids, dirty);
+		kmem_free(guids, children * sizeof (uint64_t));
+
 		vdev_autotrim_wait_kick(vd, 1);
 
 		shift++;
@@ -1764,3 +1991,6 @@ ZFS_MODULE_PARAM(zfs_trim, zfs_trim_, txg_batch, UINT, ZMOD_RW,
 
 ZFS_MODULE_PARAM(zfs_trim, zfs_trim_, queue_limit, UINT, ZMOD_RW,
 	"Max queued TRIMs outstanding per leaf vdev");
+
+ZFS_MODULE_PARAM(zfs_trim, zfs_trim_, latency_target_ms, UINT, ZMOD_RW,
+	"TRIM latency above which automatic TRIM backs off");
@@ -338,19 +338,70 @@ zap_leaf_array_match(zap_leaf_t *l, zap_name_t *zn,
 	int bseen = 0;
 
 	if (zap_getflags(zn->zn_zap) & ZAP_FLAG_UINT64_KEY) {
-		uint64_t *thiskey =
-		    kmem_alloc(array_numints * sizeof (*thiskey), KM_SLEEP);
-		ASSERT(zn->zn_key_intlen == sizeof (*thiskey));
-
-		zap_leaf_array_read(l, chunk, sizeof (*thiskey), array_numints,
-		    sizeof (*thiskey), array_numints, thiskey);
-		boolean_t match = memcmp(thiskey, zn->zn_key_orig,
-		    array_numints * sizeof (*thiskey)) == 0;
-		kmem_free(thiskey, array_numints * sizeof (*thiskey));
-		return (match);
+		const uint64_t *key = zn->zn_key_orig;
+		uint64_t value = 0;
+		int byten = 0;
+
+		ASSERT(zn->zn_key_intlen == sizeof (*key));
+
+		/*
+		 * Compare the key as it is decoded from the chunks rather
+		 * than reading it into a temporary buffer, so that the
+		 * (frequent, e.g. DDT) lookups in uint64-keyed zaps neither
+		 * allocate nor decode past the first mismatching integer.
+		 */
+		if (array_numints != zn->zn_key_orig_numints)
+			return (B_FALSE);
+		while (chunk != CHAIN_END) {
+			struct zap_leaf_array *la =
+			    &ZAP_LEAF_CHUNK(l, chunk).l_array;
+
+			ASSERT3U(chunk, <, ZAP_LEAF_NUMCHUNKS(l));
+			for (int i = 0; i < ZAP_LEAF_ARRAY_BYTES; i++) {
+				value = (value << 8) | la->la_array[i];
+				if (++byten < sizeof (*key))
+					continue;
+				if (value != *key++)
+					return (B_FALSE);
+				if (--array_numints == 0)
+					return (B_TRUE);
+				byten = 0;
+				value = 0;
+			}
+			chunk = la->la_next;
+		}
+		return (B_FALSE);
 	}
 
 	ASSERT(zn->zn_key_intlen == 1);
+
+	/*
+	 * Fast path for exact matching.
+	 * First check that the lengths match, so that we don't read
+	 * past the end of the zn_key_orig array.  A name stored exactly
+	 * as given also matches a normalized lookup, since it normalizes
+	 * to the same string, so the (usual) lookup of a name spelled as
+	 * it was created skips reading and normalizing the stored name.
+	 */
+	if (array_numints == zn->zn_key_orig_numints) {
+		uint16_t c = chunk;
+
+		while (bseen < array_numints) {
+			struct zap_leaf_array *la =
+			    &ZAP_LEAF_CHUNK(l, c).l_array;
+			int toread = MIN(array_numints - bseen,
+			    ZAP_LEAF_ARRAY_BYTES);
+			ASSERT3U(c, <, ZAP_LEAF_NUMCHUNKS(l));
+			if (memcmp(la->la_array,
+			    (char *)zn->zn_key_orig + bseen, toread))
+				break;
+			c = la->la_next;
+			bseen += toread;
+		}
+		if (bseen == array_numints)
+			return (B_TRUE);
+	}
+
 	if (zn->zn_matchtype & MT_NORMALIZE) {
 		char *thisname = kmem_alloc(array_numints, KM_SLEEP);
 
@@ -361,24 +412,7 @@ zap_leaf_array_match(zap_leaf_t *l, zap_name_t *zn,
 		return (match);
 	}
 
-	/*
-	 * Fast path for exact matching.
-	 * First check that the lengths match, so that we don't read
-	 * past the end of the zn_key_orig array.
-	 */
-	if (array_numints != zn->zn_key_orig_numints)
-		return (B_FALSE);
-	while (bseen < array_numints) {
-		struct zap_leaf_array *la = &ZAP_LEAF_CHUNK(l, chunk).l_array;
-		int toread = MIN(array_numints - bseen, ZAP_LEAF_ARRAY_BYTES);
-		ASSERT3U(chunk, <, ZAP_LEAF_NUMCHUNKS(l));
-		if (memcmp(la->la_array, (char *)zn->zn_key_orig + bseen,
-		    toread))
-			break;
-		chunk = la->la_next;
-		bseen += toread;
-	}
-	return (bseen == array_numints);
+	return (B_FALSE);
 }
 
 /*
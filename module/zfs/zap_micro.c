@@ -154,6 +154,10 @@ zap_match(zap_name_t *zn, const char *matchname)
 	if (zn->zn_matchtype & MT_NORMALIZE) {
 		char norm[ZAP_MAXNAMELEN];
 
+		/* a name spelled as given needs no normalization */
+		if (strcmp(zn->zn_key_orig, matchname) == 0)
+			return (B_TRUE);
+
 		if (zap_normalize(zn->zn_zap, matchname, norm,
 		    zn->zn_normflags) != 0)
 			return (B_FALSE);
@@ -299,6 +303,17 @@ mze_compare(const void *arg1, const void *arg2)
 ZFS_BTREE_FIND_IN_BUF_FUNC(mze_find_in_buf, mzap_ent_t,
     mze_compare)
 
+static void
+mze_init(zap_t *zap, mzap_ent_t *mze, uint16_t chunkid, uint64_t hash)
+{
+	mze->mze_chunkid = chunkid;
+	ASSERT0(hash & 0xffffffff);
+	mze->mze_hash = hash >> 32;
+	ASSERT3U(MZE_PHYS(zap, mze)->mze_cd, <=, 0xffff);
+	mze->mze_cd = (uint16_t)MZE_PHYS(zap, mze)->mze_cd;
+	ASSERT(MZE_PHYS(zap, mze)->mze_name[0] != 0);
+}
+
 static void
 mze_insert(zap_t *zap, uint16_t chunkid, uint64_t hash)
 {
@@ -307,12 +322,7 @@ mze_insert(zap_t *zap, uint16_t chunkid, uint64_t hash)
 	ASSERT(zap->zap_ismicro);
 	ASSERT(RW_WRITE_HELD(&zap->zap_rwlock));
 
-	mze.mze_chunkid = chunkid;
-	ASSERT0(hash & 0xffffffff);
-	mze.mze_hash = hash >> 32;
-	ASSERT3U(MZE_PHYS(zap, &mze)->mze_cd, <=, 0xffff);
-	mze.mze_cd = (uint16_t)MZE_PHYS(zap, &mze)->mze_cd;
-	ASSERT(MZE_PHYS(zap, &mze)->mze_name[0] != 0);
+	mze_init(zap, &mze, chunkid, hash);
 	zfs_btree_add(&zap->zap_m.zap_tree, &mze);
 }
 
@@ -467,17 +477,34 @@ mzap_open(objset_t *os, uint64_t obj, dmu_buf_t *db)
 		zfs_btree_create_custom(&zap->zap_m.zap_tree, mze_compare,
 		    mze_find_in_buf, sizeof (mzap_ent_t), 512);
 
+		/*
+		 * Hash all the entries first and add them to the B-tree in
+		 * sorted order.  That keeps the B-tree in bulk-insert mode,
+		 * where each add is an append to the last leaf rather than
+		 * a search and memmove(), and leaves the leaves fully packed
+		 * instead of half full from splits, which matters for the
+		 * memory footprint of every cached directory.
+		 */
+		uint16_t nents = 0;
+		mzap_ent_t *mzes = kmem_alloc(zap->zap_m.zap_num_chunks *
+		    sizeof (mzap_ent_t), KM_SLEEP);
 		zap_name_t *zn = zap_name_alloc(zap);
 		for (uint16_t i = 0; i < zap->zap_m.zap_num_chunks; i++) {
 			mzap_ent_phys_t *mze =
 			    &zap_m_phys(zap)->mz_chunk[i];
 			if (mze->mze_name[0]) {
-				zap->zap_m.zap_num_entries++;
 				zap_name_init_str(zn, mze->mze_name, 0);
-				mze_insert(zap, i, zn->zn_hash);
+				mze_init(zap, &mzes[nents++], i, zn->zn_hash);
 			}
 		}
 		zap_name_free(zn);
+
+		qsort(mzes, nents, sizeof (mzap_ent_t), mze_compare);
+		for (uint16_t i = 0; i < nents; i++)
+			zfs_btree_add(&zap->zap_m.zap_tree, &mzes[i]);
+		zap->zap_m.zap_num_entries = nents;
+		kmem_free(mzes, zap->zap_m.zap_num_chunks *
+		    sizeof (mzap_ent_t));
 	} else {
 		zap->zap_salt = zap_f_phys(zap)->zap_salt;
 		zap->zap_normflags = zap_f_phys(zap)->zap_normflags;
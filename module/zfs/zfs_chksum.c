@@ -45,6 +45,8 @@ typedef struct {
 	uint64_t bs1m;
 	uint64_t bs4m;
 	uint64_t bs16m;
+	uint32_t bufs;	/* multi-buffer: buffers hashed by each call */
+	boolean_t sleeps;	/* allocates or waits, keep preemption on */
 	zio_cksum_salt_t salt;
 	zio_checksum_t *(func);
 	zio_checksum_tmpl_init_t *(init);
@@ -55,6 +57,13 @@ static chksum_stat_t *chksum_stat_data = 0;
 static int chksum_stat_cnt = 0;
 static kstat_t *chksum_kstat = NULL;
 
+/*
+ * Fewest blocks the multi-buffer SHA2 implementations must hash at once to
+ * be faster than hashing them one by one, see chksum_mb_min().
+ */
+static int chksum_sha256_mb_min = 2;
+static int chksum_sha512_mb_min = 2;
+
 /*
  * Sample output on i3-1005G1 System:
  *
@@ -164,7 +173,8 @@ chksum_run(chksum_stat_t *cs, abd_t *abd, void *ctx, int round,
 		size = 1<<24; loops = 1; break;
 	}
 
-	kpreempt_disable();
+	if (!cs->sleeps)
+		kpreempt_disable();
 	start = gethrtime();
 	do {
 		for (l = 0; l < loops; l++, run_count++)
@@ -172,13 +182,66 @@ chksum_run(chksum_stat_t *cs, abd_t *abd, void *ctx, int round,
 
 		run_time_ns = gethrtime() - start;
 	} while (run_time_ns < MSEC2NSEC(1));
-	kpreempt_enable();
+	if (!cs->sleeps)
+		kpreempt_enable();
 
-	run_bw = size * run_count * NANOSEC;
+	run_bw = size * run_count * MAX(cs->bufs, 1) * NANOSEC;
 	run_bw /= run_time_ns;	/* B/s */
 	*result = run_bw/1024/1024; /* MiB/s */
 }
 
+/*
+ * The multi-buffer rows hash the block once in every lane of the selected
+ * implementation, which the bandwidth of the row accounts for.
+ */
+static void
+chksum_sha2_mb(int algotype, abd_t *abd, uint64_t size, zio_cksum_t *zcp)
+{
+	const void *data[SHA2_MB_MAX_LANES];
+	size_t len[SHA2_MB_MAX_LANES];
+	void *digest[SHA2_MB_MAX_LANES];
+	int n = SHA2MultiBufferLanes(algotype);
+
+	for (int i = 0; i < n; i++) {
+		data[i] = abd_to_buf(abd);
+		len[i] = size;
+		digest[i] = zcp;
+	}
+	SHA2MultiBuffer(algotype, n, data, len, digest);
+}
+
+static void
+chksum_sha256_mb(abd_t *abd, uint64_t size, const void *ctx_template,
+    zio_cksum_t *zcp)
+{
+	(void) ctx_template;
+	chksum_sha2_mb(SHA256, abd, size, zcp);
+}
+
+static void
+chksum_sha512_mb(abd_t *abd, uint64_t size, const void *ctx_template,
+    zio_cksum_t *zcp)
+{
+	(void) ctx_template;
+	chksum_sha2_mb(SHA512_256, abd, size, zcp);
+}
+
+/*
+ * A multi-buffer implementation with the given number of lanes needs to hash
+ * at least lanes * single / multi blocks at once to be faster than the
+ * single-buffer one, given their bandwidths with all lanes busy.
+ */
+static int
+chksum_mb_min(uint64_t single, uint64_t multi, uint32_t lanes)
+{
+	uint64_t min;
+
+	if (multi == 0)
+		return (2);
+	min = (lanes * single + multi - 1) / multi;
+	return (MAX(min, 2));
+}
+
 #define	LIMIT_INIT	0
 #define	LIMIT_NEEDED	1
 #define	LIMIT_NOLIMIT	2
@@ -219,8 +282,14 @@ chksum_benchit(chksum_stat_t *cs)
 	chksum_run(cs, abd, ctx, 6, &cs->bs1m);
 	abd_free(abd);
 
-	/* allocate test memory via abd non linear interface */
-	abd = abd_alloc(1<<24, B_FALSE);
+	/*
+	 * allocate test memory via abd non linear interface, unless the
+	 * function hashes linear buffers only
+	 */
+	if (cs->bufs != 0)
+		abd = abd_alloc_linear(1<<24, B_FALSE);
+	else
+		abd = abd_alloc(1<<24, B_FALSE);
 	chksum_run(cs, abd, ctx, 7, &cs->bs4m);
 	chksum_run(cs, abd, ctx, 8, &cs->bs16m);
 
@@ -245,16 +314,22 @@ chksum_benchmark(void)
 
 	chksum_stat_t *cs;
 	uint64_t max;
-	uint32_t id, cbid = 0, id_save;
+	uint32_t id, cbid = 0, id_save, fastest;
 	const zfs_impl_t *blake3 = zfs_impl_get_ops("blake3");
 	const zfs_impl_t *sha256 = zfs_impl_get_ops("sha256");
 	const zfs_impl_t *sha512 = zfs_impl_get_ops("sha512");
+	const zfs_impl_t *sha256_mb = zfs_impl_get_ops("sha256_mb");
+	const zfs_impl_t *sha512_mb = zfs_impl_get_ops("sha512_mb");
+	uint64_t single;
+	uint32_t lanes;
 
 	/* count implementations */
 	chksum_stat_cnt = 2;
 	chksum_stat_cnt += sha256->getcnt();
 	chksum_stat_cnt += sha512->getcnt();
-	chksum_stat_cnt += blake3->getcnt();
+	chksum_stat_cnt += sha256_mb->getcnt();
+	chksum_stat_cnt += sha512_mb->getcnt();
+	chksum_stat_cnt += blake3->getcnt() + 1;
 	chksum_stat_data = kmem_zalloc(
 	    sizeof (chksum_stat_t) * chksum_stat_cnt, KM_SLEEP);
 
@@ -314,31 +389,108 @@ chksum_benchmark(void)
 	}
 	sha512->setid(id_save);
 
+	/*
+	 * sha256_mb - the generic implementation goes first, it runs the
+	 * fastest sha256 implementation on a single lane
+	 */
+	id_save = sha256_mb->getid();
+	for (max = 0, single = 0, lanes = 1, id = 0;
+	    id < sha256_mb->getcnt(); id++) {
+		sha256_mb->setid(id);
+		cs = &chksum_stat_data[cbid++];
+		cs->init = 0;
+		cs->func = chksum_sha256_mb;
+		cs->free = 0;
+		cs->name = sha256_mb->name;
+		cs->impl = sha256_mb->getname();
+		cs->bufs = SHA2MultiBufferLanes(SHA256);
+		cs->sleeps = B_TRUE;
+		chksum_benchit(cs);
+		if (id == 0)
+			single = cs->bs256k;
+		if (cs->bs256k > max) {
+			max = cs->bs256k;
+			lanes = cs->bufs;
+			sha256_mb->set_fastest(id);
+		}
+	}
+	sha256_mb->setid(id_save);
+	chksum_sha256_mb_min = chksum_mb_min(single, max, lanes);
+
+	/* sha512_mb */
+	id_save = sha512_mb->getid();
+	for (max = 0, single = 0, lanes = 1, id = 0;
+	    id < sha512_mb->getcnt(); id++) {
+		sha512_mb->setid(id);
+		cs = &chksum_stat_data[cbid++];
+		cs->init = 0;
+		cs->func = chksum_sha512_mb;
+		cs->free = 0;
+		cs->name = sha512_mb->name;
+		cs->impl = sha512_mb->getname();
+		cs->bufs = SHA2MultiBufferLanes(SHA512_256);
+		cs->sleeps = B_TRUE;
+		chksum_benchit(cs);
+		if (id == 0)
+			single = cs->bs256k;
+		if (cs->bs256k > max) {
+			max = cs->bs256k;
+			lanes = cs->bufs;
+			sha512_mb->set_fastest(id);
+		}
+	}
+	sha512_mb->setid(id_save);
+	chksum_sha512_mb_min = chksum_mb_min(single, max, lanes);
+
 	/* blake3 */
 	id_save = blake3->getid();
-	for (max = 0, id = 0; id < blake3->getcnt(); id++) {
+	for (max = 0, fastest = 0, id = 0; id < blake3->getcnt(); id++) {
 		blake3->setid(id);
 		cs = &chksum_stat_data[cbid++];
 		cs->init = abd_checksum_blake3_tmpl_init;
-		cs->func = abd_checksum_blake3_native;
+		cs->func = abd_checksum_blake3_serial;
 		cs->free = abd_checksum_blake3_tmpl_free;
 		cs->name = blake3->name;
 		cs->impl = blake3->getname();
 		chksum_benchit(cs);
 		if (cs->bs256k > max) {
 			max = cs->bs256k;
+			fastest = id;
 			blake3->set_fastest(id);
 		}
 	}
+
+	/*
+	 * blake3 parallel - the fastest implementation again, with large
+	 * blocks hashed as subtrees on several threads
+	 */
+	blake3->setid(fastest);
+	cs = &chksum_stat_data[cbid++];
+	cs->init = abd_checksum_blake3_tmpl_init;
+	cs->func = abd_checksum_blake3_native;
+	cs->free = abd_checksum_blake3_tmpl_free;
+	cs->name = blake3->name;
+	cs->impl = "parallel";
+	cs->sleeps = B_TRUE;
+	chksum_benchit(cs);
 	blake3->setid(id_save);
 }
 
+int
+chksum_sha2_mb_min(int algotype)
+{
+	if (algotype == SHA256)
+		return (chksum_sha256_mb_min);
+	return (chksum_sha512_mb_min);
+}
+
 void
 chksum_init(void)
 {
 #ifdef _KERNEL
 	blake3_per_cpu_ctx_init();
 #endif
+	abd_checksum_blake3_init();
 
 	/* Benchmark supported implementations */
 	chksum_benchmark();
@@ -373,6 +525,7 @@ chksum_fini(void)
 		chksum_stat_data = 0;
 	}
 
+	abd_checksum_blake3_fini();
 #ifdef _KERNEL
 	blake3_per_cpu_ctx_fini();
 #endif
@@ -37,6 +37,8 @@ const zfs_impl_t *impl_ops[] = {
 	&zfs_blake3_ops,
 	&zfs_sha256_ops,
 	&zfs_sha512_ops,
+	&zfs_sha256_mb_ops,
+	&zfs_sha512_mb_ops,
 	NULL
 };
 
@@ -4647,7 +4647,11 @@ zfs_check_settable(const char *dsname, nvpair_t *pair, cred_t *cr)
 					return (err);
 
 				if (!spa_feature_is_enabled(spa,
-				    SPA_FEATURE_ZSTD_COMPRESS)) {
+				    SPA_FEATURE_ZSTD_COMPRESS) ||
+				    (ZIO_COMPRESS_LEVEL(intval) ==
+				    ZIO_ZSTD_LEVEL_AUTO &&
+				    !spa_feature_is_enabled(spa,
+				    SPA_FEATURE_COMPRESS_AUTO))) {
 					spa_close(spa, FTAG);
 					return (SET_ERROR(ENOTSUP));
 				}
@@ -51,6 +51,8 @@
 #include <sys/trace_zfs.h>
 #include <sys/abd.h>
 #include <sys/dsl_crypt.h>
+#include <sys/qat.h>
+#include <sys/zio_offload.h>
 #include <cityhash.h>
 
 /*
@@ -69,6 +71,36 @@ const char *const zio_type_name[ZIO_TYPES] = {
 int zio_dva_throttle_enabled = B_TRUE;
 static int zio_deadman_log_all = B_FALSE;
 
+/*
+ * Checksum encrypted blocks as their ciphertext is produced, instead of in a
+ * separate pass once encryption is done (see zio_encrypt()).
+ */
+static int zio_encrypt_fused_checksum = B_TRUE;
+
+/*
+ * Hash the SHA256 and SHA512 checksums of writes that reach the checksum
+ * stage at the same time side by side, with the multi-buffer implementations
+ * (see zio_checksum_generate_batch()).
+ */
+static int zio_checksum_batch = B_TRUE;
+
+/*
+ * Writes waiting for their checksum while another thread is hashing.  There
+ * is one batch per multi-buffer capable checksum, SHA256 and SHA512.
+ */
+#define	ZIO_CKSUM_BATCH_MAX	ZIO_CHECKSUM_MULTI_MAX
+
+typedef struct zio_cksum_batch {
+	kmutex_t	zcb_lock;
+	boolean_t	zcb_busy;
+	enum zio_checksum zcb_checksum;
+	taskq_ent_t	zcb_ent;	/* to hand the next round over */
+	int		zcb_count;
+	zio_t		*zcb_queue[ZIO_CKSUM_BATCH_MAX];
+} zio_cksum_batch_t;
+
+static zio_cksum_batch_t zio_cksum_batch[2];
+
 /*
  * ==========================================================================
  * I/O kmem caches
@@ -238,9 +270,19 @@ zio_init(void)
 			zio_data_buf_cache[c - 1] = zio_data_buf_cache[c];
 	}
 
+	for (c = 0; c < ARRAY_SIZE(zio_cksum_batch); c++) {
+		mutex_init(&zio_cksum_batch[c].zcb_lock, NULL, MUTEX_DEFAULT,
+		    NULL);
+		zio_cksum_batch[c].zcb_checksum =
+		    (c == 0) ? ZIO_CHECKSUM_SHA256 : ZIO_CHECKSUM_SHA512;
+		taskq_init_ent(&zio_cksum_batch[c].zcb_ent);
+	}
+
 	zio_inject_init();
 
 	lz4_init();
+	zio_compress_init();
+	zio_offload_init();
 }
 
 void
@@ -248,6 +290,8 @@ zio_fini(void)
 {
 	size_t n = SPA_MAXBLOCKSIZE >> SPA_MINBLOCKSHIFT;
 
+	zio_offload_fini();
+
 #if defined(ZFS_DEBUG) && !defined(_KERNEL)
 	for (size_t i = 0; i < n; i++) {
 		if (zio_buf_cache_allocs[i] != zio_buf_cache_frees[i])
@@ -295,8 +339,14 @@ zio_fini(void)
 	kmem_cache_destroy(zio_link_cache);
 	kmem_cache_destroy(zio_cache);
 
+	for (size_t i = 0; i < ARRAY_SIZE(zio_cksum_batch); i++) {
+		ASSERT0(zio_cksum_batch[i].zcb_count);
+		mutex_destroy(&zio_cksum_batch[i].zcb_lock);
+	}
+
 	zio_inject_fini();
 
+	zio_compress_fini();
 	lz4_fini();
 }
 
@@ -550,7 +600,7 @@ zio_decrypt(zio_t *zio, abd_t *data, uint64_t size)
 
 	ret = spa_do_crypt_abd(B_FALSE, spa, &zio->io_bookmark, BP_GET_TYPE(bp),
 	    BP_GET_DEDUP(bp), BP_SHOULD_BYTESWAP(bp), salt, iv, mac, size, data,
-	    zio->io_abd, &no_crypt);
+	    zio->io_abd, &no_crypt, NULL);
 	if (no_crypt)
 		abd_copy(data, zio->io_abd, size);
 
@@ -924,6 +974,7 @@ zio_create(zio_t *pio, spa_t *spa, uint64_t txg, const blkptr_t *bp,
 void
 zio_destroy(zio_t *zio)
 {
+	ASSERT3P(zio->io_offload, ==, NULL);
 	metaslab_trace_fini(&zio->io_alloc_list);
 	list_destroy(&zio->io_parent_list);
 	list_destroy(&zio->io_child_list);
@@ -1211,6 +1262,7 @@ zio_write(zio_t *pio, spa_t *spa, uint64_t txg, blkptr_t *bp,
 	zio->io_ready = ready;
 	zio->io_children_ready = children_ready;
 	zio->io_prop = *zp;
+	zio->io_complevel = zp->zp_complevel;
 
 	/*
 	 * Data can be NULL if we are going to call zio_write_override() to
@@ -1609,6 +1661,41 @@ zio_roundup_alloc_size(spa_t *spa, uint64_t size)
 	return (spa->spa_min_alloc);
 }
 
+/*
+ * ==========================================================================
+ * Offload pipeline work to accelerators, see zio_offload.h
+ * ==========================================================================
+ */
+static void
+zio_offload_resume(zio_offload_req_t *zor)
+{
+	zio_taskq_dispatch(zor->zor_zio, ZIO_TASKQ_ISSUE, B_FALSE);
+}
+
+/*
+ * Submit a request for the work of the current stage, which the stage must
+ * return NULL after.  The stage is repeated once the request completes, and
+ * collects it with zio_offload_take().
+ */
+static void
+zio_offload_start(zio_t *zio, zio_offload_req_t *zor)
+{
+	ASSERT3P(zio->io_offload, ==, NULL);
+
+	zio->io_offload = zor;
+	zio->io_stage >>= 1;
+	zio_offload_submit(zor, zio_offload_resume);
+}
+
+static zio_offload_req_t *
+zio_offload_take(zio_t *zio)
+{
+	zio_offload_req_t *zor = zio->io_offload;
+
+	zio->io_offload = NULL;
+	return (zor);
+}
+
 /*
  * ==========================================================================
  * Prepare to read and write logical blocks
@@ -1729,6 +1816,7 @@ zio_write_compress(zio_t *zio)
 	uint64_t lsize = zio->io_lsize;
 	uint64_t psize = zio->io_size;
 	uint32_t pass = 1;
+	zio_offload_req_t *zor;
 
 	/*
 	 * If our children haven't all reached the ready stage,
@@ -1742,11 +1830,15 @@ zio_write_compress(zio_t *zio)
 	if (!IO_IS_ALLOCATING(zio))
 		return (zio);
 
-	if (zio->io_children_ready != NULL) {
+	/* The compression offloaded when this stage last ran, if any */
+	zor = zio_offload_take(zio);
+
+	if (zio->io_children_ready != NULL && zor == NULL) {
 		/*
 		 * Now that all our children are ready, run the callback
 		 * associated with this zio in case it wants to modify the
-		 * data to be written.
+		 * data to be written.  (Unless this stage is being repeated
+		 * after offloading the compression, when it already has.)
 		 */
 		ASSERT3U(zp->zp_level, >, 0);
 		zio->io_children_ready(zio);
@@ -1780,12 +1872,57 @@ zio_write_compress(zio_t *zio)
 		    == BP_GET_NDVAS(bp));
 	}
 
+	/*
+	 * Don't leak an offloaded compression whose result this run of the
+	 * stage has no use for.
+	 */
+	if (zor != NULL && (compress == ZIO_COMPRESS_OFF ||
+	    (zio->io_flags & ZIO_FLAG_RAW_COMPRESS))) {
+		zio_offload_req_free(zor);
+		zor = NULL;
+	}
+
 	/* If it's a compressed write that is not raw, compress the buffer. */
 	if (compress != ZIO_COMPRESS_OFF &&
 	    !(zio->io_flags & ZIO_FLAG_RAW_COMPRESS)) {
 		void *cbuf = NULL;
-		psize = zio_compress_data(compress, zio->io_abd, &cbuf, lsize,
-		    zp->zp_complevel);
+		if (compress == ZIO_COMPRESS_ZSTD &&
+		    zp->zp_complevel == ZIO_ZSTD_LEVEL_AUTO) {
+			/*
+			 * compression=auto picks the algorithm and level for
+			 * this block.  The level goes in io_complevel so that
+			 * the ARC header carries the real one, while io_prop
+			 * keeps asking for auto if the zio is reexecuted.
+			 */
+			ASSERT3P(zor, ==, NULL);
+			psize = zio_compress_auto(spa, zio->io_abd, &cbuf,
+			    lsize, zp->zp_dedup || zp->zp_nopwrite,
+			    zp->zp_incompressible, zio->io_bookmark.zb_blkid,
+			    &compress, &zio->io_complevel);
+		} else if (zor != NULL) {
+			ASSERT3U(zor->zor_op, ==, ZIO_OFFLOAD_COMPRESS);
+			if (zor->zor_error == 0) {
+				psize = zor->zor_psize;
+				if (psize != 0 && psize < lsize) {
+					cbuf = zor->zor_dst;
+					zor->zor_dst = NULL;
+				}
+			} else {
+				psize = zio_compress_data(compress,
+				    zio->io_abd, &cbuf, lsize,
+				    zp->zp_complevel);
+			}
+			zio_offload_req_free(zor);
+		} else if ((zor = zio_offload_req_alloc(zio,
+		    ZIO_OFFLOAD_COMPRESS, compress, zio->io_abd,
+		    lsize)) != NULL) {
+			zor->zor_level = zp->zp_complevel;
+			zio_offload_start(zio, zor);
+			return (NULL);
+		} else {
+			psize = zio_compress_data(compress, zio->io_abd, &cbuf,
+			    lsize, zp->zp_complevel);
+		}
 		if (psize == 0) {
 			compress = ZIO_COMPRESS_OFF;
 		} else if (psize >= lsize) {
@@ -1958,6 +2095,7 @@ zio_taskq_dispatch(zio_t *zio, zio_taskq_type_t q, boolean_t cutinline)
 	spa_t *spa = zio->io_spa;
 	zio_type_t t = zio->io_type;
 	int flags = (cutinline ? TQ_FRONT : 0);
+	int node = -1;
 
 	/*
 	 * If we're a config writer or a probe, the normal issue and
@@ -1984,6 +2122,14 @@ zio_taskq_dispatch(zio_t *zio, zio_taskq_type_t q, boolean_t cutinline)
 
 	ASSERT3U(q, <, ZIO_TASKQ_TYPES);
 
+	/*
+	 * With per-node taskqs, run the next stages (checksum, transforms and
+	 * completion) on the node holding the data rather than pulling it
+	 * across the interconnect.
+	 */
+	if (spa->spa_zio_taskq[t][q].stqs_nodes > 1 && zio->io_abd != NULL)
+		node = abd_get_node(zio->io_abd);
+
 	/*
 	 * NB: We are assuming that the zio can only be dispatched
 	 * to a single taskq at a time.  It would be a grievous error
@@ -1991,7 +2137,7 @@ zio_taskq_dispatch(zio_t *zio, zio_taskq_type_t q, boolean_t cutinline)
 	 */
 	ASSERT(taskq_empty_ent(&zio->io_tqent));
 	spa_taskq_dispatch_ent(spa, t, q, zio_execute, zio, flags,
-	    &zio->io_tqent);
+	    &zio->io_tqent, node);
 }
 
 static boolean_t
@@ -2407,6 +2553,7 @@ zio_reexecute(void *arg)
 	pio->io_stage = pio->io_orig_stage;
 	pio->io_pipeline = pio->io_orig_pipeline;
 	pio->io_reexecute = 0;
+	pio->io_complevel = pio->io_prop.zp_complevel;
 	pio->io_flags |= ZIO_FLAG_REEXECUTED;
 	pio->io_pipeline_trace = 0;
 	pio->io_error = 0;
@@ -4217,6 +4364,8 @@ zio_encrypt(zio_t *zio)
 	uint8_t iv[ZIO_DATA_IV_LEN];
 	uint8_t mac[ZIO_DATA_MAC_LEN];
 	boolean_t no_crypt = B_FALSE;
+	zio_cksum_stream_t zcs;
+	zio_crypt_sink_t sink, *sinkp = NULL;
 
 	/* the root zio already encrypted the data */
 	if (zio->io_child_type == ZIO_CHILD_GANG)
@@ -4319,10 +4468,28 @@ zio_encrypt(zio_t *zio)
 		BP_SET_CRYPT(bp, B_TRUE);
 	}
 
+	/*
+	 * Rather than leave the checksum to the next stage, which would read
+	 * the whole block back in, compute it from the ciphertext in pieces
+	 * as the encryption writes it, while it is still in cache. This only
+	 * works when the ciphertext is the whole block, so not for ZIL blocks
+	 * (which need the MAC embedded first) or dnode blocks (which may not
+	 * be encrypted at all). If the cipher could not feed us everything,
+	 * the checksum stage is left in place to do it the usual way.
+	 */
+	if (zio_encrypt_fused_checksum && ot != DMU_OT_INTENT_LOG &&
+	    ot != DMU_OT_DNODE &&
+	    (zio->io_pipeline & ZIO_STAGE_CHECKSUM_GENERATE) &&
+	    zio_checksum_stream_init(&zcs, spa, BP_GET_CHECKSUM(bp))) {
+		sink.zsk_func = zio_checksum_stream_update;
+		sink.zsk_arg = &zcs;
+		sinkp = &sink;
+	}
+
 	/* Perform the encryption. This should not fail */
 	VERIFY0(spa_do_crypt_abd(B_TRUE, spa, &zio->io_bookmark,
 	    BP_GET_TYPE(bp), BP_GET_DEDUP(bp), BP_SHOULD_BYTESWAP(bp),
-	    salt, iv, mac, psize, zio->io_abd, eabd, &no_crypt));
+	    salt, iv, mac, psize, zio->io_abd, eabd, &no_crypt, sinkp));
 
 	/* encode encryption metadata into the bp */
 	if (ot == DMU_OT_INTENT_LOG) {
@@ -4345,6 +4512,12 @@ zio_encrypt(zio_t *zio)
 		}
 	}
 
+	if (sinkp != NULL) {
+		ASSERT3U(zio->io_size, ==, psize);
+		if (zio_checksum_stream_done(zio, &zcs))
+			zio->io_pipeline &= ~ZIO_STAGE_CHECKSUM_GENERATE;
+	}
+
 	return (zio);
 }
 
@@ -4353,6 +4526,111 @@ zio_encrypt(zio_t *zio)
  * Generate and verify checksums
  * ==========================================================================
  */
+static boolean_t
+zio_checksum_batchable(zio_t *zio, enum zio_checksum checksum)
+{
+	if (!zio_checksum_batch || !abd_is_linear(zio->io_abd))
+		return (B_FALSE);
+
+	if (checksum != ZIO_CHECKSUM_SHA256 && checksum != ZIO_CHECKSUM_SHA512)
+		return (B_FALSE);
+
+	/* Leave the blocks QAT would take to it, see abd_checksum_sha256() */
+	if (checksum == ZIO_CHECKSUM_SHA256 &&
+	    qat_checksum_use_accel(zio->io_size))
+		return (B_FALSE);
+
+	return (zio_checksum_multi_lanes(checksum) > 1);
+}
+
+static boolean_t
+zio_checksum_offloadable(enum zio_checksum checksum)
+{
+	if (checksum == ZIO_CHECKSUM_OFF || checksum == ZIO_CHECKSUM_NOPARITY)
+		return (B_FALSE);
+
+	return (!(zio_checksum_table[checksum].ci_flags &
+	    ZCHECKSUM_FLAG_EMBEDDED));
+}
+
+/*
+ * Hash one round of the writes queued on a batch, and send them on to the
+ * issue taskq.  If more writes queued up meanwhile, the next round is handed
+ * to a thread of the issue taskq rather than run here, so that the thread
+ * doing a round, and the write it may be holding up, only ever wait for one
+ * round of at most ZIO_CKSUM_BATCH_MAX blocks.
+ */
+static void
+zio_checksum_batch_round(void *arg)
+{
+	zio_cksum_batch_t *zcb = arg;
+	zio_t *work[ZIO_CKSUM_BATCH_MAX];
+	spa_t *spa;
+	int n;
+
+	mutex_enter(&zcb->zcb_lock);
+	ASSERT(zcb->zcb_busy);
+	n = zcb->zcb_count;
+	memcpy(work, zcb->zcb_queue, n * sizeof (zio_t *));
+	zcb->zcb_count = 0;
+	mutex_exit(&zcb->zcb_lock);
+
+	if (n != 0) {
+		zio_checksum_compute_multi(work, n, zcb->zcb_checksum);
+		for (int i = 0; i < n; i++)
+			zio_taskq_dispatch(work[i], ZIO_TASKQ_ISSUE, B_FALSE);
+	}
+
+	mutex_enter(&zcb->zcb_lock);
+	if (zcb->zcb_count == 0) {
+		zcb->zcb_busy = B_FALSE;
+		mutex_exit(&zcb->zcb_lock);
+		return;
+	}
+	/* Only a round takes writes off the queue, so this one stays put */
+	spa = zcb->zcb_queue[0]->io_spa;
+	mutex_exit(&zcb->zcb_lock);
+
+	spa_taskq_dispatch_ent(spa, ZIO_TYPE_WRITE, ZIO_TASKQ_ISSUE,
+	    zio_checksum_batch_round, zcb, 0, &zcb->zcb_ent, -1);
+}
+
+/*
+ * Multi-buffer SHA2 only pays off with several blocks to hash at once, so
+ * writes are batched here.  The first thread to get here hashes its own
+ * block the usual way; writes arriving in the meantime queue up behind it,
+ * and when it's done it hashes what queued in one go and sends those writes
+ * on to the issue taskq (see zio_checksum_batch_round()).  A write thus
+ * waits for at most the hash in progress and one round after it.
+ */
+static zio_t *
+zio_checksum_generate_batch(zio_t *zio, enum zio_checksum checksum)
+{
+	zio_cksum_batch_t *zcb =
+	    &zio_cksum_batch[checksum == ZIO_CHECKSUM_SHA256 ? 0 : 1];
+
+	ASSERT3U(zcb->zcb_checksum, ==, checksum);
+
+	mutex_enter(&zcb->zcb_lock);
+	if (zcb->zcb_busy) {
+		if (zcb->zcb_count < ZIO_CKSUM_BATCH_MAX) {
+			zcb->zcb_queue[zcb->zcb_count++] = zio;
+			mutex_exit(&zcb->zcb_lock);
+			return (NULL);
+		}
+		mutex_exit(&zcb->zcb_lock);
+		zio_checksum_compute(zio, checksum, zio->io_abd, zio->io_size);
+		return (zio);
+	}
+	zcb->zcb_busy = B_TRUE;
+	mutex_exit(&zcb->zcb_lock);
+
+	zio_checksum_compute(zio, checksum, zio->io_abd, zio->io_size);
+	zio_checksum_batch_round(zcb);
+
+	return (zio);
+}
+
 static zio_t *
 zio_checksum_generate(zio_t *zio)
 {
@@ -4379,6 +4657,30 @@ zio_checksum_generate(zio_t *zio)
 		}
 	}
 
+	if (bp != NULL && zio_checksum_offloadable(checksum)) {
+		zio_offload_req_t *zor;
+
+		if ((zor = zio_offload_take(zio)) != NULL) {
+			int error = zor->zor_error;
+			zio_cksum_t cksum = zor->zor_cksum;
+
+			ASSERT3U(zor->zor_op, ==, ZIO_OFFLOAD_CHECKSUM);
+			zio_offload_req_free(zor);
+			if (error == 0) {
+				zio_checksum_apply(zio, checksum, &cksum);
+				return (zio);
+			}
+		} else if ((zor = zio_offload_req_alloc(zio,
+		    ZIO_OFFLOAD_CHECKSUM, checksum, zio->io_abd,
+		    zio->io_size)) != NULL) {
+			zio_offload_start(zio, zor);
+			return (NULL);
+		}
+	}
+
+	if (bp != NULL && zio_checksum_batchable(zio, checksum))
+		return (zio_checksum_generate_batch(zio, checksum));
+
 	zio_checksum_compute(zio, checksum, zio->io_abd, zio->io_size);
 
 	return (zio);
@@ -4429,6 +4731,16 @@ zio_checksum_verified(zio_t *zio)
 	zio->io_pipeline &= ~ZIO_STAGE_CHECKSUM_VERIFY;
 }
 
+/*
+ * Called by mirrors splitting a read, to verify the block only if this zio
+ * would have, rather than once more after whichever zio does.
+ */
+boolean_t
+zio_checksum_pending(zio_t *zio)
+{
+	return ((zio->io_pipeline & ZIO_STAGE_CHECKSUM_VERIFY) != 0);
+}
+
 /*
  * ==========================================================================
  * Error rank.  Error are ranked in the order 0, ENXIO, ECKSUM, EIO, other.
@@ -4906,7 +5218,7 @@ zio_done(zio_t *zio)
 			ASSERT(taskq_empty_ent(&zio->io_tqent));
 			spa_taskq_dispatch_ent(zio->io_spa,
 			    ZIO_TYPE_CLAIM, ZIO_TASKQ_ISSUE,
-			    zio_reexecute, zio, 0, &zio->io_tqent);
+			    zio_reexecute, zio, 0, &zio->io_tqent, -1);
 		}
 		return (NULL);
 	}
@@ -5167,3 +5479,9 @@ ZFS_MODULE_PARAM(zfs_zio, zio_, dva_throttle_enabled, INT, ZMOD_RW,
 
 ZFS_MODULE_PARAM(zfs_zio, zio_, deadman_log_all, INT, ZMOD_RW,
 	"Log all slow ZIOs, not just those with vdevs");
+
+ZFS_MODULE_PARAM(zfs_zio, zio_, encrypt_fused_checksum, INT, ZMOD_RW,
+	"Checksum encrypted blocks while encrypting them");
+
+ZFS_MODULE_PARAM(zfs_zio, zio_, checksum_batch, INT, ZMOD_RW,
+	"Hash SHA256/SHA512 checksums of concurrent writes side by side");
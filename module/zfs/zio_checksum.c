@@ -31,6 +31,7 @@
 #include <sys/zio_checksum.h>
 #include <sys/zil.h>
 #include <sys/abd.h>
+#include <sys/blake3.h>
 #include <zfs_fletcher.h>
 
 /*
@@ -399,15 +400,191 @@ zio_checksum_compute(zio_t *zio, enum zio_checksum checksum,
 		    eck_offset + offsetof(zio_eck_t, zec_cksum),
 		    sizeof (zio_cksum_t));
 	} else {
-		saved = bp->blk_cksum;
 		ci->ci_func[0](abd, size, spa->spa_cksum_tmpls[checksum],
 		    &cksum);
-		if (BP_USES_CRYPT(bp) && BP_GET_TYPE(bp) != DMU_OT_OBJSET)
-			zio_checksum_handle_crypt(&cksum, &saved, insecure);
-		bp->blk_cksum = cksum;
+		zio_checksum_apply(zio, checksum, &cksum);
 	}
 }
 
+/*
+ * Run the checksum function over a block and return its result as is, for
+ * zio_checksum_apply() to turn into the block pointer's checksum.  Only
+ * checksums that aren't embedded in the block are supported.
+ */
+void
+zio_checksum_compute_raw(spa_t *spa, enum zio_checksum checksum,
+    abd_t *abd, uint64_t size, zio_cksum_t *zcp)
+{
+	zio_checksum_info_t *ci = &zio_checksum_table[checksum];
+
+	ASSERT((uint_t)checksum < ZIO_CHECKSUM_FUNCTIONS);
+	ASSERT0(ci->ci_flags & ZCHECKSUM_FLAG_EMBEDDED);
+	ASSERT(ci->ci_func[0] != NULL);
+
+	zio_checksum_template_init(checksum, spa);
+	ci->ci_func[0](abd, size, spa->spa_cksum_tmpls[checksum], zcp);
+}
+
+/*
+ * Store the result of the checksum function for a write in its block
+ * pointer, folding in the MAC of an encrypted block.
+ */
+void
+zio_checksum_apply(zio_t *zio, enum zio_checksum checksum, zio_cksum_t *zcp)
+{
+	zio_checksum_info_t *ci = &zio_checksum_table[checksum];
+	boolean_t insecure = (ci->ci_flags & ZCHECKSUM_FLAG_DEDUP) == 0;
+	blkptr_t *bp = zio->io_bp;
+	zio_cksum_t saved = bp->blk_cksum;
+
+	ASSERT0(ci->ci_flags & ZCHECKSUM_FLAG_EMBEDDED);
+
+	if (BP_USES_CRYPT(bp) && BP_GET_TYPE(bp) != DMU_OT_OBJSET)
+		zio_checksum_handle_crypt(zcp, &saved, insecure);
+	bp->blk_cksum = *zcp;
+}
+
+/*
+ * The number of blocks of the given checksum that
+ * zio_checksum_compute_multi() hashes side by side, 1 if it doesn't support
+ * the checksum at all.
+ */
+int
+zio_checksum_multi_lanes(enum zio_checksum checksum)
+{
+	switch (checksum) {
+	case ZIO_CHECKSUM_SHA256:
+	case ZIO_CHECKSUM_SHA512:
+		return (abd_checksum_sha2_lanes(checksum));
+	default:
+		return (1);
+	}
+}
+
+/*
+ * Generate the checksums of several blocks at once, with the same result as
+ * zio_checksum_compute() for each of the zios.  The blocks must be in linear
+ * abds and use a checksum for which zio_checksum_multi_lanes() is above 1,
+ * and there may be at most ZIO_CHECKSUM_MULTI_MAX of them.
+ */
+void
+zio_checksum_compute_multi(zio_t *const zios[], int n,
+    enum zio_checksum checksum)
+{
+	zio_checksum_info_t *ci = &zio_checksum_table[checksum];
+	abd_t *abds[ZIO_CHECKSUM_MULTI_MAX];
+	uint64_t sizes[ZIO_CHECKSUM_MULTI_MAX];
+	zio_cksum_t cksums[ZIO_CHECKSUM_MULTI_MAX];
+
+	ASSERT0(ci->ci_flags & ZCHECKSUM_FLAG_EMBEDDED);
+	ASSERT3S(n, <=, ZIO_CHECKSUM_MULTI_MAX);
+
+	for (int i = 0; i < n; i++) {
+		ASSERT(abd_is_linear(zios[i]->io_abd));
+		abds[i] = zios[i]->io_abd;
+		sizes[i] = zios[i]->io_size;
+	}
+
+	abd_checksum_sha2_multi(checksum, n, abds, sizes, cksums);
+
+	for (int i = 0; i < n; i++)
+		zio_checksum_apply(zios[i], checksum, &cksums[i]);
+}
+
+/*
+ * Start an incremental checksum of a block's data. Only the checksums with a
+ * cheap incremental form are supported; B_FALSE is returned for the others,
+ * which must be computed with zio_checksum_compute() instead.
+ */
+boolean_t
+zio_checksum_stream_init(zio_cksum_stream_t *zcs, spa_t *spa,
+    enum zio_checksum checksum)
+{
+	zcs->zcs_checksum = checksum;
+	zcs->zcs_size = 0;
+	zcs->zcs_blake3 = NULL;
+
+	switch (checksum) {
+	case ZIO_CHECKSUM_FLETCHER_4:
+		ZIO_SET_CHECKSUM(&zcs->zcs_fletcher, 0, 0, 0, 0);
+		return (B_TRUE);
+	case ZIO_CHECKSUM_BLAKE3:
+		zio_checksum_template_init(checksum, spa);
+		zcs->zcs_blake3 = kmem_alloc(sizeof (BLAKE3_CTX), KM_SLEEP);
+		memcpy(zcs->zcs_blake3, spa->spa_cksum_tmpls[checksum],
+		    sizeof (BLAKE3_CTX));
+		return (B_TRUE);
+	default:
+		return (B_FALSE);
+	}
+}
+
+/*
+ * Feed the next piece of the block's data to the checksum. The arguments
+ * match zio_crypt_sink_t so this can be used as one directly.
+ */
+void
+zio_checksum_stream_update(void *arg, const uint8_t *buf, size_t size)
+{
+	zio_cksum_stream_t *zcs = arg;
+
+	if (zcs->zcs_checksum == ZIO_CHECKSUM_FLETCHER_4) {
+		ASSERT(IS_P2ALIGNED(size, sizeof (uint32_t)));
+		(void) fletcher_4_incremental_native((void *)buf, size,
+		    &zcs->zcs_fletcher);
+	} else {
+		ASSERT3U(zcs->zcs_checksum, ==, ZIO_CHECKSUM_BLAKE3);
+		Blake3_Update(zcs->zcs_blake3, buf, size);
+	}
+	zcs->zcs_size += size;
+}
+
+void
+zio_checksum_stream_abort(zio_cksum_stream_t *zcs)
+{
+	if (zcs->zcs_blake3 != NULL) {
+		memset(zcs->zcs_blake3, 0, sizeof (BLAKE3_CTX));
+		kmem_free(zcs->zcs_blake3, sizeof (BLAKE3_CTX));
+		zcs->zcs_blake3 = NULL;
+	}
+}
+
+/*
+ * Finish the checksum and store it in the bp, exactly as
+ * zio_checksum_compute() would have for the zio's data. If the stream did
+ * not see all of that data, the bp is left alone and B_FALSE is returned.
+ * Either way the stream is released.
+ */
+boolean_t
+zio_checksum_stream_done(zio_t *zio, zio_cksum_stream_t *zcs)
+{
+	zio_checksum_info_t *ci = &zio_checksum_table[zcs->zcs_checksum];
+	blkptr_t *bp = zio->io_bp;
+	zio_cksum_t cksum, saved;
+
+	ASSERT0(ci->ci_flags & ZCHECKSUM_FLAG_EMBEDDED);
+
+	if (zcs->zcs_size != zio->io_size) {
+		zio_checksum_stream_abort(zcs);
+		return (B_FALSE);
+	}
+
+	if (zcs->zcs_checksum == ZIO_CHECKSUM_FLETCHER_4)
+		cksum = zcs->zcs_fletcher;
+	else
+		Blake3_Final(zcs->zcs_blake3, (uint8_t *)&cksum);
+	zio_checksum_stream_abort(zcs);
+
+	saved = bp->blk_cksum;
+	if (BP_USES_CRYPT(bp) && BP_GET_TYPE(bp) != DMU_OT_OBJSET) {
+		zio_checksum_handle_crypt(&cksum, &saved,
+		    (ci->ci_flags & ZCHECKSUM_FLAG_DEDUP) == 0);
+	}
+	bp->blk_cksum = cksum;
+
+	return (B_TRUE);
+}
+
 int
 zio_checksum_error_impl(spa_t *spa, const blkptr_t *bp,
     enum zio_checksum checksum, abd_t *abd, uint64_t size, uint64_t offset,
@@ -50,24 +50,25 @@ static unsigned long zio_decompress_fail_fraction = 0;
  * Compression vectors.
  */
 zio_compress_info_t zio_compress_table[ZIO_COMPRESS_FUNCTIONS] = {
-	{"inherit",	0,	NULL,		NULL, NULL},
-	{"on",		0,	NULL,		NULL, NULL},
-	{"uncompressed", 0,	NULL,		NULL, NULL},
-	{"lzjb",	0,	lzjb_compress,	lzjb_decompress, NULL},
-	{"empty",	0,	NULL,		NULL, NULL},
-	{"gzip-1",	1,	gzip_compress,	gzip_decompress, NULL},
-	{"gzip-2",	2,	gzip_compress,	gzip_decompress, NULL},
-	{"gzip-3",	3,	gzip_compress,	gzip_decompress, NULL},
-	{"gzip-4",	4,	gzip_compress,	gzip_decompress, NULL},
-	{"gzip-5",	5,	gzip_compress,	gzip_decompress, NULL},
-	{"gzip-6",	6,	gzip_compress,	gzip_decompress, NULL},
-	{"gzip-7",	7,	gzip_compress,	gzip_decompress, NULL},
-	{"gzip-8",	8,	gzip_compress,	gzip_decompress, NULL},
-	{"gzip-9",	9,	gzip_compress,	gzip_decompress, NULL},
-	{"zle",		64,	zle_compress,	zle_decompress, NULL},
-	{"lz4",		0,	lz4_compress_zfs, lz4_decompress_zfs, NULL},
+	{"inherit",	0,	NULL,		NULL, NULL, NULL},
+	{"on",		0,	NULL,		NULL, NULL, NULL},
+	{"uncompressed", 0,	NULL,		NULL, NULL, NULL},
+	{"lzjb",	0,	lzjb_compress,	lzjb_decompress, NULL, NULL},
+	{"empty",	0,	NULL,		NULL, NULL, NULL},
+	{"gzip-1",	1,	gzip_compress,	gzip_decompress, NULL, NULL},
+	{"gzip-2",	2,	gzip_compress,	gzip_decompress, NULL, NULL},
+	{"gzip-3",	3,	gzip_compress,	gzip_decompress, NULL, NULL},
+	{"gzip-4",	4,	gzip_compress,	gzip_decompress, NULL, NULL},
+	{"gzip-5",	5,	gzip_compress,	gzip_decompress, NULL, NULL},
+	{"gzip-6",	6,	gzip_compress,	gzip_decompress, NULL, NULL},
+	{"gzip-7",	7,	gzip_compress,	gzip_decompress, NULL, NULL},
+	{"gzip-8",	8,	gzip_compress,	gzip_decompress, NULL, NULL},
+	{"gzip-9",	9,	gzip_compress,	gzip_decompress, NULL, NULL},
+	{"zle",		64,	zle_compress,	zle_decompress, NULL, NULL},
+	{"lz4",		0,	lz4_compress_zfs, lz4_decompress_zfs, NULL, NULL},
 	{"zstd",	ZIO_ZSTD_LEVEL_DEFAULT,	zfs_zstd_compress_wrap,
-	    zfs_zstd_decompress, zfs_zstd_decompress_level},
+	    zfs_zstd_decompress, zfs_zstd_decompress_level,
+	    zfs_zstd_decompress_level_abd},
 };
 
 uint8_t
@@ -111,15 +112,27 @@ zio_compress_select(spa_t *spa, enum zio_compress child,
 	return (result);
 }
 
+/*
+ * The words are tested a cache line at a time with a single branch, which
+ * the compiler can vectorize where it may use SIMD registers.
+ */
 static int
 zio_compress_zeroed_cb(void *data, size_t len, void *private)
 {
 	(void) private;
 
-	uint64_t *end = (uint64_t *)((char *)data + len);
-	for (uint64_t *word = (uint64_t *)data; word < end; word++)
-		if (*word != 0)
+	const uint64_t *p = data;
+	const uint64_t *end = p + len / sizeof (uint64_t);
+
+	for (; p + 8 <= end; p += 8) {
+		if ((p[0] | p[1] | p[2] | p[3] |
+		    p[4] | p[5] | p[6] | p[7]) != 0)
 			return (1);
+	}
+	for (; p < end; p++) {
+		if (*p != 0)
+			return (1);
+	}
 
 	return (0);
 }
@@ -178,6 +191,390 @@ zio_compress_data(enum zio_compress c, abd_t *src, void **dst, size_t s_len,
 	return (c_len);
 }
 
+/*
+ * compression=auto is stored as zstd with the level ZIO_ZSTD_LEVEL_AUTO, and
+ * zio_compress_auto() decides for every block it writes whether to compress
+ * it at all and with what.  Each block is first compressed with LZ4, which
+ * is cheap and tells us whether the data is worth compressing; if LZ4 can't
+ * save 12.5%, zstd-1 gets the same second chance the zstd early abort gives
+ * it, and the block is stored uncompressed if that fails too.  Compressible
+ * blocks are then compressed at the current step of zio_compress_auto_steps.
+ *
+ * Compressibility is sampled per object: once ZIO_COMPRESS_AUTO_MISSES
+ * blocks of an object in a row were stored uncompressed, only every
+ * ZCA_SAMPLE'th block of it is tried, until one of those compresses again.
+ *
+ * The current step is adjusted about every ZCA_INTERVAL from the share of
+ * the CPUs the write issue threads spent compressing auto blocks.  Above
+ * zfs_compress_auto_cpu_pct they are falling behind, and we step down
+ * towards LZ4.  Below half of it we step up, as long as the next step was
+ * measured to write at least zfs_compress_auto_min_gain percent less than
+ * the current one.  Every ZCA_EXPLORE'th block is compressed one step up so
+ * that measurement stays current.
+ *
+ * A block that gets to zstd is thus compressed twice, which is the price of
+ * knowing whether zstd did better than LZ4.  When LZ4 alone already saves
+ * zfs_compress_auto_lz4_pct percent of the block, the most zstd could add is
+ * small, so LZ4's output is kept and zstd is not tried at all.
+ *
+ * Blocks that may be deduplicated or nopwritten always use the same choice
+ * for the same data, otherwise identical blocks would stop matching.
+ */
+static uint_t zfs_compress_auto_cpu_pct = 50;
+static uint_t zfs_compress_auto_min_gain = 3;
+static uint_t zfs_compress_auto_lz4_pct = 75;
+
+#define	ZCA_INTERVAL		MSEC2NSEC(100)
+#define	ZCA_EXPLORE		64
+#define	ZCA_SAMPLE		16
+#define	ZCA_STEP_LZ4		0
+#define	ZCA_STEP_DEFAULT	2
+
+static const struct {
+	enum zio_compress	zcs_compress;
+	uint8_t			zcs_level;
+} zio_compress_auto_steps[] = {
+	{ ZIO_COMPRESS_LZ4,	0 },
+	{ ZIO_COMPRESS_ZSTD,	ZIO_ZSTD_LEVEL_1 },
+	{ ZIO_COMPRESS_ZSTD,	ZIO_ZSTD_LEVEL_3 },
+	{ ZIO_COMPRESS_ZSTD,	ZIO_ZSTD_LEVEL_6 },
+	{ ZIO_COMPRESS_ZSTD,	ZIO_ZSTD_LEVEL_9 },
+};
+
+#define	ZCA_STEPS	ARRAY_SIZE(zio_compress_auto_steps)
+
+typedef struct zio_compress_auto_stats {
+	kstat_named_t	zcas_off;
+	kstat_named_t	zcas_blocks[ZCA_STEPS];
+	kstat_named_t	zcas_explored;
+	kstat_named_t	zcas_lz4_enough;
+	kstat_named_t	zcas_skipped;
+	kstat_named_t	zcas_step_up;
+	kstat_named_t	zcas_step_down;
+	kstat_named_t	zcas_cpu_pct;
+	kstat_named_t	zcas_step;
+} zio_compress_auto_stats_t;
+
+static zio_compress_auto_stats_t zio_compress_auto_stats = {
+	{ "off",		KSTAT_DATA_UINT64 },
+	{
+		{ "lz4",	KSTAT_DATA_UINT64 },
+		{ "zstd_1",	KSTAT_DATA_UINT64 },
+		{ "zstd_3",	KSTAT_DATA_UINT64 },
+		{ "zstd_6",	KSTAT_DATA_UINT64 },
+		{ "zstd_9",	KSTAT_DATA_UINT64 },
+	},
+	{ "explored",		KSTAT_DATA_UINT64 },
+	{ "lz4_enough",		KSTAT_DATA_UINT64 },
+	{ "skipped",		KSTAT_DATA_UINT64 },
+	{ "step_up",		KSTAT_DATA_UINT64 },
+	{ "step_down",		KSTAT_DATA_UINT64 },
+	{ "cpu_pct",		KSTAT_DATA_UINT64 },
+	{ "step",		KSTAT_DATA_UINT64 },
+};
+
+#define	ZCASTAT(stat)		(zio_compress_auto_stats.stat.value.ui64)
+
+static kstat_t *zio_compress_auto_ksp;
+
+/*
+ * Writers only touch the zca_cpu_t of the CPU they run on, so the per-block
+ * accounting never contends.  zcc_ratio[] holds, for each step, a moving
+ * average of its compressed size relative to LZ4's for the same block in
+ * 1/1024ths, or 0 if the step hasn't been tried on this CPU yet.
+ */
+typedef struct zca_cpu {
+	kmutex_t	zcc_lock;
+	hrtime_t	zcc_busy;
+	uint64_t	zcc_ratio[ZCA_STEPS];
+	uint64_t	zcc_explore;
+	uint64_t	zcc_off;
+	uint64_t	zcc_blocks[ZCA_STEPS];
+	uint64_t	zcc_explored;
+	uint64_t	zcc_lz4_enough;
+	uint64_t	zcc_skipped;
+} ____cacheline_aligned zca_cpu_t;
+
+static zca_cpu_t *zca_cpu;
+
+/*
+ * zca_adjust_lock serializes the controller, which folds the per-CPU state
+ * into zca_ratio[] and moves zca_step, and also serves as the kstat's lock.
+ * Writers read zca_step without it.
+ */
+static kmutex_t zca_adjust_lock;
+static uint_t zca_step = ZCA_STEP_DEFAULT;
+static uint64_t zca_ratio[ZCA_STEPS];
+static hrtime_t zca_interval_start;
+
+static void
+zio_compress_auto_adjust(hrtime_t elapsed)
+{
+	uint64_t ratio[ZCA_STEPS] = { 0 };
+	uint64_t nratio[ZCA_STEPS] = { 0 };
+	hrtime_t busy = 0;
+	uint_t step = zca_step;
+	uint64_t pct;
+
+	ASSERT(MUTEX_HELD(&zca_adjust_lock));
+
+	for (int c = 0; c < max_ncpus; c++) {
+		zca_cpu_t *zcc = &zca_cpu[c];
+
+		mutex_enter(&zcc->zcc_lock);
+		busy += zcc->zcc_busy;
+		zcc->zcc_busy = 0;
+		for (size_t i = 0; i < ZCA_STEPS; i++) {
+			if (zcc->zcc_ratio[i] != 0) {
+				ratio[i] += zcc->zcc_ratio[i];
+				nratio[i]++;
+			}
+		}
+		mutex_exit(&zcc->zcc_lock);
+	}
+	for (size_t i = ZCA_STEP_LZ4 + 1; i < ZCA_STEPS; i++)
+		zca_ratio[i] = (nratio[i] == 0) ? 0 : ratio[i] / nratio[i];
+
+	pct = busy * 100 / (MAX(elapsed, 1) * boot_ncpus);
+
+	if (pct > zfs_compress_auto_cpu_pct && step > ZCA_STEP_LZ4) {
+		step--;
+		ZCASTAT(zcas_step_down)++;
+	} else if (pct < zfs_compress_auto_cpu_pct / 2 &&
+	    step + 1 < ZCA_STEPS && (zca_ratio[step + 1] == 0 ||
+	    zca_ratio[step + 1] * 100 <=
+	    zca_ratio[step] * (100 - MIN(zfs_compress_auto_min_gain, 100)))) {
+		step++;
+		ZCASTAT(zcas_step_up)++;
+	}
+	zca_step = step;
+
+	ZCASTAT(zcas_cpu_pct) = pct;
+	ZCASTAT(zcas_step) = step;
+}
+
+/*
+ * Compress a block written with compression=auto.  Returns the compressed
+ * size, or s_len if the block should be stored uncompressed, or 0 if it is
+ * all zeroes, like zio_compress_data(), and sets *compress and *level to what
+ * it was compressed with.  "stable" asks for the same choice every time the
+ * same data is passed in.  "incompressible" says the object's recent blocks
+ * didn't compress, and "blkid" is this block's position in the object.
+ */
+size_t
+zio_compress_auto(spa_t *spa, abd_t *src, void **dst, size_t s_len,
+    boolean_t stable, boolean_t incompressible, uint64_t blkid,
+    enum zio_compress *compress, uint8_t *level)
+{
+	boolean_t lz4_ok = spa_feature_is_active(spa, SPA_FEATURE_LZ4_COMPRESS);
+	boolean_t explored = B_FALSE;
+	boolean_t lz4_enough = B_FALSE;
+	hrtime_t start, now, interval_start;
+	size_t d_len, lz4_len, c_len;
+	zca_cpu_t *zcc;
+	uint_t step;
+	void *tmp;
+
+	if (abd_iterate_func(src, 0, s_len, zio_compress_zeroed_cb, NULL) == 0)
+		return (0);
+
+	if (incompressible && !stable && blkid % ZCA_SAMPLE != 0) {
+		zcc = &zca_cpu[CPU_SEQID_UNSTABLE];
+		mutex_enter(&zcc->zcc_lock);
+		zcc->zcc_skipped++;
+		mutex_exit(&zcc->zcc_lock);
+		return (s_len);
+	}
+
+	/* Compress at least 12.5% */
+	d_len = s_len - (s_len >> 3);
+
+	if (*dst == NULL)
+		*dst = zio_buf_alloc(s_len);
+
+	start = gethrtime();
+	tmp = abd_borrow_buf_copy(src, s_len);
+
+	lz4_len = lz4_compress_zfs(tmp, *dst, s_len, d_len, 0);
+	if (lz4_len > d_len) {
+		c_len = zfs_zstd_compress(tmp, *dst, s_len, d_len,
+		    ZIO_ZSTD_LEVEL_1);
+		if (c_len == 0 || c_len > d_len) {
+			c_len = s_len;
+			step = ZCA_STEPS;
+		} else {
+			step = 1;
+		}
+	} else if (lz4_ok && (s_len - lz4_len) * 100 >=
+	    s_len * MIN(zfs_compress_auto_lz4_pct, 100)) {
+		c_len = lz4_len;
+		step = ZCA_STEP_LZ4;
+		lz4_enough = B_TRUE;
+	} else {
+		step = stable ? ZCA_STEP_DEFAULT : zca_step;
+		if (!stable && step + 1 < ZCA_STEPS &&
+		    atomic_inc_64_nv(&zca_cpu[CPU_SEQID_UNSTABLE].zcc_explore) %
+		    ZCA_EXPLORE == 0) {
+			explored = B_TRUE;
+			step++;
+		}
+
+		if (step == ZCA_STEP_LZ4 && !lz4_ok)
+			step++;
+
+		c_len = lz4_len;
+		if (step != ZCA_STEP_LZ4) {
+			void *zbuf = zio_buf_alloc(s_len);
+			size_t z_len = zfs_zstd_compress(tmp, zbuf, s_len,
+			    MIN(lz4_len, d_len),
+			    zio_compress_auto_steps[step].zcs_level);
+
+			if (z_len != 0 && z_len < lz4_len) {
+				zio_buf_free(*dst, s_len);
+				*dst = zbuf;
+				c_len = z_len;
+			} else {
+				zio_buf_free(zbuf, s_len);
+				if (lz4_ok) {
+					step = ZCA_STEP_LZ4;
+				} else {
+					c_len = s_len;
+					step = ZCA_STEPS;
+				}
+			}
+		}
+	}
+
+	abd_return_buf(src, tmp, s_len);
+	now = gethrtime();
+
+	zcc = &zca_cpu[CPU_SEQID_UNSTABLE];
+	mutex_enter(&zcc->zcc_lock);
+	zcc->zcc_busy += now - start;
+	if (step == ZCA_STEPS) {
+		zcc->zcc_off++;
+	} else {
+		uint64_t ratio = c_len * 1024 / MAX(lz4_len, 1);
+
+		if (lz4_len <= d_len && step != ZCA_STEP_LZ4) {
+			zcc->zcc_ratio[step] = (zcc->zcc_ratio[step] == 0) ?
+			    ratio : (zcc->zcc_ratio[step] * 7 + ratio) / 8;
+		}
+		zcc->zcc_blocks[step]++;
+		if (explored)
+			zcc->zcc_explored++;
+		if (lz4_enough)
+			zcc->zcc_lz4_enough++;
+	}
+	mutex_exit(&zcc->zcc_lock);
+
+	/*
+	 * Whoever first notices the interval is over runs the controller.
+	 */
+	interval_start = zca_interval_start;
+	if (now - interval_start >= ZCA_INTERVAL &&
+	    atomic_cas_64((volatile uint64_t *)&zca_interval_start,
+	    interval_start, now) == interval_start) {
+		mutex_enter(&zca_adjust_lock);
+		zio_compress_auto_adjust(now - interval_start);
+		mutex_exit(&zca_adjust_lock);
+	}
+
+	if (step == ZCA_STEPS)
+		return (s_len);
+
+	*compress = zio_compress_auto_steps[step].zcs_compress;
+	*level = zio_compress_auto_steps[step].zcs_level;
+	return (c_len);
+}
+
+#ifdef _KERNEL
+static int
+zio_compress_auto_kstat_update(kstat_t *ksp, int rw)
+{
+	ASSERT(ksp != NULL);
+	ASSERT(MUTEX_HELD(&zca_adjust_lock));
+
+	if (rw == KSTAT_WRITE) {
+		for (int c = 0; c < max_ncpus; c++) {
+			zca_cpu_t *zcc = &zca_cpu[c];
+
+			mutex_enter(&zcc->zcc_lock);
+			zcc->zcc_off = 0;
+			for (size_t i = 0; i < ZCA_STEPS; i++)
+				zcc->zcc_blocks[i] = 0;
+			zcc->zcc_explored = 0;
+			zcc->zcc_lz4_enough = 0;
+			zcc->zcc_skipped = 0;
+			mutex_exit(&zcc->zcc_lock);
+		}
+		ZCASTAT(zcas_step_up) = 0;
+		ZCASTAT(zcas_step_down) = 0;
+		return (0);
+	}
+
+	ZCASTAT(zcas_off) = 0;
+	for (size_t i = 0; i < ZCA_STEPS; i++)
+		ZCASTAT(zcas_blocks[i]) = 0;
+	ZCASTAT(zcas_explored) = 0;
+	ZCASTAT(zcas_lz4_enough) = 0;
+	ZCASTAT(zcas_skipped) = 0;
+	for (int c = 0; c < max_ncpus; c++) {
+		zca_cpu_t *zcc = &zca_cpu[c];
+
+		mutex_enter(&zcc->zcc_lock);
+		ZCASTAT(zcas_off) += zcc->zcc_off;
+		for (size_t i = 0; i < ZCA_STEPS; i++)
+			ZCASTAT(zcas_blocks[i]) += zcc->zcc_blocks[i];
+		ZCASTAT(zcas_explored) += zcc->zcc_explored;
+		ZCASTAT(zcas_lz4_enough) += zcc->zcc_lz4_enough;
+		ZCASTAT(zcas_skipped) += zcc->zcc_skipped;
+		mutex_exit(&zcc->zcc_lock);
+	}
+
+	return (0);
+}
+#endif
+
+void
+zio_compress_init(void)
+{
+	zca_cpu = kmem_zalloc(max_ncpus * sizeof (zca_cpu_t), KM_SLEEP);
+	for (int c = 0; c < max_ncpus; c++)
+		mutex_init(&zca_cpu[c].zcc_lock, NULL, MUTEX_DEFAULT, NULL);
+	mutex_init(&zca_adjust_lock, NULL, MUTEX_DEFAULT, NULL);
+	zca_ratio[ZCA_STEP_LZ4] = 1024;
+	zca_interval_start = gethrtime();
+	ZCASTAT(zcas_step) = zca_step;
+
+	zio_compress_auto_ksp = kstat_create("zfs", 0, "compress_auto", "misc",
+	    KSTAT_TYPE_NAMED, sizeof (zio_compress_auto_stats) /
+	    sizeof (kstat_named_t), KSTAT_FLAG_VIRTUAL);
+	if (zio_compress_auto_ksp != NULL) {
+		zio_compress_auto_ksp->ks_data = &zio_compress_auto_stats;
+		zio_compress_auto_ksp->ks_lock = &zca_adjust_lock;
+#ifdef _KERNEL
+		zio_compress_auto_ksp->ks_update =
+		    zio_compress_auto_kstat_update;
+#endif
+		kstat_install(zio_compress_auto_ksp);
+	}
+}
+
+void
+zio_compress_fini(void)
+{
+	if (zio_compress_auto_ksp != NULL) {
+		kstat_delete(zio_compress_auto_ksp);
+		zio_compress_auto_ksp = NULL;
+	}
+	mutex_destroy(&zca_adjust_lock);
+	for (int c = 0; c < max_ncpus; c++)
+		mutex_destroy(&zca_cpu[c].zcc_lock);
+	kmem_free(zca_cpu, max_ncpus * sizeof (zca_cpu_t));
+	zca_cpu = NULL;
+}
+
 int
 zio_decompress_data_buf(enum zio_compress c, void *src, void *dst,
     size_t s_len, size_t d_len, uint8_t *level)
@@ -196,9 +593,23 @@ int
 zio_decompress_data(enum zio_compress c, abd_t *src, void *dst,
     size_t s_len, size_t d_len, uint8_t *level)
 {
-	void *tmp = abd_borrow_buf_copy(src, s_len);
-	int ret = zio_decompress_data_buf(c, tmp, dst, s_len, d_len, level);
-	abd_return_buf(src, tmp, s_len);
+	zio_compress_info_t *ci = &zio_compress_table[c];
+	int ret;
+
+	/*
+	 * Algorithms that can consume their input a chunk at a time are
+	 * handed scatter ABDs as they are, rather than linearizing what
+	 * can be a multi-megabyte block on every decompression.
+	 */
+	if ((uint_t)c < ZIO_COMPRESS_FUNCTIONS &&
+	    ci->ci_decompress_abd != NULL && !abd_is_linear(src)) {
+		ret = ci->ci_decompress_abd(src, dst, s_len, d_len, level);
+	} else {
+		void *tmp = abd_borrow_buf_copy(src, s_len);
+		ret = zio_decompress_data_buf(c, tmp, dst, s_len, d_len,
+		    level);
+		abd_return_buf(src, tmp, s_len);
+	}
 
 	/*
 	 * Decompression shouldn't fail, because we've already verified
@@ -223,3 +634,12 @@ zio_compress_to_feature(enum zio_compress comp)
 	}
 	return (SPA_FEATURE_NONE);
 }
+
+ZFS_MODULE_PARAM(zfs, zfs_, compress_auto_cpu_pct, UINT, ZMOD_RW,
+	"Share of CPU time compression=auto aims to stay under");
+
+ZFS_MODULE_PARAM(zfs, zfs_, compress_auto_min_gain, UINT, ZMOD_RW,
+	"Space saving in percent a higher compression=auto step must achieve");
+
+ZFS_MODULE_PARAM(zfs, zfs_, compress_auto_lz4_pct, UINT, ZMOD_RW,
+	"Space saving in percent at which compression=auto keeps LZ4's output");
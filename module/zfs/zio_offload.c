@@ -0,0 +1,412 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+#include <sys/zfs_context.h>
+#include <sys/spa.h>
+#include <sys/zio.h>
+#include <sys/zio_checksum.h>
+#include <sys/zio_compress.h>
+#include <sys/zio_offload.h>
+
+/*
+ * Offloading of checksum and compression work; see zio_offload.h for the
+ * interface.
+ *
+ * Providers are kept on zio_offload_providers in the order they registered,
+ * and the first one to accept a piece of work gets it.  Every request holds
+ * a reference on its provider from zio_offload_req_alloc() until it is done,
+ * and so does a thread while it is submitting a batch, so that
+ * zio_offload_unregister() can wait for the provider to go idle.
+ *
+ * The software provider does the work with the usual CPU implementations on
+ * its own taskq.  It is always registered but only accepts work when
+ * zio_offload_sw is set, and exists so the offload paths of the pipeline can
+ * be exercised, e.g. by ztest, without an accelerator.  As long as it is the
+ * only provider and it is off, zio_offload_req_alloc() returns without
+ * taking zio_offload_lock, so that every block doesn't pay for offload
+ * support nobody uses.
+ */
+
+/* Master switch; no new work is offloaded while this is 0 */
+int zio_offload_enabled = 1;
+
+/* Let the software provider take work */
+uint_t zio_offload_sw = 0;
+
+/* If nonzero, the software provider fails 1 in this many requests */
+uint_t zio_offload_sw_errors = 0;
+
+#define	ZIO_OFFLOAD_BATCH_MAX	16
+
+typedef struct zio_offload_provider {
+	const zio_offload_ops_t	*zop_ops;
+	list_node_t	zop_node;
+	kmutex_t	zop_lock;
+	kcondvar_t	zop_cv;
+	list_t		zop_queue;	/* requests waiting to be submitted */
+	boolean_t	zop_submitting;
+	uint64_t	zop_refs;
+} zio_offload_provider_t;
+
+static krwlock_t zio_offload_lock;
+static list_t zio_offload_providers;
+static uint32_t zio_offload_nproviders;	/* excluding the software one */
+static kmem_cache_t *zio_offload_req_cache;
+static taskq_t *zio_offload_sw_taskq;
+
+typedef struct zio_offload_stats {
+	kstat_named_t	zos_requests[ZIO_OFFLOAD_OPS];
+	kstat_named_t	zos_errors[ZIO_OFFLOAD_OPS];
+	kstat_named_t	zos_batches;
+} zio_offload_stats_t;
+
+static zio_offload_stats_t zio_offload_stats = {
+	{
+		{ "checksum",		KSTAT_DATA_UINT64 },
+		{ "compress",		KSTAT_DATA_UINT64 },
+	},
+	{
+		{ "checksum_errors",	KSTAT_DATA_UINT64 },
+		{ "compress_errors",	KSTAT_DATA_UINT64 },
+	},
+	{ "batches",		KSTAT_DATA_UINT64 },
+};
+
+#define	ZOSTAT(stat)		(zio_offload_stats.stat.value.ui64)
+#define	ZOSTAT_BUMP(stat)	atomic_inc_64(&ZOSTAT(stat))
+
+static kstat_t *zio_offload_ksp;
+
+static const zio_offload_ops_t zio_offload_sw_ops;
+
+static void
+zio_offload_rele(zio_offload_provider_t *zop)
+{
+	mutex_enter(&zop->zop_lock);
+	ASSERT3U(zop->zop_refs, >, 0);
+	if (--zop->zop_refs == 0)
+		cv_broadcast(&zop->zop_cv);
+	mutex_exit(&zop->zop_lock);
+}
+
+void
+zio_offload_register(const zio_offload_ops_t *ops)
+{
+	zio_offload_provider_t *zop = kmem_zalloc(sizeof (*zop), KM_SLEEP);
+
+	zop->zop_ops = ops;
+	mutex_init(&zop->zop_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&zop->zop_cv, NULL, CV_DEFAULT, NULL);
+	list_create(&zop->zop_queue, sizeof (zio_offload_req_t),
+	    offsetof(zio_offload_req_t, zor_node));
+
+	rw_enter(&zio_offload_lock, RW_WRITER);
+	list_insert_tail(&zio_offload_providers, zop);
+	if (ops != &zio_offload_sw_ops)
+		atomic_inc_32(&zio_offload_nproviders);
+	rw_exit(&zio_offload_lock);
+}
+
+/*
+ * Stop handing work to a provider, and wait for everything it was given to
+ * complete.
+ */
+void
+zio_offload_unregister(const zio_offload_ops_t *ops)
+{
+	zio_offload_provider_t *zop;
+
+	rw_enter(&zio_offload_lock, RW_WRITER);
+	for (zop = list_head(&zio_offload_providers); zop != NULL;
+	    zop = list_next(&zio_offload_providers, zop)) {
+		if (zop->zop_ops == ops)
+			break;
+	}
+	VERIFY3P(zop, !=, NULL);
+	list_remove(&zio_offload_providers, zop);
+	if (ops != &zio_offload_sw_ops)
+		atomic_dec_32(&zio_offload_nproviders);
+	rw_exit(&zio_offload_lock);
+
+	mutex_enter(&zop->zop_lock);
+	while (zop->zop_refs != 0)
+		cv_wait(&zop->zop_cv, &zop->zop_lock);
+	mutex_exit(&zop->zop_lock);
+
+	ASSERT(list_is_empty(&zop->zop_queue));
+	list_destroy(&zop->zop_queue);
+	cv_destroy(&zop->zop_cv);
+	mutex_destroy(&zop->zop_lock);
+	kmem_free(zop, sizeof (*zop));
+}
+
+/*
+ * Get a request for offloading work on behalf of a zio, or NULL if no
+ * provider takes it.  alg is the enum zio_checksum or enum zio_compress to
+ * use; the remaining inputs, such as the compression level, are filled in by
+ * the caller before the request is submitted.
+ */
+zio_offload_req_t *
+zio_offload_req_alloc(zio_t *zio, zio_offload_op_t op, uint_t alg,
+    abd_t *abd, uint64_t size)
+{
+	zio_offload_provider_t *zop;
+	zio_offload_req_t *zor;
+
+	ASSERT3U(op, <, ZIO_OFFLOAD_OPS);
+
+	if (!zio_offload_enabled)
+		return (NULL);
+	if (zio_offload_sw == 0 &&
+	    atomic_load_32(&zio_offload_nproviders) == 0)
+		return (NULL);
+
+	rw_enter(&zio_offload_lock, RW_READER);
+	for (zop = list_head(&zio_offload_providers); zop != NULL;
+	    zop = list_next(&zio_offload_providers, zop)) {
+		if (zop->zop_ops->zoo_accepts(op, alg, size))
+			break;
+	}
+	if (zop == NULL) {
+		rw_exit(&zio_offload_lock);
+		return (NULL);
+	}
+	mutex_enter(&zop->zop_lock);
+	zop->zop_refs++;
+	mutex_exit(&zop->zop_lock);
+	rw_exit(&zio_offload_lock);
+
+	zor = kmem_cache_alloc(zio_offload_req_cache, KM_SLEEP);
+	memset(zor, 0, sizeof (*zor));
+	taskq_init_ent(&zor->zor_ent);
+	zor->zor_op = op;
+	zor->zor_zio = zio;
+	zor->zor_abd = abd;
+	zor->zor_size = size;
+	zor->zor_provider = zop;
+	if (op == ZIO_OFFLOAD_CHECKSUM) {
+		zor->zor_checksum = alg;
+	} else {
+		zor->zor_compress = alg;
+		zor->zor_dst = zio_buf_alloc(size);
+	}
+
+	return (zor);
+}
+
+/*
+ * Free a completed request, and the compression output buffer unless the
+ * caller has taken it over and cleared zor_dst.
+ */
+void
+zio_offload_req_free(zio_offload_req_t *zor)
+{
+	if (zor->zor_dst != NULL)
+		zio_buf_free(zor->zor_dst, zor->zor_size);
+	kmem_cache_free(zio_offload_req_cache, zor);
+}
+
+/*
+ * Queue a request with its provider, and unless another thread is already
+ * submitting to it, submit everything queued in batches until the queue
+ * stays empty.  done is called when the request completes, possibly before
+ * this returns.
+ */
+void
+zio_offload_submit(zio_offload_req_t *zor, zio_offload_done_f *done)
+{
+	zio_offload_provider_t *zop = zor->zor_provider;
+	zio_offload_req_t *batch[ZIO_OFFLOAD_BATCH_MAX];
+	int n;
+
+	zor->zor_done = done;
+	ZOSTAT_BUMP(zos_requests[zor->zor_op]);
+
+	mutex_enter(&zop->zop_lock);
+	list_insert_tail(&zop->zop_queue, zor);
+	if (zop->zop_submitting) {
+		mutex_exit(&zop->zop_lock);
+		return;
+	}
+	zop->zop_submitting = B_TRUE;
+	zop->zop_refs++;
+
+	for (;;) {
+		for (n = 0; n < ZIO_OFFLOAD_BATCH_MAX; n++) {
+			if ((batch[n] = list_remove_head(&zop->zop_queue)) ==
+			    NULL)
+				break;
+		}
+		if (n == 0)
+			break;
+		mutex_exit(&zop->zop_lock);
+
+		ZOSTAT_BUMP(zos_batches);
+		zop->zop_ops->zoo_submit(batch, n);
+
+		mutex_enter(&zop->zop_lock);
+	}
+
+	zop->zop_submitting = B_FALSE;
+	mutex_exit(&zop->zop_lock);
+	zio_offload_rele(zop);
+}
+
+/*
+ * Called by the provider when it has finished with a request, with the
+ * error that made it give up on it, if any.
+ */
+void
+zio_offload_done(zio_offload_req_t *zor, int error)
+{
+	zio_offload_provider_t *zop = zor->zor_provider;
+
+	zor->zor_error = error;
+	if (error != 0)
+		ZOSTAT_BUMP(zos_errors[zor->zor_op]);
+
+	/* The request may be freed once the callback has been made */
+	zor->zor_done(zor);
+	zio_offload_rele(zop);
+}
+
+/*
+ * The software provider.
+ */
+static boolean_t
+zio_offload_sw_accepts(zio_offload_op_t op, uint_t alg, uint64_t size)
+{
+	(void) op, (void) alg, (void) size;
+	return (zio_offload_sw != 0 && zio_offload_sw_taskq != NULL);
+}
+
+static void
+zio_offload_sw_func(void *arg)
+{
+	zio_offload_req_t *zor = arg;
+	int error = 0;
+
+	if (zio_offload_sw_errors != 0 &&
+	    random_in_range(zio_offload_sw_errors) == 0) {
+		error = SET_ERROR(EIO);
+	} else if (zor->zor_op == ZIO_OFFLOAD_CHECKSUM) {
+		zio_checksum_compute_raw(zor->zor_zio->io_spa,
+		    zor->zor_checksum, zor->zor_abd, zor->zor_size,
+		    &zor->zor_cksum);
+	} else {
+		zor->zor_psize = zio_compress_data(zor->zor_compress,
+		    zor->zor_abd, &zor->zor_dst, zor->zor_size,
+		    zor->zor_level);
+	}
+
+	zio_offload_done(zor, error);
+}
+
+static void
+zio_offload_sw_submit(zio_offload_req_t *const *batch, int n)
+{
+	for (int i = 0; i < n; i++) {
+		taskq_dispatch_ent(zio_offload_sw_taskq, zio_offload_sw_func,
+		    batch[i], 0, &batch[i]->zor_ent);
+	}
+}
+
+static const zio_offload_ops_t zio_offload_sw_ops = {
+	.zoo_name = "software",
+	.zoo_accepts = zio_offload_sw_accepts,
+	.zoo_submit = zio_offload_sw_submit,
+};
+
+#ifdef _KERNEL
+static int
+zio_offload_kstat_update(kstat_t *ksp, int rw)
+{
+	ASSERT(ksp != NULL);
+
+	if (rw == KSTAT_WRITE && ksp == zio_offload_ksp) {
+		for (int op = 0; op < ZIO_OFFLOAD_OPS; op++) {
+			ZOSTAT(zos_requests[op]) = 0;
+			ZOSTAT(zos_errors[op]) = 0;
+		}
+		ZOSTAT(zos_batches) = 0;
+	}
+
+	return (0);
+}
+#endif
+
+void
+zio_offload_init(void)
+{
+	rw_init(&zio_offload_lock, NULL, RW_DEFAULT, NULL);
+	list_create(&zio_offload_providers, sizeof (zio_offload_provider_t),
+	    offsetof(zio_offload_provider_t, zop_node));
+	zio_offload_req_cache = kmem_cache_create("zio_offload_req_cache",
+	    sizeof (zio_offload_req_t), 0, NULL, NULL, NULL, NULL, NULL, 0);
+
+	zio_offload_sw_taskq = taskq_create("z_offload_sw", 100, minclsyspri,
+	    1, INT_MAX, TASKQ_THREADS_CPU_PCT | TASKQ_DYNAMIC);
+	zio_offload_register(&zio_offload_sw_ops);
+
+	zio_offload_ksp = kstat_create("zfs", 0, "zio_offload", "misc",
+	    KSTAT_TYPE_NAMED, sizeof (zio_offload_stats) /
+	    sizeof (kstat_named_t), KSTAT_FLAG_VIRTUAL);
+	if (zio_offload_ksp != NULL) {
+		zio_offload_ksp->ks_data = &zio_offload_stats;
+#ifdef _KERNEL
+		zio_offload_ksp->ks_update = zio_offload_kstat_update;
+#endif
+		kstat_install(zio_offload_ksp);
+	}
+}
+
+void
+zio_offload_fini(void)
+{
+	if (zio_offload_ksp != NULL) {
+		kstat_delete(zio_offload_ksp);
+		zio_offload_ksp = NULL;
+	}
+
+	zio_offload_unregister(&zio_offload_sw_ops);
+	taskq_destroy(zio_offload_sw_taskq);
+	zio_offload_sw_taskq = NULL;
+
+	ASSERT(list_is_empty(&zio_offload_providers));
+	list_destroy(&zio_offload_providers);
+	kmem_cache_destroy(zio_offload_req_cache);
+	rw_destroy(&zio_offload_lock);
+}
+
+#if defined(_KERNEL)
+EXPORT_SYMBOL(zio_offload_register);
+EXPORT_SYMBOL(zio_offload_unregister);
+EXPORT_SYMBOL(zio_offload_done);
+#endif
+
+ZFS_MODULE_PARAM(zfs_zio, zio_, offload_enabled, INT, ZMOD_RW,
+	"Hand checksum and compression work to offload providers");
+
+ZFS_MODULE_PARAM(zfs_zio, zio_, offload_sw, UINT, ZMOD_RW,
+	"Let the software offload provider take work");
+
+ZFS_MODULE_PARAM(zfs_zio, zio_, offload_sw_errors, UINT, ZMOD_RW,
+	"Make the software offload provider fail 1 in this many requests");
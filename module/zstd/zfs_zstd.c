@@ -54,6 +54,19 @@ static uint_t zstd_earlyabort_pass = 1;
 static int zstd_cutoff_level = ZIO_ZSTD_LEVEL_3;
 static unsigned int zstd_abort_size = (128 * 1024);
 
+/*
+ * When zstd_parallel is set, records of at least twice ZSTD_PARALLEL_CHUNK,
+ * compressed at level ZSTD_PARALLEL_MIN_LEVEL or above, are split into chunks
+ * of that size which are compressed as independent zstd frames on
+ * zstd_parallel_taskq. The chunk size and minimum level are fixed so that the
+ * same data at the same level always compresses to the same output, which
+ * nopwrite and dedup rely on.
+ */
+#define	ZSTD_PARALLEL_CHUNK	(1024 * 1024)
+#define	ZSTD_PARALLEL_MIN_LEVEL	ZIO_ZSTD_LEVEL_10
+static uint_t zstd_parallel = 0;
+static taskq_t *zstd_parallel_taskq = NULL;
+
 static kstat_t *zstd_ksp = NULL;
 
 typedef struct zstd_stats {
@@ -66,6 +79,14 @@ typedef struct zstd_stats {
 	kstat_named_t	zstd_stat_dec_header_inval;
 	kstat_named_t	zstd_stat_com_fail;
 	kstat_named_t	zstd_stat_dec_fail;
+	/*
+	 * Records split into chunks compressed in parallel
+	 */
+	kstat_named_t	zstd_stat_com_parallel;
+	/*
+	 * Blocks decompressed straight out of scatter ABDs
+	 */
+	kstat_named_t	zstd_stat_dec_scatter;
 	/*
 	 * LZ4 first-pass early abort verdict
 	 */
@@ -95,6 +116,8 @@ static zstd_stats_t zstd_stats = {
 	{ "decompress_header_invalid",	KSTAT_DATA_UINT64 },
 	{ "compress_failed",		KSTAT_DATA_UINT64 },
 	{ "decompress_failed",		KSTAT_DATA_UINT64 },
+	{ "compress_parallel",		KSTAT_DATA_UINT64 },
+	{ "decompress_scatter",		KSTAT_DATA_UINT64 },
 	{ "lz4pass_allowed",		KSTAT_DATA_UINT64 },
 	{ "lz4pass_rejected",		KSTAT_DATA_UINT64 },
 	{ "zstdpass_allowed",		KSTAT_DATA_UINT64 },
@@ -121,6 +144,8 @@ kstat_zstd_update(kstat_t *ksp, int rw)
 		ZSTDSTAT_ZERO(zstd_stat_dec_header_inval);
 		ZSTDSTAT_ZERO(zstd_stat_com_fail);
 		ZSTDSTAT_ZERO(zstd_stat_dec_fail);
+		ZSTDSTAT_ZERO(zstd_stat_com_parallel);
+		ZSTDSTAT_ZERO(zstd_stat_dec_scatter);
 		ZSTDSTAT_ZERO(zstd_stat_lz4pass_allowed);
 		ZSTDSTAT_ZERO(zstd_stat_lz4pass_rejected);
 		ZSTDSTAT_ZERO(zstd_stat_zstdpass_allowed);
@@ -488,6 +513,161 @@ keep_trying:
 
 }
 
+/*
+ * Compress src into a single magicless zstd frame at dst. Returns the size of
+ * the frame or a zstd error code, or 0 if no context could be allocated.
+ */
+static size_t
+zfs_zstd_compress_frame(void *dst, size_t d_len, const void *src,
+    size_t s_len, int16_t zstd_level)
+{
+	ZSTD_CCtx *cctx;
+	size_t c_len;
+
+	cctx = ZSTD_createCCtx_advanced(zstd_malloc);
+	if (!cctx)
+		return (0);
+
+	/* Set the compression level */
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, zstd_level);
+
+	/* Use the "magicless" zstd header which saves us 4 header bytes */
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_format, ZSTD_f_zstd1_magicless);
+
+	/*
+	 * Disable redundant checksum calculation and content size storage since
+	 * this is already done by ZFS itself.
+	 */
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 0);
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_contentSizeFlag, 0);
+
+	c_len = ZSTD_compress2(cctx, dst, d_len, src, s_len);
+
+	ZSTD_freeCCtx(cctx);
+
+	return (c_len);
+}
+
+typedef struct zstd_parallel {
+	kmutex_t	zp_lock;
+	kcondvar_t	zp_cv;
+	uint_t		zp_pending;
+	int16_t		zp_level;
+} zstd_parallel_t;
+
+typedef struct zstd_chunk {
+	zstd_parallel_t	*zc_parallel;
+	const char	*zc_src;
+	size_t		zc_s_len;
+	char		*zc_dst;
+	size_t		zc_d_len;
+	size_t		zc_c_len;
+	taskq_ent_t	zc_ent;
+} zstd_chunk_t;
+
+static void
+zfs_zstd_compress_chunk(void *arg)
+{
+	zstd_chunk_t *zc = arg;
+	zstd_parallel_t *zp = zc->zc_parallel;
+
+	zc->zc_c_len = zfs_zstd_compress_frame(zc->zc_dst, zc->zc_d_len,
+	    zc->zc_src, zc->zc_s_len, zp->zp_level);
+
+	mutex_enter(&zp->zp_lock);
+	if (--zp->zp_pending == 0)
+		cv_broadcast(&zp->zp_cv);
+	mutex_exit(&zp->zp_lock);
+}
+
+/*
+ * Compress src as a sequence of independent frames, one per chunk, on
+ * several threads at once, and concatenate them at dst. The decompressor
+ * decodes consecutive frames into consecutive output, so the result is
+ * read back by zfs_zstd_decompress_level() like any other block. The first
+ * chunk is compressed straight into dst; the others need a scratch buffer
+ * since their final offsets are not known until the preceding chunks are
+ * done. Returns the same as zfs_zstd_compress_frame().
+ */
+static size_t
+zfs_zstd_compress_parallel(void *dst, size_t d_len, const void *src,
+    size_t s_len, int16_t zstd_level)
+{
+	zstd_parallel_t zp;
+	zstd_chunk_t *chunks;
+	char *scratch;
+	size_t chunk_size = ZSTD_PARALLEL_CHUNK;
+	size_t nchunks = DIV_ROUND_UP(s_len, chunk_size);
+	size_t bound = ZSTD_compressBound(chunk_size);
+	size_t scratch_len = (nchunks - 1) * bound;
+	size_t c_len = 0;
+
+	chunks = kmem_zalloc(nchunks * sizeof (zstd_chunk_t), KM_SLEEP);
+	scratch = vmem_alloc(scratch_len, KM_SLEEP);
+
+	mutex_init(&zp.zp_lock, NULL, MUTEX_DEFAULT, NULL);
+	cv_init(&zp.zp_cv, NULL, CV_DEFAULT, NULL);
+	zp.zp_pending = nchunks - 1;
+	zp.zp_level = zstd_level;
+
+	for (size_t i = 0; i < nchunks; i++) {
+		zstd_chunk_t *zc = &chunks[i];
+
+		zc->zc_parallel = &zp;
+		zc->zc_src = (const char *)src + i * chunk_size;
+		zc->zc_s_len = MIN(chunk_size, s_len - i * chunk_size);
+		taskq_init_ent(&zc->zc_ent);
+		if (i == 0) {
+			zc->zc_dst = dst;
+			zc->zc_d_len = d_len;
+		} else {
+			zc->zc_dst = scratch + (i - 1) * bound;
+			zc->zc_d_len = bound;
+			taskq_dispatch_ent(zstd_parallel_taskq,
+			    zfs_zstd_compress_chunk, zc, 0, &zc->zc_ent);
+		}
+	}
+
+	/* The first chunk is ours to compress while the others run. */
+	chunks[0].zc_c_len = zfs_zstd_compress_frame(chunks[0].zc_dst,
+	    chunks[0].zc_d_len, chunks[0].zc_src, chunks[0].zc_s_len,
+	    zstd_level);
+
+	mutex_enter(&zp.zp_lock);
+	while (zp.zp_pending != 0)
+		cv_wait(&zp.zp_cv, &zp.zp_lock);
+	mutex_exit(&zp.zp_lock);
+
+	for (size_t i = 0; i < nchunks; i++) {
+		size_t len = chunks[i].zc_c_len;
+
+		if (len == 0 || ZSTD_isError(len)) {
+			c_len = len;
+			break;
+		}
+
+		/*
+		 * Report running out of room the way ZSTD_compress2() would
+		 * have for a single frame.
+		 */
+		if (c_len + len > d_len) {
+			c_len = (size_t)-ZSTD_error_dstSize_tooSmall;
+			break;
+		}
+
+		if (i > 0)
+			memcpy((char *)dst + c_len, chunks[i].zc_dst, len);
+		c_len += len;
+	}
+
+	cv_destroy(&zp.zp_cv);
+	mutex_destroy(&zp.zp_lock);
+	vmem_free(scratch, scratch_len);
+	kmem_free(chunks, nchunks * sizeof (zstd_chunk_t));
+
+	return (c_len);
+}
+
 /* Compress block using zstd */
 size_t
 zfs_zstd_compress(void *s_start, void *d_start, size_t s_len, size_t d_len,
@@ -496,7 +676,6 @@ zfs_zstd_compress(void *s_start, void *d_start, size_t s_len, size_t d_len,
 	size_t c_len;
 	int16_t zstd_level;
 	zfs_zstdhdr_t *hdr;
-	ZSTD_CCtx *cctx;
 
 	hdr = (zfs_zstdhdr_t *)d_start;
 
@@ -510,37 +689,26 @@ zfs_zstd_compress(void *s_start, void *d_start, size_t s_len, size_t d_len,
 	ASSERT3U(d_len, <=, s_len);
 	ASSERT3U(zstd_level, !=, 0);
 
-	cctx = ZSTD_createCCtx_advanced(zstd_malloc);
+	if (zstd_parallel != 0 && zstd_parallel_taskq != NULL &&
+	    s_len >= 2 * ZSTD_PARALLEL_CHUNK &&
+	    zstd_level >= ZSTD_PARALLEL_MIN_LEVEL) {
+		ZSTDSTAT_BUMP(zstd_stat_com_parallel);
+		c_len = zfs_zstd_compress_parallel(hdr->data,
+		    d_len - sizeof (*hdr), s_start, s_len, zstd_level);
+	} else {
+		c_len = zfs_zstd_compress_frame(hdr->data,
+		    d_len - sizeof (*hdr), s_start, s_len, zstd_level);
+	}
 
 	/*
 	 * Out of kernel memory, gently fall through - this will disable
 	 * compression in zio_compress_data
 	 */
-	if (!cctx) {
+	if (c_len == 0) {
 		ZSTDSTAT_BUMP(zstd_stat_com_alloc_fail);
 		return (s_len);
 	}
 
-	/* Set the compression level */
-	ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, zstd_level);
-
-	/* Use the "magicless" zstd header which saves us 4 header bytes */
-	ZSTD_CCtx_setParameter(cctx, ZSTD_c_format, ZSTD_f_zstd1_magicless);
-
-	/*
-	 * Disable redundant checksum calculation and content size storage since
-	 * this is already done by ZFS itself.
-	 */
-	ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 0);
-	ZSTD_CCtx_setParameter(cctx, ZSTD_c_contentSizeFlag, 0);
-
-	c_len = ZSTD_compress2(cctx,
-	    hdr->data,
-	    d_len - sizeof (*hdr),
-	    s_start, s_len);
-
-	ZSTD_freeCCtx(cctx);
-
 	/* Error in the compression routine, disable compression. */
 	if (ZSTD_isError(c_len)) {
 		/*
@@ -594,27 +762,27 @@ zfs_zstd_compress(void *s_start, void *d_start, size_t s_len, size_t d_len,
 	return (c_len + sizeof (*hdr));
 }
 
-/* Decompress block using zstd and return its stored level */
-int
-zfs_zstd_decompress_level(void *s_start, void *d_start, size_t s_len,
-    size_t d_len, uint8_t *level)
+/*
+ * Check the header in front of a compressed block and return the length of
+ * the zstd frame following it and the level the block was compressed with.
+ * An invalid level is a strong indicator for data corruption, in which case
+ * an error is returned so the upper layers can try to fix it.
+ */
+static int
+zfs_zstd_check_header(const zfs_zstdhdr_t *hdr, size_t s_len,
+    uint32_t *c_len, uint8_t *curlevel)
 {
-	ZSTD_DCtx *dctx;
-	size_t result;
 	int16_t zstd_level;
-	uint32_t c_len;
-	const zfs_zstdhdr_t *hdr;
 	zfs_zstdhdr_t hdr_copy;
 
-	hdr = (const zfs_zstdhdr_t *)s_start;
-	c_len = BE_32(hdr->c_len);
+	*c_len = BE_32(hdr->c_len);
 
 	/*
 	 * Make a copy instead of directly converting the header, since we must
 	 * not modify the original data that may be used again later.
 	 */
 	hdr_copy.raw_version_level = BE_32(hdr->raw_version_level);
-	uint8_t curlevel = zfs_get_hdrlevel(&hdr_copy);
+	*curlevel = zfs_get_hdrlevel(&hdr_copy);
 
 	/*
 	 * NOTE: We ignore the ZSTD version for now. As soon as any
@@ -622,25 +790,40 @@ zfs_zstd_decompress_level(void *s_start, void *d_start, size_t s_len,
 	 * The version can be accessed via `hdr_copy.version`.
 	 */
 
-	/*
-	 * Convert and check the level
-	 * An invalid level is a strong indicator for data corruption! In such
-	 * case return an error so the upper layers can try to fix it.
-	 */
-	if (zstd_enum_to_level(curlevel, &zstd_level)) {
+	/* Convert and check the level */
+	if (zstd_enum_to_level(*curlevel, &zstd_level)) {
 		ZSTDSTAT_BUMP(zstd_stat_dec_inval);
 		return (1);
 	}
 
-	ASSERT3U(d_len, >=, s_len);
-	ASSERT3U(curlevel, !=, ZIO_COMPLEVEL_INHERIT);
+	ASSERT3U(*curlevel, !=, ZIO_COMPLEVEL_INHERIT);
 
 	/* Invalid compressed buffer size encoded at start */
-	if (c_len + sizeof (*hdr) > s_len) {
+	if (*c_len + sizeof (*hdr) > s_len) {
 		ZSTDSTAT_BUMP(zstd_stat_dec_header_inval);
 		return (1);
 	}
 
+	return (0);
+}
+
+/* Decompress block using zstd and return its stored level */
+int
+zfs_zstd_decompress_level(void *s_start, void *d_start, size_t s_len,
+    size_t d_len, uint8_t *level)
+{
+	ZSTD_DCtx *dctx;
+	size_t result;
+	uint32_t c_len;
+	uint8_t curlevel;
+	const zfs_zstdhdr_t *hdr;
+
+	ASSERT3U(d_len, >=, s_len);
+
+	hdr = (const zfs_zstdhdr_t *)s_start;
+	if (zfs_zstd_check_header(hdr, s_len, &c_len, &curlevel))
+		return (1);
+
 	dctx = ZSTD_createDCtx_advanced(zstd_dctx_malloc);
 	if (!dctx) {
 		ZSTDSTAT_BUMP(zstd_stat_dec_alloc_fail);
@@ -670,6 +853,101 @@ zfs_zstd_decompress_level(void *s_start, void *d_start, size_t s_len,
 	return (0);
 }
 
+typedef struct zstd_abd_stream {
+	ZSTD_DCtx	*zas_dctx;
+	ZSTD_outBuffer	zas_out;
+	size_t		zas_result;
+} zstd_abd_stream_t;
+
+static int
+zfs_zstd_decompress_abd_cb(void *buf, size_t len, void *private)
+{
+	zstd_abd_stream_t *zas = private;
+	ZSTD_inBuffer in = { buf, len, 0 };
+
+	while (in.pos < in.size) {
+		size_t in_pos = in.pos;
+		size_t out_pos = zas->zas_out.pos;
+
+		zas->zas_result = ZSTD_decompressStream(zas->zas_dctx,
+		    &zas->zas_out, &in);
+		if (ZSTD_isError(zas->zas_result))
+			return (1);
+
+		/*
+		 * A block may hold several consecutive frames, so input left
+		 * after the end of one starts the next. No progress at all
+		 * means the output buffer is full and the block does not
+		 * decompress to what the caller expected.
+		 */
+		if (in.pos == in_pos && zas->zas_out.pos == out_pos) {
+			zas->zas_result = 1;
+			return (1);
+		}
+	}
+
+	return (0);
+}
+
+/*
+ * Decompress a block straight out of a scatter ABD and return its stored
+ * level. The frame is fed to the streaming decoder one chunk at a time, and
+ * since the output buffer is flat and stable, the decoder writes into it
+ * directly and only ever buffers a single zstd block of input internally,
+ * instead of the caller linearizing the whole compressed block first.
+ */
+int
+zfs_zstd_decompress_level_abd(abd_t *src, void *d_start, size_t s_len,
+    size_t d_len, uint8_t *level)
+{
+	zstd_abd_stream_t zas;
+	zfs_zstdhdr_t hdr;
+	uint32_t c_len;
+	uint8_t curlevel;
+	int err;
+
+	ASSERT3U(d_len, >=, s_len);
+	ASSERT3U(s_len, >=, sizeof (hdr));
+
+	abd_copy_to_buf(&hdr, src, sizeof (hdr));
+	if (zfs_zstd_check_header(&hdr, s_len, &c_len, &curlevel))
+		return (1);
+
+	zas.zas_dctx = ZSTD_createDCtx_advanced(zstd_dctx_malloc);
+	if (!zas.zas_dctx) {
+		ZSTDSTAT_BUMP(zstd_stat_dec_alloc_fail);
+		return (1);
+	}
+
+	/* Set header type to "magicless" and decode straight into d_start */
+	ZSTD_DCtx_setParameter(zas.zas_dctx, ZSTD_d_format,
+	    ZSTD_f_zstd1_magicless);
+	ZSTD_DCtx_setParameter(zas.zas_dctx, ZSTD_d_stableOutBuffer, 1);
+
+	zas.zas_out.dst = d_start;
+	zas.zas_out.size = d_len;
+	zas.zas_out.pos = 0;
+	zas.zas_result = 1;
+
+	err = abd_iterate_func(src, sizeof (hdr), c_len,
+	    zfs_zstd_decompress_abd_cb, &zas);
+	ZSTD_freeDCtx(zas.zas_dctx);
+
+	/* The frame must have been decoded completely */
+	if (err != 0 || zas.zas_result != 0) {
+		ZSTDSTAT_BUMP(zstd_stat_dec_fail);
+		return (1);
+	}
+
+	ZSTDSTAT_BUMP(zstd_stat_dec_scatter);
+
+	if (level) {
+		*level = curlevel;
+	}
+
+	return (0);
+}
+
 /* Decompress datablock using zstd */
 int
 zfs_zstd_decompress(void *s_start, void *d_start, size_t s_len, size_t d_len,
@@ -859,6 +1137,9 @@ zstd_init(void)
 	pool_count = (boot_ncpus * 4);
 	zstd_meminit();
 
+	zstd_parallel_taskq = taskq_create("z_zstd_par", 100, minclsyspri,
+	    1, INT_MAX, TASKQ_THREADS_CPU_PCT | TASKQ_DYNAMIC);
+
 	/* Initialize kstat */
 	zstd_ksp = kstat_create("zfs", 0, "zstd", "misc",
 	    KSTAT_TYPE_NAMED, sizeof (zstd_stats) / sizeof (kstat_named_t),
@@ -883,6 +1164,11 @@ zstd_fini(void)
 		zstd_ksp = NULL;
 	}
 
+	if (zstd_parallel_taskq != NULL) {
+		taskq_destroy(zstd_parallel_taskq);
+		zstd_parallel_taskq = NULL;
+	}
+
 	/* Release fallback memory */
 	vmem_free(zstd_dctx_fallback.mem, zstd_dctx_fallback.mem_size);
 	mutex_destroy(&zstd_dctx_fallback.barrier);
@@ -901,4 +1187,6 @@ ZFS_MODULE_PARAM(zfs, zstd_, earlyabort_pass, UINT, ZMOD_RW,
 	"Enable early abort attempts when using zstd");
 ZFS_MODULE_PARAM(zfs, zstd_, abort_size, UINT, ZMOD_RW,
 	"Minimal size of block to attempt early abort");
+ZFS_MODULE_PARAM(zfs, zstd_, parallel, UINT, ZMOD_RW,
+	"Compress large records at high levels in parallel chunks");
 #endif
@@ -480,6 +480,64 @@ static size_t fmt_hexdump(char *dest, const char *src, size_t len) {
 	return (written);
 }
 
+/*
+ * Hash buf the way a parallel checksum does: as subtrees of sub bytes, each
+ * on its own context and fed feed bytes at a time, with the rest of the
+ * input after them.
+ */
+static void
+blake3_subtree_update(BLAKE3_CTX *ctx, const uint8_t *buf, size_t len,
+    size_t sub, size_t feed)
+{
+	BLAKE3_CTX sctx;
+	uint8_t cv_pair[2 * BLAKE3_OUT_LEN];
+	size_t off, o;
+
+	for (off = 0; off + sub <= len; off += sub) {
+		Blake3_SubtreeInit(&sctx, ctx, off / BLAKE3_CHUNK_LEN);
+		for (o = 0; o < sub; o += feed) {
+			Blake3_Update(&sctx, buf + off + o,
+			    (sub - o < feed) ? sub - o : feed);
+		}
+		Blake3_SubtreeFinal(&sctx, off / BLAKE3_CHUNK_LEN, cv_pair);
+		Blake3_SubtreeAdd(ctx, cv_pair, sub);
+	}
+	Blake3_Update(ctx, buf + off, len - off);
+}
+
+/*
+ * Check the subtree hash of a test message, with the subtrees fed in small
+ * pieces, chunk by chunk and whole.
+ */
+static boolean_t
+blake3_subtree_test(const blake3_test_t *cur, const uint8_t *buf, size_t sub)
+{
+	const size_t feed[] = { 100, BLAKE3_CHUNK_LEN, sub };
+	BLAKE3_CTX ctx;
+	uint8_t digest[TEST_DIGEST_LEN];
+	char result[TEST_DIGEST_LEN];
+
+	for (int i = 0; i < 3; i++) {
+		/* default hashing */
+		Blake3_Init(&ctx);
+		blake3_subtree_update(&ctx, buf, cur->input_len, sub, feed[i]);
+		Blake3_FinalSeek(&ctx, 0, digest, TEST_DIGEST_LEN);
+		fmt_hexdump(result, (char *)digest, 131);
+		if (memcmp(result, cur->hash, 131) != 0)
+			return (B_FALSE);
+
+		/* salted hashing */
+		Blake3_InitKeyed(&ctx, (const uint8_t *)salt);
+		blake3_subtree_update(&ctx, buf, cur->input_len, sub, feed[i]);
+		Blake3_FinalSeek(&ctx, 0, digest, TEST_DIGEST_LEN);
+		fmt_hexdump(result, (char *)digest, 131);
+		if (memcmp(result, cur->shash, 131) != 0)
+			return (B_FALSE);
+	}
+
+	return (B_TRUE);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -541,6 +599,26 @@ main(int argc, char *argv[])
 		}
 	}
 
+	(void) printf("Running subtree tests:\n");
+	for (id = 0; id < blake3->getcnt(); id++) {
+		blake3->setid(id);
+		const char *name = blake3->getname();
+		for (i = 0; TestArray[i].hash; i++) {
+			blake3_test_t *cur = &TestArray[i];
+			size_t sub;
+
+			for (sub = 2048; sub <= (size_t)cur->input_len;
+			    sub *= 4) {
+				if (!blake3_subtree_test(cur, buffer, sub))
+					failed = B_TRUE;
+				printf("BLAKE3-%s Message (inlen=%d, "
+				    "subtree=%d)\tResult: %s\n", name,
+				    cur->input_len, (int)sub,
+				    failed?"FAILED!":"OK");
+			}
+		}
+	}
+
 	if (failed)
 		return (1);
 
@@ -168,6 +168,46 @@ static const uint8_t	sha512_256_test_digests[][32] = {
 	}
 };
 
+/*
+ * Hash messages of all lengths around the block and padding boundaries, and
+ * a few longer ones, with SHA2MultiBuffer() and compare the digests with the
+ * ones of SHA2Init(), SHA2Update() and SHA2Final().
+ */
+static boolean_t
+sha2_mb_test(int algotype, size_t diglen)
+{
+	static uint8_t	buf[32768];
+	const void	*data[300];
+	size_t		len[300];
+	uint8_t		digest[300][64], ref[64];
+	void		*digestp[300];
+	boolean_t	failed = B_FALSE;
+	int		i;
+
+	for (i = 0; i < sizeof (buf); i++)
+		buf[i] = i * 31 + (i >> 8);
+
+	for (i = 0; i < 300; i++) {
+		len[i] = (i < 280) ? i : 1024 * (i - 279) + i;
+		data[i] = buf + (i % 8);
+		digestp[i] = digest[i];
+	}
+
+	SHA2MultiBuffer(algotype, 300, data, len, digestp);
+
+	for (i = 0; i < 300; i++) {
+		SHA2_CTX ctx;
+
+		SHA2Init(algotype, &ctx);
+		SHA2Update(&ctx, data[i], len[i]);
+		SHA2Final(ref, &ctx);
+		if (memcmp(digest[i], ref, diglen) != 0)
+			failed = B_TRUE;
+	}
+
+	return (failed);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -176,6 +216,8 @@ main(int argc, char *argv[])
 
 	const zfs_impl_t *sha256 = zfs_impl_get_ops("sha256");
 	const zfs_impl_t *sha512 = zfs_impl_get_ops("sha512");
+	const zfs_impl_t *sha256_mb = zfs_impl_get_ops("sha256_mb");
+	const zfs_impl_t *sha512_mb = zfs_impl_get_ops("sha512_mb");
 	uint32_t id;
 
 	if (argc == 2)
@@ -187,6 +229,9 @@ main(int argc, char *argv[])
 	if (!sha512)
 		return (1);
 
+	if (!sha256_mb || !sha512_mb)
+		return (1);
+
 #define	SHA2_ALGO_TEST(_m, mode, diglen, testdigest)			\
 	do {								\
 		SHA2_CTX		ctx;				\
@@ -242,6 +287,66 @@ main(int argc, char *argv[])
 	SHA2_ALGO_TEST(test_msg0, 512_256, 256, sha512_256_test_digests[0]);
 	SHA2_ALGO_TEST(test_msg2, 512_256, 256, sha512_256_test_digests[2]);
 
+#define	SHA2_MB_TEST(impl, mode, diglen)				\
+	do {								\
+		(void) printf("SHA%-9sMultibuffer: %-8s\tResult: ", #mode, \
+		    impl->getname());					\
+		if (sha2_mb_test(SHA ## mode ## _MECH_INFO_TYPE,	\
+		    diglen / 8) == B_FALSE) {				\
+			(void) printf("OK\n");				\
+		} else {						\
+			(void) printf("FAILED!\n");			\
+			failed = B_TRUE;				\
+		}							\
+	} while (0)
+
+#define	SHA2_MB_PERF_TEST(mode, name)					\
+	do {								\
+		const void	*data[SHA2_MB_MAX_LANES];		\
+		size_t		len[SHA2_MB_MAX_LANES];			\
+		uint8_t		digest[SHA2_MB_MAX_LANES][64];		\
+		void		*digestp[SHA2_MB_MAX_LANES];		\
+		uint8_t		*block;					\
+		uint64_t	delta;					\
+		double		cpb = 0;				\
+		int		i, n = SHA2_MB_MAX_LANES;		\
+		struct timeval	start, end;				\
+		block = calloc(n, 131072);				\
+		for (i = 0; i < n; i++) {				\
+			data[i] = block + i * 131072;			\
+			len[i] = 131072;				\
+			digestp[i] = digest[i];				\
+		}							\
+		(void) gettimeofday(&start, NULL);			\
+		for (i = 0; i < 8192 / n; i++) {			\
+			SHA2MultiBuffer(SHA ## mode ## _MECH_INFO_TYPE,	\
+			    n, data, len, digestp);			\
+		}							\
+		(void) gettimeofday(&end, NULL);			\
+		free(block);						\
+		delta = (end.tv_sec * 1000000llu + end.tv_usec) -	\
+		    (start.tv_sec * 1000000llu + start.tv_usec);	\
+		if (cpu_mhz != 0) {					\
+			cpb = (cpu_mhz * 1e6 * ((double)delta /		\
+			    1000000)) / (8192 * 128 * 1024);		\
+		}							\
+		(void) printf("sha%s_mb-%-8s%7llu us (%.02f CPB)\n", #mode, \
+		    name, (u_longlong_t)delta, cpb);			\
+	} while (0)
+
+	for (id = 0; id < sha256_mb->getcnt(); id++) {
+		sha256_mb->setid(id);
+		SHA2_MB_TEST(sha256_mb, 256, 256);
+	}
+
+	for (id = 0; id < sha512_mb->getcnt(); id++) {
+		sha512_mb->setid(id);
+		SHA2_MB_TEST(sha512_mb, 384, 384);
+		SHA2_MB_TEST(sha512_mb, 512, 512);
+		SHA2_MB_TEST(sha512_mb, 512_224, 224);
+		SHA2_MB_TEST(sha512_mb, 512_256, 256);
+	}
+
 	if (failed)
 		return (1);
 
@@ -260,5 +365,17 @@ main(int argc, char *argv[])
 		SHA2_PERF_TEST(512, 512, name);
 	}
 
+	for (id = 0; id < sha256_mb->getcnt(); id++) {
+		sha256_mb->setid(id);
+		const char *name = sha256_mb->getname();
+		SHA2_MB_PERF_TEST(256, name);
+	}
+
+	for (id = 0; id < sha512_mb->getcnt(); id++) {
+		sha512_mb->setid(id);
+		const char *name = sha512_mb->getname();
+		SHA2_MB_PERF_TEST(512, name);
+	}
+
 	return (0);
 }
@@ -0,0 +1,312 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or https://opensource.org/licenses/CDDL-1.0.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Correctness and performance tests for u8_textprep_str() and u8_strcmp().
+ *
+ * The correctness tests check the ASCII fast paths against a byte at a time
+ * reference for every length and alignment, and check that a combining mark
+ * right after an ASCII run is still normalized with the character before it.
+ *
+ * The performance tests time both functions on ASCII names, which take the
+ * fast paths, and on names of the same length made of two byte characters,
+ * which go through the per-character table code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/u8_textprep.h>
+
+#define	MAXLEN		80
+#define	NNAMES		1024
+#define	PERF_ITERS	1000
+
+#define	NFD_CI_LOWER	(U8_TEXTPREP_NFD | U8_TEXTPREP_TOLOWER)
+
+static boolean_t failed = B_FALSE;
+
+static void
+fail(const char *fmt, const char *what, size_t len, int flag)
+{
+	(void) printf(fmt, what, len, flag);
+	failed = B_TRUE;
+}
+
+static char
+ref_case_conv(char c, int flag)
+{
+	if ((flag & U8_TEXTPREP_TOUPPER) && c >= 'a' && c <= 'z')
+		return (c - 'a' + 'A');
+	if ((flag & U8_TEXTPREP_TOLOWER) && c >= 'A' && c <= 'Z')
+		return (c - 'A' + 'a');
+	return (c);
+}
+
+static int
+ref_strcmp(const char *s1, const char *s2, int flag)
+{
+	char c1, c2;
+
+	do {
+		c1 = ref_case_conv(*s1++, flag);
+		c2 = ref_case_conv(*s2++, flag);
+	} while (c1 == c2 && c1 != '\0');
+
+	return ((unsigned char)c1 - (unsigned char)c2);
+}
+
+static int
+sign(int x)
+{
+	return ((x > 0) - (x < 0));
+}
+
+static void
+random_ascii(char *s, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		s[i] = 0x20 + random() % 0x5f;
+	s[len] = '\0';
+}
+
+static void
+test_textprep_ascii(int flag)
+{
+	char inbuf[MAXLEN + 16], outbuf[MAXLEN + 16], ref[MAXLEN + 16];
+
+	for (size_t len = 1; len <= MAXLEN; len++) {
+		for (size_t off = 0; off < 8; off++) {
+			char *in = inbuf + off;
+			size_t inlen = len, outlen = len;
+			int err = 0;
+
+			random_ascii(in, len);
+			for (size_t i = 0; i < len; i++)
+				ref[i] = ref_case_conv(in[i], flag);
+
+			(void) memset(outbuf, 0xff, sizeof (outbuf));
+			if (u8_textprep_str(in, &inlen, outbuf + off, &outlen,
+			    flag, U8_UNICODE_LATEST, &err) != 0 || err != 0 ||
+			    inlen != 0 || outlen != 0 ||
+			    memcmp(outbuf + off, ref, len) != 0 ||
+			    (unsigned char)outbuf[off + len] != 0xff)
+				fail("%s: len %zu flag 0x%x: FAILED!\n",
+				    "u8_textprep_str", len, flag);
+		}
+	}
+
+	/* Output buffers that are too short must still be caught. */
+	for (size_t len = 1; len <= MAXLEN; len++) {
+		size_t inlen = len, outlen = len - 1;
+		int err = 0;
+
+		random_ascii(inbuf, len);
+		if (u8_textprep_str(inbuf, &inlen, outbuf, &outlen, flag,
+		    U8_UNICODE_LATEST, &err) != (size_t)-1 || err != E2BIG ||
+		    outlen != 0)
+			fail("%s: len %zu flag 0x%x: FAILED!\n",
+			    "u8_textprep_str E2BIG", len, flag);
+	}
+
+	/* Processing must stop at an embedded NUL. */
+	for (size_t len = 2; len <= MAXLEN; len++) {
+		size_t nul = random() % len;
+		size_t inlen = len, outlen = sizeof (outbuf);
+		int err = 0;
+
+		random_ascii(inbuf, len);
+		inbuf[nul] = '\0';
+		if (u8_textprep_str(inbuf, &inlen, outbuf, &outlen, flag,
+		    U8_UNICODE_LATEST, &err) != 0 || inlen != len - nul ||
+		    sizeof (outbuf) - outlen != nul)
+			fail("%s: len %zu flag 0x%x: FAILED!\n",
+			    "u8_textprep_str NUL", len, flag);
+	}
+}
+
+static void
+test_strcmp_ascii(int flag)
+{
+	char s1[MAXLEN + 1], s2[MAXLEN + 1];
+
+	for (size_t len = 0; len <= MAXLEN; len++) {
+		for (int i = 0; i < 64; i++) {
+			int err = 0;
+
+			random_ascii(s1, len);
+			for (size_t j = 0; j <= len; j++)
+				s2[j] = (random() % 2) ?
+				    ref_case_conv(s1[j], U8_TEXTPREP_TOUPPER) :
+				    ref_case_conv(s1[j], U8_TEXTPREP_TOLOWER);
+			if (len > 0 && i % 2)
+				s2[random() % len] = 0x20 + random() % 0x5f;
+
+			if (sign(u8_strcmp(s1, s2, 0, flag, U8_UNICODE_LATEST,
+			    &err)) != sign(ref_strcmp(s1, s2, flag)) || err)
+				fail("%s: len %zu flag 0x%x: FAILED!\n",
+				    "u8_strcmp", len, flag);
+		}
+	}
+}
+
+/*
+ * "e" followed by U+0301 COMBINING ACUTE ACCENT must compose into U+00E9
+ * no matter where the ASCII run before it ends.
+ */
+static void
+test_combining(void)
+{
+	char in[MAXLEN + 4], comp[MAXLEN + 4], out[MAXLEN + 4];
+
+	for (size_t len = 0; len + 3 <= MAXLEN; len++) {
+		size_t inlen, outlen;
+		int err = 0;
+
+		random_ascii(in, len);
+		(void) strcpy(comp, in);
+		(void) strcpy(in + len, "e\xcc\x81");
+		(void) strcpy(comp + len, "\xc3\xa9");
+
+		inlen = strlen(in);
+		outlen = sizeof (out);
+		if (u8_textprep_str(in, &inlen, out, &outlen, U8_TEXTPREP_NFC,
+		    U8_UNICODE_LATEST, &err) != 0 || err != 0 ||
+		    sizeof (out) - outlen != len + 2 ||
+		    memcmp(out, comp, len + 2) != 0)
+			fail("%s: len %zu flag 0x%x: FAILED!\n",
+			    "u8_textprep_str combining", len, U8_TEXTPREP_NFC);
+
+		if (u8_strcmp(in, comp, 0, U8_STRCMP_NFD, U8_UNICODE_LATEST,
+		    &err) != 0 || err != 0)
+			fail("%s: len %zu flag 0x%x: FAILED!\n",
+			    "u8_strcmp combining", len, U8_STRCMP_NFD);
+	}
+}
+
+static uint64_t
+gethrtime_ns(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static void
+perf_test(const char *kind, char (*names)[MAXLEN + 1],
+    char (*other)[MAXLEN + 1], size_t len)
+{
+	static const struct {
+		const char *name;
+		int flag;
+	} tests[] = {
+		{ "textprep-lower", U8_TEXTPREP_TOLOWER },
+		{ "textprep-nfd-lower", NFD_CI_LOWER },
+		{ "strcmp-ci", U8_STRCMP_CI_LOWER },
+		{ "strcmp-nfd-ci", NFD_CI_LOWER },
+	};
+	char out[4 * MAXLEN];
+
+	for (int t = 0; t < sizeof (tests) / sizeof (tests[0]); t++) {
+		uint64_t start = gethrtime_ns();
+		boolean_t textprep = strncmp(tests[t].name, "textprep", 8) == 0;
+
+		for (int i = 0; i < PERF_ITERS; i++) {
+			for (int n = 0; n < NNAMES; n++) {
+				size_t inlen = strlen(names[n]);
+				size_t outlen = sizeof (out);
+				int err;
+
+				if (textprep) {
+					(void) u8_textprep_str(names[n],
+					    &inlen, out, &outlen,
+					    tests[t].flag, U8_UNICODE_LATEST,
+					    &err);
+				} else {
+					(void) u8_strcmp(names[n], other[n], 0,
+					    tests[t].flag, U8_UNICODE_LATEST,
+					    &err);
+				}
+			}
+		}
+
+		(void) printf("%-6s %2zu bytes  %-20s %8.1f ns/name\n", kind,
+		    len, tests[t].name, (double)(gethrtime_ns() - start) /
+		    ((double)PERF_ITERS * NNAMES));
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	static char names[NNAMES][MAXLEN + 1], upper[NNAMES][MAXLEN + 1];
+	static const char *latin[] = { "\xc3\xa0", "\xc3\xa9", "\xc3\xae",
+	    "\xc3\xb5", "\xc3\xbc", "\xc3\x80", "\xc3\x89", "\xc3\x96" };
+	static const size_t perf_lens[] = { 8, 16, 32, 64 };
+	static const int flags[] = { 0, U8_TEXTPREP_TOUPPER,
+	    U8_TEXTPREP_TOLOWER, U8_TEXTPREP_NFD, U8_TEXTPREP_NFC,
+	    U8_TEXTPREP_NFKC | U8_TEXTPREP_TOUPPER, NFD_CI_LOWER };
+	boolean_t perf = B_TRUE;
+
+	if (argc == 2 && strcmp(argv[1], "-c") == 0)
+		perf = B_FALSE;
+
+	srandom(time(NULL));
+
+	(void) printf("Running correctness tests:\n");
+	for (int f = 0; f < sizeof (flags) / sizeof (flags[0]); f++) {
+		test_textprep_ascii(flags[f]);
+		test_strcmp_ascii(flags[f]);
+	}
+	test_combining();
+	(void) printf("%s\n", failed ? "FAILED!" : "OK");
+
+	if (failed)
+		return (1);
+	if (!perf)
+		return (0);
+
+	(void) printf("Running performance tests (%d x %d names):\n",
+	    PERF_ITERS, NNAMES);
+	for (int l = 0; l < sizeof (perf_lens) / sizeof (perf_lens[0]); l++) {
+		size_t len = perf_lens[l];
+
+		for (int n = 0; n < NNAMES; n++) {
+			random_ascii(names[n], len);
+			for (size_t i = 0; i <= len; i++)
+				upper[n][i] = ref_case_conv(names[n][i],
+				    U8_TEXTPREP_TOUPPER);
+		}
+		perf_test("ascii", names, upper, len);
+
+		for (int n = 0; n < NNAMES; n++) {
+			names[n][0] = '\0';
+			for (size_t i = 0; i < len; i += 2)
+				(void) strcat(names[n], latin[random() % 8]);
+			(void) strcpy(upper[n], names[n]);
+		}
+		perf_test("latin1", names, upper, len);
+	}
+
+	return (0);
+}
@@ -0,0 +1,330 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ */
+
+/*
+ * Correctness and performance tests for the AES-GCM implementations.
+ *
+ * Every implementation selectable through icp_gcm_impl which works on this
+ * machine is checked against test vectors, and en- and decrypts random data
+ * of many lengths with each key size.  The lengths cover all tails of the
+ * bulk routines and data spanning several FPU chunks.  Ciphertexts and tags
+ * must match those of the generic implementation, decrypt to the plaintext,
+ * and fail authentication when a bit is flipped.
+ *
+ * The performance tests time en- and decryption of 128k records with each
+ * implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/crypto/icp.h>
+#include <sys/crypto/api.h>
+
+#define	GCM_IV_LEN	12
+#define	GCM_TAG_LEN	16
+#define	MAX_DATA_LEN	(256 * 1024)
+#define	PERF_RECORD	(128 * 1024)
+#define	PERF_BYTES	(64ULL * 1024 * 1024)
+
+static const char *impls[] = {
+	"generic", "pclmulqdq", "avx", "vaes-avx2", "vaes-avx512"
+};
+
+/*
+ * Test cases 4 and 16 from "The Galois/Counter Mode of Operation (GCM)",
+ * McGrew and Viega.
+ */
+static const uint8_t tv_key[] = {
+	0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+	0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+	0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08
+};
+static const uint8_t tv_iv[GCM_IV_LEN] = {
+	0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+	0xde, 0xca, 0xf8, 0x88
+};
+static const uint8_t tv_aad[] = {
+	0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+	0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+	0xab, 0xad, 0xda, 0xd2
+};
+static const uint8_t tv_pt[] = {
+	0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5,
+	0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+	0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda,
+	0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+	0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53,
+	0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+	0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57,
+	0xba, 0x63, 0x7b, 0x39
+};
+static const struct {
+	size_t keylen;
+	uint8_t ct[sizeof (tv_pt) + GCM_TAG_LEN];
+} test_vectors[] = {
+	{
+		.keylen = 16,
+		.ct = {
+			0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24,
+			0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+			0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0,
+			0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+			0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c,
+			0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+			0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97,
+			0x3d, 0x58, 0xe0, 0x91,
+			0x5b, 0xc9, 0x4f, 0xbc, 0x32, 0x21, 0xa5, 0xdb,
+			0x94, 0xfa, 0xe9, 0x5a, 0xe7, 0x12, 0x1a, 0x47
+		},
+	},
+	{
+		.keylen = 32,
+		.ct = {
+			0x52, 0x2d, 0xc1, 0xf0, 0x99, 0x56, 0x7d, 0x07,
+			0xf4, 0x7f, 0x37, 0xa3, 0x2a, 0x84, 0x42, 0x7d,
+			0x64, 0x3a, 0x8c, 0xdc, 0xbf, 0xe5, 0xc0, 0xc9,
+			0x75, 0x98, 0xa2, 0xbd, 0x25, 0x55, 0xd1, 0xaa,
+			0x8c, 0xb0, 0x8e, 0x48, 0x59, 0x0d, 0xbb, 0x3d,
+			0xa7, 0xb0, 0x8b, 0x10, 0x56, 0x82, 0x88, 0x38,
+			0xc5, 0xf6, 0x1e, 0x63, 0x93, 0xba, 0x7a, 0x0a,
+			0xbc, 0xc9, 0xf6, 0x62,
+			0x76, 0xfc, 0x6e, 0xce, 0x0f, 0x4e, 0x17, 0x68,
+			0xcd, 0xdf, 0x88, 0x53, 0xbb, 0x2d, 0x55, 0x1b
+		},
+	},
+};
+
+/* Lengths beyond the exhaustively tested ones. */
+static const size_t large_lens[] = {
+	4096, 4096 + 16 * 13 + 7, 32736 - 16, 32736, 32736 + 16,
+	3 * 32736 + 16 * 15 + 1, PERF_RECORD, MAX_DATA_LEN - 3, MAX_DATA_LEN
+};
+
+static crypto_mechanism_t mech;
+static boolean_t failed = B_FALSE;
+
+static int
+gcm_crypt(boolean_t encrypt, const uint8_t *key, size_t keylen,
+    const uint8_t *iv, const uint8_t *aad, size_t aadlen,
+    const uint8_t *in, size_t inlen, uint8_t *out, size_t outlen)
+{
+	CK_AES_GCM_PARAMS params = {
+		.pIv = (uchar_t *)iv,
+		.ulIvLen = GCM_IV_LEN,
+		.ulIvBits = CRYPTO_BYTES2BITS(GCM_IV_LEN),
+		.pAAD = (uchar_t *)aad,
+		.ulAADLen = aadlen,
+		.ulTagBits = CRYPTO_BYTES2BITS(GCM_TAG_LEN),
+	};
+	crypto_key_t ckey = {
+		.ck_length = CRYPTO_BYTES2BITS(keylen),
+		.ck_data = (void *)key,
+	};
+	crypto_data_t cin = {
+		.cd_format = CRYPTO_DATA_RAW,
+		.cd_length = inlen,
+		.cd_raw = { .iov_base = (void *)in, .iov_len = inlen },
+	};
+	crypto_data_t cout = {
+		.cd_format = CRYPTO_DATA_RAW,
+		.cd_length = outlen,
+		.cd_raw = { .iov_base = out, .iov_len = outlen },
+	};
+
+	mech.cm_param = (caddr_t)&params;
+	mech.cm_param_len = sizeof (params);
+
+	if (encrypt)
+		return (crypto_encrypt(&mech, &cin, &ckey, NULL, &cout));
+	else
+		return (crypto_decrypt(&mech, &cin, &ckey, NULL, &cout));
+}
+
+static void
+random_bytes(uint8_t *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[i] = random();
+}
+
+static void
+fail(const char *impl, const char *what, size_t keylen, size_t len)
+{
+	(void) printf("%s: %s: key %zu len %zu: FAILED!\n", impl, what,
+	    keylen * 8, len);
+	failed = B_TRUE;
+}
+
+static void
+test_vector_impl(const char *impl)
+{
+	uint8_t ct[sizeof (tv_pt) + GCM_TAG_LEN], pt[sizeof (tv_pt)];
+
+	for (int i = 0; i < ARRAY_SIZE(test_vectors); i++) {
+		size_t keylen = test_vectors[i].keylen;
+
+		if (gcm_crypt(B_TRUE, tv_key, keylen, tv_iv, tv_aad,
+		    sizeof (tv_aad), tv_pt, sizeof (tv_pt), ct,
+		    sizeof (ct)) != CRYPTO_SUCCESS ||
+		    memcmp(ct, test_vectors[i].ct, sizeof (ct)) != 0)
+			fail(impl, "test vector encrypt", keylen,
+			    sizeof (tv_pt));
+		if (gcm_crypt(B_FALSE, tv_key, keylen, tv_iv, tv_aad,
+		    sizeof (tv_aad), test_vectors[i].ct, sizeof (ct), pt,
+		    sizeof (pt)) != CRYPTO_SUCCESS ||
+		    memcmp(pt, tv_pt, sizeof (pt)) != 0)
+			fail(impl, "test vector decrypt", keylen,
+			    sizeof (tv_pt));
+	}
+}
+
+/*
+ * Encrypt pt with the generic implementation, then check every other
+ * implementation against it.
+ */
+static void
+test_len(size_t keylen, size_t len, uint8_t *pt, uint8_t *ref, uint8_t *buf)
+{
+	uint8_t key[32], iv[GCM_IV_LEN], aad[128];
+	size_t aadlen = (len * 7) % sizeof (aad);
+
+	random_bytes(key, keylen);
+	random_bytes(iv, sizeof (iv));
+	random_bytes(aad, aadlen);
+	random_bytes(pt, len);
+
+	VERIFY0(gcm_impl_set("generic"));
+	if (gcm_crypt(B_TRUE, key, keylen, iv, aad, aadlen, pt, len, ref,
+	    len + GCM_TAG_LEN) != CRYPTO_SUCCESS) {
+		fail("generic", "encrypt", keylen, len);
+		return;
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(impls); i++) {
+		if (gcm_impl_set(impls[i]) != 0)
+			continue;
+
+		if (gcm_crypt(B_TRUE, key, keylen, iv, aad, aadlen, pt, len,
+		    buf, len + GCM_TAG_LEN) != CRYPTO_SUCCESS ||
+		    memcmp(buf, ref, len + GCM_TAG_LEN) != 0)
+			fail(impls[i], "encrypt", keylen, len);
+
+		if (gcm_crypt(B_FALSE, key, keylen, iv, aad, aadlen, ref,
+		    len + GCM_TAG_LEN, buf, len) != CRYPTO_SUCCESS ||
+		    memcmp(buf, pt, len) != 0)
+			fail(impls[i], "decrypt", keylen, len);
+
+		size_t bit = random() % ((len + GCM_TAG_LEN) * 8);
+		ref[bit / 8] ^= 1 << (bit % 8);
+		if (gcm_crypt(B_FALSE, key, keylen, iv, aad, aadlen, ref,
+		    len + GCM_TAG_LEN, buf, len) != CRYPTO_INVALID_MAC)
+			fail(impls[i], "authenticate", keylen, len);
+		ref[bit / 8] ^= 1 << (bit % 8);
+	}
+}
+
+static uint64_t
+gethrtime_ns(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static void
+perf_test(const char *impl, uint8_t *pt, uint8_t *ct)
+{
+	uint8_t key[32], iv[GCM_IV_LEN];
+	uint64_t start, enc_ns, dec_ns;
+
+	random_bytes(key, sizeof (key));
+	random_bytes(iv, sizeof (iv));
+	random_bytes(pt, PERF_RECORD);
+
+	start = gethrtime_ns();
+	for (uint64_t done = 0; done < PERF_BYTES; done += PERF_RECORD) {
+		VERIFY0(gcm_crypt(B_TRUE, key, sizeof (key), iv, NULL, 0,
+		    pt, PERF_RECORD, ct, PERF_RECORD + GCM_TAG_LEN));
+	}
+	enc_ns = gethrtime_ns() - start;
+
+	start = gethrtime_ns();
+	for (uint64_t done = 0; done < PERF_BYTES; done += PERF_RECORD) {
+		VERIFY0(gcm_crypt(B_FALSE, key, sizeof (key), iv, NULL, 0,
+		    ct, PERF_RECORD + GCM_TAG_LEN, pt, PERF_RECORD));
+	}
+	dec_ns = gethrtime_ns() - start;
+
+	(void) printf("%-12s encrypt %6llu MB/s  decrypt %6llu MB/s\n", impl,
+	    (u_longlong_t)(PERF_BYTES * 1000 / enc_ns),
+	    (u_longlong_t)(PERF_BYTES * 1000 / dec_ns));
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const size_t keylens[] = { 16, 24, 32 };
+	uint8_t *pt, *ref, *buf;
+	boolean_t perf = B_TRUE;
+
+	if (argc == 2 && strcmp(argv[1], "-c") == 0)
+		perf = B_FALSE;
+
+	icp_init();
+	srandom(time(NULL));
+	mech.cm_type = crypto_mech2id(SUN_CKM_AES_GCM);
+
+	pt = malloc(MAX_DATA_LEN);
+	ref = malloc(MAX_DATA_LEN + GCM_TAG_LEN);
+	buf = malloc(MAX_DATA_LEN + GCM_TAG_LEN);
+	VERIFY(pt != NULL && ref != NULL && buf != NULL);
+
+	(void) printf("Running correctness tests:\n");
+	for (int i = 0; i < ARRAY_SIZE(impls); i++) {
+		if (gcm_impl_set(impls[i]) != 0) {
+			(void) printf("%-12s not supported\n", impls[i]);
+			continue;
+		}
+		test_vector_impl(impls[i]);
+	}
+	for (int k = 0; k < ARRAY_SIZE(keylens); k++) {
+		for (size_t len = 0; len <= 1024; len++)
+			test_len(keylens[k], len, pt, ref, buf);
+		for (int i = 0; i < ARRAY_SIZE(large_lens); i++)
+			test_len(keylens[k], large_lens[i], pt, ref, buf);
+	}
+	(void) printf("%s\n", failed ? "FAILED!" : "OK");
+
+	if (!failed && perf) {
+		(void) printf("Running performance tests (%llu MiB of 128k "
+		    "records, AES-256):\n", (u_longlong_t)(PERF_BYTES >> 20));
+		for (int i = 0; i < ARRAY_SIZE(impls); i++) {
+			if (gcm_impl_set(impls[i]) == 0)
+				perf_test(impls[i], pt, buf);
+		}
+	}
+
+	VERIFY0(gcm_impl_set("fastest"));
+	free(pt);
+	free(ref);
+	free(buf);
+	icp_fini();
+
+	return (failed ? 1 : 0);
+}